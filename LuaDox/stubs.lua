@@ -19,6 +19,33 @@ function print(...) end
 -- @scope .
 function clamp(val, min, max) end
 
+--- Yield if the task budget of this frame is used up
+--
+-- Does nothing outside of tasks. Call it regularly in long running loops.
+-- @scope .
+function checkpoint() end
+
+--- Writable LuaJIT FFI view of the actions of a script
+--
+-- Only available when OFS was built with `OFS_LUAJIT`.
+-- Copies the actions like any other change, the view writes to that copy.
+-- The pointer is 0 based and stays valid until actions get added, inserted or erased.
+-- It keeps the script alive, pointers and references derived from it don't. Keep the returned pointer around while using them.
+-- The elements are the 12 byte `ofs_script_action` including `selected`, not the 8 byte `FunscriptAction` of the C++ side.
+-- Call `Funscript:sort()` after changing `at` and `Funscript:commit()` to apply the changes.
+--   typedef struct { float at; int16_t pos; uint8_t flags; uint8_t tag; bool selected; } ofs_script_action;
+-- @tparam Funscript script
+-- @treturn ofs_script_action* actions
+-- @treturn number count
+-- @example
+--   local actions, count = actionView(script)
+--   for i = 0, count - 1 do
+--     actions[i].pos = 100 - actions[i].pos
+--   end
+--   script:commit()
+-- @scope .
+function actionView(script) end
+
 --- Get the API version
 -- @treturn number Version
 function ofs.Version() end
@@ -27,6 +54,33 @@ function ofs.Version() end
 -- @treturn string Path
 function ofs.ExtensionDir() end
 
+--- Run a function as a task
+--
+-- Tasks are coroutines which get resumed every frame until they return.
+-- All tasks share a time budget per frame, they give up the rest of the frame by calling `checkpoint()` or `coroutine.yield()`.
+-- Tasks which run over the budget without doing so get suspended anyway, except while lua code is called from C like a `table.sort` comparator.
+-- That doesn't happen in builds with `OFS_LUAJIT`, call `checkpoint()` there.
+-- `update()` and `gui()` aren't tasks, they run to completion every frame. Start a task from them for long running work.
+-- Bindings and `scriptChange` run as tasks too.
+-- Tasks run on the main thread outside of `gui()`, GUI functions can't be used in them.
+-- @tparam function task
+-- @example
+--   function binding.smooth()
+--     ofs.Task(function()
+--       local script = ofs.Script(ofs.ActiveIdx())
+--       for idx, action in ipairs(script.actions) do
+--         -- ...
+--         checkpoint()
+--       end
+--       script:commit()
+--     end)
+--   end
+function ofs.Task(task) end
+
+--- Gets if the task budget of this frame is used up
+-- @treturn bool exceeded
+function ofs.TaskBudgetExceeded() end
+
 --- Get the currently loaded script count
 -- @treturn number Count
 function ofs.ScriptCount() end
@@ -260,6 +314,11 @@ playbackSpeed = 1.0
 -- @class Funscript
 
 --- Array of actions
+--
+-- Supports indexing, `#`, `ipairs`, `pairs` and the methods
+-- `add(action)`, `insert(idx, action)`, `erase(idx)`, `clear()`, `empty()` and `size()`.
+-- Reading doesn't copy anything, the actions get copied the first time they are changed.
+-- Changes only apply to the script after calling `Funscript:commit()`.
 -- @meta read/write
 -- @type Action[]
 actions = {}
@@ -279,6 +338,12 @@ name = ""
 function Funscript:hasSelection() end
 
 --- Commit the changes
+--
+-- Only the time range which differs from the script gets replaced,
+-- undo restores just that range as well.
+-- Raises an error if the script was changed after the actions got copied,
+-- which can happen when a task yields in between.
+-- Raises an error if two actions have the same timestamp.
 -- @treturn nil
 function Funscript:commit() end
 
@@ -308,6 +373,32 @@ function Funscript:closestActionBefore(time) end
 -- @treturn number[] indices
 function Funscript:selectedIndices() end
 
+--- Iterate over the actions between two times (inclusive)
+-- Only visits the range while the actions are sorted, call `Funscript:sort()` after moving actions around.
+-- @tparam number fromTime Time in seconds
+-- @tparam number toTime Time in seconds
+-- @treturn function iterator yielding index, action
+-- @example
+--   for idx, action in script:actionsInRange(10.0, 20.0) do
+--     action.pos = 100 - action.pos
+--   end
+function Funscript:actionsInRange(fromTime, toTime) end
+
+--- Iterate over the selected actions between two times (inclusive)
+-- @tparam number fromTime Time in seconds
+-- @tparam number toTime Time in seconds
+-- @treturn function iterator yielding index, action
+function Funscript:selectedInRange(fromTime, toTime) end
+
+--- Iterate over the strokes of the script
+-- A stroke is a run of actions moving in one direction, consecutive strokes share an action.
+-- @treturn function iterator yielding startIdx, endIdx
+-- @example
+--   for startIdx, endIdx in script:strokes() do
+--     print(script.actions[endIdx].pos - script.actions[startIdx].pos)
+--   end
+function Funscript:strokes() end
+
 --- Mark an action for removal
 -- @tparam number actionIdx
 -- @treturn nil
@@ -364,6 +455,30 @@ selected = false
 -- @treturn Process|nil Returns a process on success or nil
 function Process.new(program, ...) end
 
+--- Start a process and stream its output
+--
+-- The output gets read on background threads and is handed to the callbacks on the main thread before `update()`.
+-- The process is kept alive until it exited and all callbacks ran, even if the handle goes out of scope.
+-- Callbacks:
+--
+-- * `stdout(text)`, `stderr(text)` receive the output line by line
+-- * `lines` set it to false to receive chunks as they arrive instead
+-- * `exit(code)` is called after all output was delivered
+-- @display Process.start
+-- @tparam string program
+-- @tparam table args Array of arguments or nil
+-- @tparam table callbacks Table of callbacks or nil
+-- @treturn Process|nil Returns a process on success or nil
+-- @example
+--  local p = Process.start("python", { "tracker.py", video }, {
+--    stdout = function(line)
+--      local at, pos = line:match("([%d%.]+) (%d+)")
+--      if at then script.actions:add(Action.new(tonumber(at), tonumber(pos))) end
+--    end,
+--    exit = function(code) script:commit() end
+--  })
+function Process.start(program, args, callbacks) end
+
 --- Process handle returned by `Process.new()`
 --
 -- If the handle goes out of scope the process may get killed. (This is not guaranteed)
@@ -389,6 +504,13 @@ function Process:alive() end
 -- @treturn number Return code
 function Process:join() end
 
+--- Call a function once the process exited
+--
+-- Runs on the main thread before `update()`, the process is kept alive until then.
+-- @tparam function callback Called with the return code
+-- @treturn nil
+function Process:onExit(callback) end
+
 --- Detach the process letting it run freely
 -- @treturn nil
 function Process:detach() end
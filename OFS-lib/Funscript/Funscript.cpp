@@ -52,9 +52,14 @@ void Funscript::saveMetadata(nlohmann::json& outMetadataObj, const Funscript::Me
     OFS::Serializer<false>::Serialize(inMetadata, outMetadataObj);
 }
 
-void Funscript::notifyActionsChanged(bool isEdit) noexcept
+uint32_t Funscript::nextEditVersion = 1;
+
+void Funscript::notifyActionsChanged(bool isEdit, float fromTime, float toTime) noexcept
 {
     funscriptChanged = true;
+    changedFromTime = std::min(changedFromTime, fromTime);
+    changedToTime = std::max(changedToTime, toTime);
+    editVersion = nextEditVersion++;
     if (isEdit && !unsavedEdits) {
         unsavedEdits = true;
         editTime = std::chrono::system_clock::now();
@@ -66,7 +71,9 @@ void Funscript::Update() noexcept
     OFS_PROFILE(__FUNCTION__);
     if (funscriptChanged) {
         funscriptChanged = false;
-        EV::Enqueue<FunscriptActionsChangedEvent>(this);
+        EV::Enqueue<FunscriptActionsChangedEvent>(this, changedFromTime, changedToTime);
+        changedFromTime = std::numeric_limits<float>::max();
+        changedToTime = std::numeric_limits<float>::lowest();
     }
     if (selectionChanged) {
         selectionChanged = false;
@@ -181,30 +188,30 @@ float Funscript::GetPositionAtTime(float time) const noexcept
     return data.Actions.back().pos;
 }
 
-std::tuple<float, float, float> Funscript::getInterpolatedAction(float time) const noexcept
+std::tuple<float, float, float> Funscript::getInterpolatedAction(const FunscriptArray& actions, float time) noexcept
 {
-    if (data.Actions.size() == 0) {
+    if (actions.size() == 0) {
         return { 0, 0, std::numeric_limits<float>::infinity() };
     }
-    else if (data.Actions.size() == 1) {
-        float pos_norm = data.Actions[0].pos / 100.f;
+    else if (actions.size() == 1) {
+        float pos_norm = actions[0].pos / 100.f;
         return { pos_norm, pos_norm, std::numeric_limits<float>::infinity() };
     }
 
     // Boundary conditions.
-    if (time <= data.Actions.front().atS) {
-        float pos_norm = data.Actions.front().pos / 100.f;
+    if (time <= actions.front().atS) {
+        float pos_norm = actions.front().pos / 100.f;
         return { pos_norm, pos_norm, std::numeric_limits<float>::infinity() };
     }
-    else if (time >= data.Actions.back().atS) {
-        float pos_norm = data.Actions.back().pos / 100.f;
+    else if (time >= actions.back().atS) {
+        float pos_norm = actions.back().pos / 100.f;
         return { pos_norm, pos_norm, std::numeric_limits<float>::infinity() };
     }
 
     size_t index = 0;
-    auto it = data.Actions.lower_bound(FunscriptAction(time, 0));
-    if (it != data.Actions.end()) {
-        index = std::distance(data.Actions.begin(), it);
+    auto it = actions.lower_bound(FunscriptAction(time, 0));
+    if (it != actions.end()) {
+        index = std::distance(actions.begin(), it);
         if (index > 0) {
             index -= 1;
         }
@@ -215,8 +222,8 @@ std::tuple<float, float, float> Funscript::getInterpolatedAction(float time) con
         std::abort();
     }
 
-    auto& curr_action = data.Actions.at(index);
-    auto& next_action = data.Actions.at(index + 1);
+    auto& curr_action = actions.at(index);
+    auto& next_action = actions.at(index + 1);
 
     if (time > curr_action.atS && time < next_action.atS) [[likely]] {
         // TODO: Doesn't match display when not both actions are step.
@@ -401,6 +408,49 @@ void Funscript::SetActions(const FunscriptArray& override_with) noexcept
     notifyActionsChanged(true);
 }
 
+static std::pair<FunscriptArray::const_iterator, FunscriptArray::const_iterator> intervalBounds(const FunscriptArray& actions, float fromTime, float toTime) noexcept
+{
+    auto first = std::lower_bound(actions.begin(), actions.end(), fromTime,
+        [](auto action, float time) noexcept { return action.atS < time; });
+    auto last = std::upper_bound(first, actions.end(), toTime,
+        [](float time, auto action) noexcept { return time < action.atS; });
+    return { first, last };
+}
+
+static void replaceInterval(FunscriptArray& actions, float fromTime, float toTime, const FunscriptArray& replacement) noexcept
+{
+    auto [first, last] = intervalBounds(actions, fromTime, toTime);
+    size_t firstIdx = std::distance(actions.cbegin(), first);
+    size_t count = std::distance(first, last);
+    if (count == replacement.size()) {
+        // Moved or modified actions, nothing has to shift
+        std::copy(replacement.begin(), replacement.end(), actions.begin() + firstIdx);
+    }
+    else {
+        actions.erase(first, last);
+        actions.insert(actions.begin() + firstIdx, replacement.begin(), replacement.end());
+    }
+}
+
+Funscript::FunscriptData Funscript::DataInInterval(float fromTime, float toTime) const noexcept
+{
+    FunscriptData intervalData;
+    auto [first, last] = intervalBounds(data.Actions, fromTime, toTime);
+    intervalData.Actions.assign(first, last);
+    auto [firstSelected, lastSelected] = intervalBounds(data.Selection, fromTime, toTime);
+    intervalData.Selection.assign(firstSelected, lastSelected);
+    return intervalData;
+}
+
+void Funscript::SetDataInInterval(float fromTime, float toTime, const FunscriptData& intervalData) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    replaceInterval(data.Actions, fromTime, toTime, intervalData.Actions);
+    replaceInterval(data.Selection, fromTime, toTime, intervalData.Selection);
+    notifyActionsChanged(true, fromTime, toTime);
+    notifySelectionChanged();
+}
+
 void Funscript::RemoveActionsInInterval(float fromTime, float toTime) noexcept
 {
     OFS_PROFILE(__FUNCTION__);
@@ -411,7 +461,43 @@ void Funscript::RemoveActionsInInterval(float fromTime, float toTime) noexcept
             }),
         data.Actions.end());
     checkForInvalidatedActions();
-    notifyActionsChanged(true);
+    notifyActionsChanged(true, fromTime, toTime);
+}
+
+void Funscript::ReplaceActionsInInterval(float fromTime, float toTime, const FunscriptArray& actions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    FunscriptArray merged;
+    merged.reserve(data.Actions.size() + actions.size());
+
+    auto it = data.Actions.begin();
+    auto newIt = actions.begin();
+    while (it != data.Actions.end() || newIt != actions.end()) {
+        if (it != data.Actions.end() && it->atS >= fromTime && it->atS <= toTime) {
+            ++it;
+        }
+        else if (newIt == actions.end() || (it != data.Actions.end() && it->atS < newIt->atS)) {
+            merged.emplace_back_unsorted(*it);
+            ++it;
+        }
+        else {
+            if (it != data.Actions.end() && it->atS == newIt->atS) {
+                ++it;
+            }
+            merged.emplace_back_unsorted(*newIt);
+            ++newIt;
+        }
+    }
+
+    data.Actions = std::move(merged);
+    checkForInvalidatedActions();
+    if (!actions.empty()) {
+        fromTime = fromTime <= toTime ? std::min(fromTime, actions.front().atS) : actions.front().atS;
+        toTime = std::max(toTime, actions.back().atS);
+    }
+    if (fromTime <= toTime) {
+        notifyActionsChanged(true, fromTime, toTime);
+    }
 }
 
 void Funscript::RangeExtendSelection(int32_t rangeExtend) noexcept
@@ -983,6 +1069,7 @@ bool Funscript::Deserialize(const nlohmann::json& json, Funscript::Metadata* out
             data.Actions.emplace(time, Util::Clamp(pos, 0, 100));
         }
     }
+    editVersion = nextEditVersion++;
 
     if (outMetadata) {
         if (json.contains("metadata")) {
@@ -25,8 +25,15 @@ class FunscriptActionsChangedEvent: public OFS_Event<FunscriptActionsChangedEven
 public:
     // FIXME: get rid of this raw pointer
     const Funscript* Script = nullptr;
+    // only actions in [FromTime, ToTime] changed
+    float FromTime = 0.f;
+    float ToTime = std::numeric_limits<float>::max();
     FunscriptActionsChangedEvent(const Funscript* changedScript) noexcept
     : Script(changedScript) {}
+    FunscriptActionsChangedEvent(const Funscript* changedScript, float fromTime, float toTime) noexcept
+    : Script(changedScript), FromTime(fromTime), ToTime(toTime) {}
+
+    inline bool WholeScript() const noexcept { return FromTime <= 0.f && ToTime == std::numeric_limits<float>::max(); }
 };
 
 class FunscriptSelectionChangedEvent: public OFS_Event<FunscriptSelectionChangedEvent> {
@@ -93,9 +100,15 @@ private:
     // nlohmann::json JsonOther;
 
     std::chrono::system_clock::time_point editTime;
+    // changes with every modification of the actions, unique across all scripts
+    uint32_t editVersion = 0;
+    static uint32_t nextEditVersion;
     bool funscriptChanged = false; // used to fire only one event every frame a change occurs
     bool unsavedEdits = false; // used to track if the script has unsaved changes
     bool selectionChanged = false;
+    // union of everything changed since the last FunscriptActionsChangedEvent
+    float changedFromTime = std::numeric_limits<float>::max();
+    float changedToTime = std::numeric_limits<float>::lowest();
     FunscriptData data;
 
     void checkForInvalidatedActions() noexcept;
@@ -124,7 +137,8 @@ private:
     static void loadMetadata(const nlohmann::json& metadataObj, Funscript::Metadata& outMetadata) noexcept;
     static void saveMetadata(nlohmann::json& outMetadataObj, const Funscript::Metadata& inMetadata) noexcept;
 
-    void notifyActionsChanged(bool isEdit) noexcept;
+    inline void notifyActionsChanged(bool isEdit) noexcept { notifyActionsChanged(isEdit, 0.f, std::numeric_limits<float>::max()); }
+    void notifyActionsChanged(bool isEdit, float fromTime, float toTime) noexcept;
     std::string currentPathRelative;
     std::string title;
 
@@ -165,6 +179,11 @@ public:
     static void Serialize(nlohmann::json& json, const FunscriptData& funscriptData, const Funscript::Metadata& metadata, bool includeChapters) noexcept;
 
     inline const FunscriptData& Data() const noexcept { return data; }
+    // Actions and selection in [fromTime, toTime]
+    FunscriptData DataInInterval(float fromTime, float toTime) const noexcept;
+    // Replaces the actions and the selection in [fromTime, toTime] as a single edit.
+    // Everything in data has to be inside of the interval.
+    void SetDataInInterval(float fromTime, float toTime, const FunscriptData& data) noexcept;
     inline const auto& Selection() const noexcept { return data.Selection; }
     inline const auto& Actions() const noexcept { return data.Actions; }
 
@@ -182,8 +201,11 @@ public:
      * 
      * NOTE: Playback speed compensation is not applied.
      */
-    std::tuple<float, float, float> getInterpolatedAction(
-        float time) const noexcept;
+    inline std::tuple<float, float, float> getInterpolatedAction(
+        float time) const noexcept { return getInterpolatedAction(data.Actions, time); }
+    // Same as above on any sorted array of actions, e.g. a copy owned by another thread.
+    static std::tuple<float, float, float> getInterpolatedAction(
+        const FunscriptArray& actions, float time) noexcept;
 
     inline void AddAction(FunscriptAction newAction) noexcept { addAction(data.Actions, newAction); }
     void AddMultipleActions(const FunscriptArray& actions) noexcept;
@@ -199,8 +221,13 @@ public:
 
     inline bool HasUnsavedEdits() const { return unsavedEdits; }
     inline const std::chrono::system_clock::time_point& EditTime() const { return editTime; }
+    inline uint32_t EditVersion() const noexcept { return editVersion; }
 
     void RemoveActionsInInterval(float fromTime, float toTime) noexcept;
+    // Removes everything in [fromTime, toTime] and merges in the sorted actions as a single edit.
+    // New actions replace existing ones at the same time. Nothing is removed if fromTime > toTime.
+    void ReplaceActionsInInterval(float fromTime, float toTime, const FunscriptArray& actions) noexcept;
+    inline void MergeActions(const FunscriptArray& actions) noexcept { ReplaceActionsInInterval(1.f, 0.f, actions); }
 
     // selection api
     void RangeExtendSelection(int32_t rangeExtend) noexcept;
@@ -8,6 +8,7 @@
 
 #include <memory>
 #include <array>
+#include <algorithm>
 
 ImGradient FunscriptHeatmap::Colors;
 ImGradient FunscriptHeatmap::LineColors;
@@ -148,17 +149,16 @@ FunscriptHeatmap::FunscriptHeatmap() noexcept
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void FunscriptHeatmap::Update(float totalDuration, const FunscriptArray& actions) noexcept
+// Average speed of the strokes starting at firstAction for the texels [firstTexel, lastTexel]
+static void renderSpeed(const FunscriptArray& actions, size_t firstAction, float timeStep,
+    uint32_t firstTexel, uint32_t lastTexel, std::vector<float>& speedBuffer) noexcept
 {
-    OFS_PROFILE(__FUNCTION__);
-    std::vector<float> speedBuffer; 
-    speedBuffer.resize(SpeedTextureResolution, 0.f);
+    uint32_t texelCount = lastTexel - firstTexel + 1;
+    speedBuffer.assign(texelCount, 0.f);
     std::vector<uint16_t> sampleCountBuffer;
-    sampleCountBuffer.resize(SpeedTextureResolution, 0);
+    sampleCountBuffer.resize(texelCount, 0);
 
-    float timeStep = totalDuration / SpeedTextureResolution;
-
-    for(uint32_t i = 0, j = 1, size = actions.size(); j < size; i = j++)
+    for(size_t i = firstAction, j = firstAction + 1, size = actions.size(); j < size; i = j++)
     {
         auto prev = actions[i];
         auto next = actions[j];
@@ -168,39 +168,86 @@ void FunscriptHeatmap::Update(float totalDuration, const FunscriptArray& actions
     
         uint32_t prevSampleIdx = prev.atS / timeStep;
         uint32_t nextSampleIdx = next.atS / timeStep;
+        if(prevSampleIdx > lastTexel) break;
         if(prevSampleIdx == nextSampleIdx)
         {
-            if(prevSampleIdx < SpeedTextureResolution)
+            if(prevSampleIdx >= firstTexel)
             {
-                sampleCountBuffer[prevSampleIdx] += 1;
-                speedBuffer[prevSampleIdx] += speed;
+                sampleCountBuffer[prevSampleIdx - firstTexel] += 1;
+                speedBuffer[prevSampleIdx - firstTexel] += speed;
             }
         }
         else
         {
-            if(prevSampleIdx < SpeedTextureResolution && nextSampleIdx < SpeedTextureResolution)
+            if(nextSampleIdx < SpeedTextureResolution)
             {
-                for(int x = prevSampleIdx; x < nextSampleIdx; x += 1)
+                for(uint32_t x = std::max(prevSampleIdx, firstTexel); x < nextSampleIdx && x <= lastTexel; x += 1)
                 {
-                    sampleCountBuffer[x] += 1;
-                    speedBuffer[x] += speed;
+                    sampleCountBuffer[x - firstTexel] += 1;
+                    speedBuffer[x - firstTexel] += speed;
                 }
             }
         }
     }
 
-    for(uint32_t i=0; i < SpeedTextureResolution; i += 1)
+    for(uint32_t i=0; i < texelCount; i += 1)
     {
         speedBuffer[i] /= sampleCountBuffer[i] > 0 ? (float)sampleCountBuffer[i] : 1.f;
         speedBuffer[i] /= MaxSpeedPerSecond;
         speedBuffer[i] = Util::Clamp(speedBuffer[i], 0.f, 1.f);
     }
+}
+
+void FunscriptHeatmap::Update(float totalDuration, const FunscriptArray& actions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    std::vector<float> speedBuffer; 
+    renderSpeed(actions, 0, totalDuration / SpeedTextureResolution, 0, SpeedTextureResolution - 1, speedBuffer);
+    duration = totalDuration;
 
     glBindTexture(GL_TEXTURE_2D, speedTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, SpeedTextureResolution, 1, 0, GL_RED, GL_FLOAT, speedBuffer.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void FunscriptHeatmap::Update(float totalDuration, const FunscriptArray& actions, float fromTime, float toTime) noexcept
+{
+    if(totalDuration != duration || fromTime > toTime || actions.empty())
+    {
+        Update(totalDuration, actions);
+        return;
+    }
+    OFS_PROFILE(__FUNCTION__);
+    float timeStep = totalDuration / SpeedTextureResolution;
+    auto sampleIdx = [timeStep](FunscriptAction action) noexcept { return (uint32_t)(action.atS / timeStep); };
+
+    // The actions around the interval didn't change, neither did anything outside of their strokes
+    auto after = std::upper_bound(actions.begin(), actions.end(), toTime,
+        [](float time, auto action) noexcept { return time < action.atS; });
+    auto before = std::lower_bound(actions.begin(), actions.end(), fromTime,
+        [](auto action, float time) noexcept { return action.atS < time; });
+    uint32_t firstTexel = 0;
+    size_t firstAction = 0;
+    if(before != actions.begin())
+    {
+        firstAction = std::distance(actions.begin(), before) - 1;
+        firstTexel = sampleIdx(actions[firstAction]);
+        // strokes within the first texel and the one reaching into it count towards it
+        while(firstAction > 0 && sampleIdx(actions[firstAction - 1]) >= firstTexel) firstAction -= 1;
+        if(firstAction > 0) firstAction -= 1;
+    }
+    uint32_t lastTexel = after != actions.end() ? sampleIdx(*after) : SpeedTextureResolution - 1;
+    lastTexel = std::min<uint32_t>(lastTexel, SpeedTextureResolution - 1);
+    if(firstTexel > lastTexel) return;
+
+    std::vector<float> speedBuffer;
+    renderSpeed(actions, firstAction, timeStep, firstTexel, lastTexel, speedBuffer);
+
+    glBindTexture(GL_TEXTURE_2D, speedTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, firstTexel, 0, lastTexel - firstTexel + 1, 1, GL_RED, GL_FLOAT, speedBuffer.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 void FunscriptHeatmap::DrawHeatmap(ImDrawList* drawList, const ImVec2& min, const ImVec2& max) noexcept
 {
     drawList->AddCallback([](const ImDrawList* parentList, const ImDrawCmd* cmd) noexcept
@@ -19,6 +19,12 @@ public:
 
 	void DrawHeatmap(ImDrawList* drawList, const ImVec2& min, const ImVec2& max) noexcept;
 	void Update(float totalDuration , const FunscriptArray& actions) noexcept;
+	// Only redoes the part of the heatmap affected by changes in [fromTime, toTime]
+	void Update(float totalDuration, const FunscriptArray& actions, float fromTime, float toTime) noexcept;
 
 	std::vector<uint8_t> RenderToBitmap(int16_t width, int16_t height) noexcept;
+
+private:
+	// duration of the last full update, partial updates fall back to a full one when it changes
+	float duration = -1.f;
 };
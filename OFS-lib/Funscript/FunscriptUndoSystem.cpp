@@ -20,12 +20,39 @@ void FunscriptUndoSystem::Snapshot(int32_t type, bool clearRedo) noexcept
 		ClearRedo();
 }
 
+void FunscriptUndoSystem::SnapshotInterval(int32_t type, float fromTime, float toTime, bool clearRedo) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	UndoStack.emplace_back(type, script->DataInInterval(fromTime, toTime), fromTime, toTime);
+
+	if (clearRedo)
+		ClearRedo();
+}
+
+ScriptState FunscriptUndoSystem::snapshotFor(const ScriptState& state) const noexcept
+{
+	if (state.IsInterval()) {
+		return ScriptState(state.type, script->DataInInterval(state.fromTime, state.toTime), state.fromTime, state.toTime);
+	}
+	return ScriptState(state.type, script->Data());
+}
+
+static void restore(Funscript* script, ScriptState& state) noexcept
+{
+	if (state.IsInterval()) {
+		script->SetDataInInterval(state.fromTime, state.toTime, state.Data());
+	}
+	else {
+		script->Rollback(std::move(state.Data())); // move data
+	}
+}
+
 bool FunscriptUndoSystem::Undo() noexcept
 {
 	if (UndoStack.empty()) return false;
 	OFS_PROFILE(__FUNCTION__);
-	SnapshotRedo(UndoStack.back().type); // copy data to redo
-	script->Rollback(std::move(UndoStack.back().Data())); // move data
+	RedoStack.emplace_back(snapshotFor(UndoStack.back())); // copy data to redo
+	restore(script, UndoStack.back());
 	UndoStack.pop_back(); // pop of the stack
 	return true;
 }
@@ -34,8 +61,16 @@ bool FunscriptUndoSystem::Redo() noexcept
 {
 	if (RedoStack.empty()) return false;
 	OFS_PROFILE(__FUNCTION__);
-	Snapshot(RedoStack.back().type, false); // copy data to undo
-	script->Rollback(std::move(RedoStack.back().Data())); // move data
+	UndoStack.emplace_back(snapshotFor(RedoStack.back())); // copy data to undo
+	restore(script, RedoStack.back());
 	RedoStack.pop_back(); // pop of the stack
 	return true;
+}
+
+size_t FunscriptUndoSystem::MemoryUsage() const noexcept
+{
+	size_t bytes = (UndoStack.capacity() + RedoStack.capacity()) * sizeof(ScriptState);
+	for (auto& state : UndoStack) bytes += state.MemoryUsage();
+	for (auto& state : RedoStack) bytes += state.MemoryUsage();
+	return bytes;
 }
\ No newline at end of file
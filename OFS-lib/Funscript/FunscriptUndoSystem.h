@@ -8,13 +8,20 @@ private:
 	Funscript::FunscriptData data;
 public:
 	inline Funscript::FunscriptData& Data() { return data; }
+	inline size_t MemoryUsage() const noexcept { return data.Actions.MemoryUsage() + data.Selection.MemoryUsage(); }
 	int32_t type;
+	// Only set when data holds just the actions and selection inside of this interval
+	float fromTime = 0.f;
+	float toTime = -1.f;
 	const char* Description() const noexcept;
+	inline bool IsInterval() const noexcept { return fromTime <= toTime; }
 
 	ScriptState() noexcept 
 		: type(-1) {}
 	ScriptState(int32_t type, const Funscript::FunscriptData& data) noexcept
 		: type(type), data(data) {}
+	ScriptState(int32_t type, Funscript::FunscriptData&& data, float fromTime, float toTime) noexcept
+		: type(type), data(std::move(data)), fromTime(fromTime), toTime(toTime) {}
 };
 
 class FunscriptUndoSystem
@@ -28,6 +35,9 @@ class FunscriptUndoSystem
 	std::vector<ScriptState> RedoStack;
 
 	void Snapshot(int32_t type, bool clearRedo = true) noexcept;
+	void SnapshotInterval(int32_t type, float fromTime, float toTime, bool clearRedo = true) noexcept;
+	// Snapshot of the same kind as state, taken before state gets restored
+	ScriptState snapshotFor(const ScriptState& state) const noexcept;
 	bool Undo() noexcept;
 	bool Redo() noexcept;
 	void ClearRedo() noexcept;
@@ -41,4 +51,6 @@ public:
 	inline bool MatchUndoTop(int32_t type) const noexcept { return !UndoEmpty() && UndoStack.back().type == type; }
 	inline bool UndoEmpty() const noexcept { return UndoStack.empty(); }
 	inline bool RedoEmpty() const noexcept { return RedoStack.empty(); }
+
+	size_t MemoryUsage() const noexcept;
 };
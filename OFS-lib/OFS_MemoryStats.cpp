@@ -0,0 +1,146 @@
+#include "OFS_MemoryStats.h"
+#include "OFS_Util.h"
+#include "OFS_Localization.h"
+
+#include "imgui.h"
+
+#include <cfloat>
+#include <cstring>
+
+bool OFS_MemoryStats::BeginSample(uint32_t ticks, bool force) noexcept
+{
+    if (!force && sampleCount > 0 && ticks - lastSampleTick < SampleIntervalMs) {
+        return false;
+    }
+    if (sampleCount == 0) {
+        sessionStartTick = ticks;
+    }
+    lastSampleTick = ticks;
+    categoryIdx = 0;
+    sampling = true;
+    return true;
+}
+
+void OFS_MemoryStats::Add(const char* id, const char* label, size_t bytes) noexcept
+{
+    FUN_ASSERT(sampling, "BeginSample wasn't called");
+    if (categoryIdx < categories.size()) {
+        auto& category = categories[categoryIdx];
+        FUN_ASSERT(strcmp(category.Id, id) == 0, "categories were added in a different order");
+        category.Label = label;
+        category.Bytes = bytes;
+    }
+    else {
+        categories.push_back({ id, label, bytes, bytes });
+    }
+    categoryIdx += 1;
+}
+
+void OFS_MemoryStats::EndSample() noexcept
+{
+    FUN_ASSERT(sampling, "BeginSample wasn't called");
+    sampling = false;
+    auto& sample = history[sampleCount % HistorySize];
+    sample.TimeMs = lastSampleTick - sessionStartTick;
+    sample.Bytes.clear();
+    for (auto& category : categories) {
+        sample.Bytes.push_back(category.Bytes);
+    }
+    sampleCount += 1;
+}
+
+size_t OFS_MemoryStats::Total() const noexcept
+{
+    size_t total = 0;
+    for (auto& category : categories) {
+        total += category.Bytes;
+    }
+    return total;
+}
+
+void OFS_MemoryStats::ShowStats() noexcept
+{
+    if (ImGui::BeginTable("##memoryStats", 3, ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn(TR(MEMORY_SUBSYSTEM), ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn(TR(MEMORY_CURRENT), ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn(TR(MEMORY_SESSION_CHANGE), ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableHeadersRow();
+
+        auto row = [](const char* label, size_t bytes, size_t startBytes) noexcept {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(label);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(Util::FormatBytes(bytes));
+            ImGui::TableNextColumn();
+            if (bytes >= startBytes) {
+                ImGui::Text("+%s", Util::FormatBytes(bytes - startBytes));
+            }
+            else {
+                ImGui::Text("-%s", Util::FormatBytes(startBytes - bytes));
+            }
+        };
+
+        size_t startTotal = 0;
+        for (auto& category : categories) {
+            row(category.Label, category.Bytes, category.SessionStartBytes);
+            startTotal += category.SessionStartBytes;
+        }
+        row(TR(TOTAL), Total(), startTotal);
+        ImGui::EndTable();
+    }
+
+    if (sampleCount > 1) {
+        size_t count = sampleCount - oldestSample();
+        ImGui::PlotLines("##memoryHistory",
+            [](void* data, int idx) noexcept {
+                auto self = (OFS_MemoryStats*)data;
+                auto& sample = self->sampleAt(self->oldestSample() + idx);
+                size_t total = 0;
+                for (auto bytes : sample.Bytes) total += bytes;
+                return total / (1024.f * 1024.f);
+            },
+            this, (int)count, 0, TR(MEMORY_TOTAL_MB), FLT_MAX, FLT_MAX, ImVec2(-1.f, ImGui::GetFontSize() * 3.f));
+    }
+
+    if (ImGui::Button(TR(MEMORY_EXPORT), ImVec2(-1.f, 0.f))) {
+        auto defaultPath = Util::Prefpath("memory.json");
+        Util::SaveFileDialog(TR(MEMORY_EXPORT), defaultPath,
+            [this](auto& result) {
+                if (!result.files.empty() && !Export(result.files[0])) {
+                    LOGF_ERROR("Failed to export memory statistics to \"%s\"", result.files[0].c_str());
+                }
+            },
+            { "*.json" }, "JSON (*.json)");
+    }
+}
+
+bool OFS_MemoryStats::Export(const std::string& path) const noexcept
+{
+    nlohmann::json current = nlohmann::json::object();
+    for (auto& category : categories) {
+        current[category.Id] = category.Bytes;
+    }
+    current["total"] = Total();
+
+    nlohmann::json samples = nlohmann::json::array();
+    for (size_t i = oldestSample(); i < sampleCount; i += 1) {
+        auto& sample = sampleAt(i);
+        nlohmann::json jsonSample = { { "timeSeconds", sample.TimeMs / 1000.f } };
+        size_t total = 0;
+        for (size_t j = 0; j < sample.Bytes.size() && j < categories.size(); j += 1) {
+            jsonSample[categories[j].Id] = sample.Bytes[j];
+            total += sample.Bytes[j];
+        }
+        jsonSample["total"] = total;
+        samples.push_back(std::move(jsonSample));
+    }
+
+    nlohmann::json json = {
+        { "sampleIntervalSeconds", SampleIntervalMs / 1000 },
+        { "current", std::move(current) },
+        { "history", std::move(samples) }
+    };
+    auto jsonText = Util::SerializeJson(json, true);
+    return Util::WriteFile(path.c_str(), jsonText.data(), jsonText.size()) == jsonText.size();
+}
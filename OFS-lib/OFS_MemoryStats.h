@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Memory usage per subsystem sampled over the whole session.
+// The numbers are reported by the subsystems themselves and are mostly
+// based on container capacities. Lua is the exception which is counted by its allocator.
+class OFS_MemoryStats
+{
+public:
+    static constexpr uint32_t SampleIntervalMs = 5000;
+    static constexpr size_t HistorySize = 720; // one hour
+
+    struct Category
+    {
+        const char* Id;
+        const char* Label;
+        size_t Bytes = 0;
+        size_t SessionStartBytes = 0;
+    };
+
+    // Returns true when a sample is due.
+    // Categories have to be added in the same order every time.
+    bool BeginSample(uint32_t ticks, bool force = false) noexcept;
+    void Add(const char* id, const char* label, size_t bytes) noexcept;
+    void EndSample() noexcept;
+
+    size_t Total() const noexcept;
+    inline const std::vector<Category>& Categories() const noexcept { return categories; }
+
+    void ShowStats() noexcept;
+    bool Export(const std::string& path) const noexcept;
+
+private:
+    struct Sample
+    {
+        uint32_t TimeMs = 0;
+        std::vector<size_t> Bytes;
+    };
+
+    std::vector<Category> categories;
+    std::vector<Sample> history = std::vector<Sample>(HistorySize);
+    size_t sampleCount = 0;
+    size_t categoryIdx = 0;
+    uint32_t sessionStartTick = 0;
+    uint32_t lastSampleTick = 0;
+    bool sampling = false;
+
+    inline const Sample& sampleAt(size_t idx) const noexcept { return history[idx % HistorySize]; }
+    inline size_t oldestSample() const noexcept { return sampleCount > HistorySize ? sampleCount - HistorySize : 0; }
+};
@@ -148,7 +148,7 @@ void OpenFileDialog(const std::string& title, const std::string& path, FileDialo
             }
         }
 
-        EV::Enqueue<OFS_DeferEvent>(
+        EV::Defer(
             [resultHandler = std::move(data->handler), dialogResult]() {
                 resultHandler(*dialogResult);
                 delete dialogResult;
@@ -195,7 +195,7 @@ void SaveFileDialog(const std::string& title, const std::string& path, FileDialo
         if (result != nullptr) {
             saveDialogResult->files.emplace_back(result);
         }
-        EV::Enqueue<OFS_DeferEvent>([resultHandler = std::move(data->handler), saveDialogResult]() {
+        EV::Defer([resultHandler = std::move(data->handler), saveDialogResult]() {
             resultHandler(*saveDialogResult);
             delete saveDialogResult;
         });
@@ -234,7 +234,7 @@ void OpenDirectoryDialog(const std::string& title, const std::string& path, File
             directoryDialogResult->files.emplace_back(result);
         }
 
-        EV::Enqueue<OFS_DeferEvent>([resultHandler = std::move(data->handler), directoryDialogResult]() {
+        EV::Defer([resultHandler = std::move(data->handler), directoryDialogResult]() {
             resultHandler(*directoryDialogResult);
             delete directoryDialogResult;
         });
@@ -271,7 +271,7 @@ void YesNoCancelDialog(const std::string& title, const std::string& message, Yes
                 enumResult = YesNoCancel::No;
                 break;
         }
-        EV::Enqueue<OFS_DeferEvent>([resultHandler = std::move(data->handler), enumResult]() {
+        EV::Defer([resultHandler = std::move(data->handler), enumResult]() {
             resultHandler(enumResult);
         });
         delete data;
@@ -20,6 +20,11 @@ public:
         std::sort(this->begin(), this->end());
     }
 
+    inline size_t MemoryUsage() const noexcept
+    {
+        return this->capacity() * sizeof(T);
+    }
+
     template<typename... Args>
     inline bool emplace(Args&&... args) noexcept
     {
@@ -1,17 +1,9 @@
 #include "OFS_BlockingTask.h"
 #include "OFS_ImGui.h"
 #include "OFS_Localization.h"
+#include "OFS_JobSystem.h"
 #include "imgui.h"
 
-static int BlockingTaskThread(void* data) noexcept
-{
-	auto bdata = (OFS_BlockingTask*)data;
-	bdata->currentTask->TaskThreadFunc(bdata->currentTask.get());
-	bdata->currentTask.reset();
-	bdata->Running = false;
-	return 0;
-}
-
 void OFS_BlockingTask::ShowBlockingTask() noexcept
 {
 	if (currentTask) {
@@ -22,8 +14,16 @@ void OFS_BlockingTask::ShowBlockingTask() noexcept
 	if (!Running) {
 		RunningTimer = 0.f;
 		Running = true;
-		auto thread = SDL_CreateThread(BlockingTaskThread, "BlockingTaskThread", this);
-		SDL_DetachThread(thread);
+		auto job = OFS_JobSystem::ptr->Submit(currentTask->TaskDescription,
+			[task = currentTask.get()](OFS_JobContext& ctx) noexcept {
+				task->TaskThreadFunc(task);
+				return true;
+			},
+			[this](const OFS_Job& job) noexcept {
+				currentTask.reset();
+				Running = false;
+			});
+		job->Cancellable = false;
 	}
 	RunningTimer += ImGui::GetIO().DeltaTime;
 
@@ -0,0 +1,486 @@
+#include "OFS_Profiling.h"
+#include "OFS_Util.h"
+#include "OFS_FileLogging.h"
+#include "OFS_Localization.h"
+
+#include "imgui.h"
+#include "SDL_atomic.h"
+#include "SDL_thread.h"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+std::atomic<bool> OFS_Profiler::recording = false;
+thread_local uint32_t OFS_Profiler::ZoneDepth = 0;
+
+struct ProfilerZone
+{
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	uint16_t depth;
+	uint16_t thread;
+};
+
+// Written by one thread, read by the main thread.
+// When the main thread doesn't keep up zones get dropped instead of overwritten.
+struct ProfilerThreadBuffer
+{
+	static constexpr size_t Capacity = 8192;
+	std::unique_ptr<ProfilerZone[]> zones = std::make_unique<ProfilerZone[]>(Capacity);
+	std::atomic<size_t> head = 0;
+	std::atomic<size_t> tail = 0;
+	std::atomic<uint32_t> dropped = 0;
+	std::atomic<bool> retired = false;
+	SDL_threadID threadId = 0;
+	uint16_t index = 0;
+
+	inline void Push(const ProfilerZone& zone) noexcept
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= Capacity) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		zones[h % Capacity] = zone;
+		head.store(h + 1, std::memory_order_release);
+	}
+};
+
+struct ProfilerFrameStat
+{
+	const char* name;
+	uint64_t total;
+	uint32_t count;
+};
+
+struct ProfilerFrame
+{
+	uint64_t start = 0;
+	uint64_t end = 0;
+	std::vector<ProfilerZone> zones;
+	std::vector<ProfilerFrameStat> stats;
+};
+
+struct ProfilerData
+{
+	static constexpr size_t HistorySize = 300;
+	static constexpr uint16_t FrameThread = 0xFFFF;
+
+	SDL_SpinLock bufferLock = 0;
+	std::vector<ProfilerThreadBuffer*> buffers;
+	uint16_t threadCounter = 0;
+
+	// Everything below is only touched by the main thread
+	std::vector<std::string> threadNames;
+	std::vector<ProfilerFrame> frames = std::vector<ProfilerFrame>(HistorySize);
+	std::unordered_map<const char*, size_t> statIndex;
+	size_t frameCount = 0;
+	size_t selectedFrame = 0;
+	uint64_t frameStart = 0;
+	uint32_t droppedZones = 0;
+	bool frameSelected = false;
+	bool paused = false;
+
+	inline size_t OldestFrame() const noexcept { return frameCount > HistorySize ? frameCount - HistorySize : 0; }
+	inline size_t AvailableFrames() const noexcept { return frameCount - OldestFrame(); }
+	inline ProfilerFrame& Frame(size_t frameIdx) noexcept { return frames[frameIdx % HistorySize]; }
+};
+
+static ProfilerData Profiler;
+
+struct ProfilerThreadOwner
+{
+	ProfilerThreadBuffer* buffer = nullptr;
+	~ProfilerThreadOwner() noexcept
+	{
+		// The buffer gets freed by the main thread after it was drained
+		if (buffer) buffer->retired.store(true, std::memory_order_release);
+	}
+};
+static thread_local ProfilerThreadOwner ThreadOwner;
+
+static ProfilerThreadBuffer* threadBuffer() noexcept
+{
+	if (!ThreadOwner.buffer) {
+		auto buffer = new ProfilerThreadBuffer();
+		buffer->threadId = SDL_ThreadID();
+		SDL_AtomicLock(&Profiler.bufferLock);
+		buffer->index = Profiler.threadCounter++;
+		Profiler.buffers.push_back(buffer);
+		SDL_AtomicUnlock(&Profiler.bufferLock);
+		ThreadOwner.buffer = buffer;
+	}
+	return ThreadOwner.buffer;
+}
+
+// Moves the zones of all threads into zones, without zones they get discarded.
+// Buffers of threads which exited are freed once they are drained.
+static void collectZones(std::vector<ProfilerZone>* zones) noexcept
+{
+	SDL_AtomicLock(&Profiler.bufferLock);
+	auto& buffers = Profiler.buffers;
+	for (auto it = buffers.begin(); it != buffers.end();) {
+		auto buffer = *it;
+		if (buffer->index >= Profiler.threadNames.size()) {
+			Profiler.threadNames.resize(buffer->index + 1);
+		}
+		auto& threadName = Profiler.threadNames[buffer->index];
+		if (threadName.empty()) {
+			// this always runs on the main thread
+			threadName = buffer->threadId == SDL_ThreadID() ? "Main" : Util::Format("Thread %d", (int)buffer->index);
+		}
+
+		// retired has to be read before head so nothing pushed before retiring gets lost
+		bool retired = buffer->retired.load(std::memory_order_acquire);
+		size_t head = buffer->head.load(std::memory_order_acquire);
+		size_t tail = buffer->tail.load(std::memory_order_relaxed);
+		if (zones) {
+			for (; tail != head; tail += 1) {
+				auto zone = buffer->zones[tail % ProfilerThreadBuffer::Capacity];
+				zone.thread = buffer->index;
+				zones->emplace_back(zone);
+			}
+			Profiler.droppedZones += buffer->dropped.exchange(0, std::memory_order_relaxed);
+		}
+		else {
+			tail = head;
+			buffer->dropped.store(0, std::memory_order_relaxed);
+		}
+		buffer->tail.store(tail, std::memory_order_release);
+
+		if (retired) {
+			delete buffer;
+			it = buffers.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	SDL_AtomicUnlock(&Profiler.bufferLock);
+}
+
+static void aggregateFrame(ProfilerFrame& frame) noexcept
+{
+	auto& statIndex = Profiler.statIndex;
+	statIndex.clear();
+	frame.stats.clear();
+	for (auto& zone : frame.zones) {
+		auto [it, inserted] = statIndex.emplace(zone.name, frame.stats.size());
+		if (inserted) {
+			frame.stats.push_back({ zone.name, 0, 0 });
+		}
+		auto& stat = frame.stats[it->second];
+		stat.total += zone.end - zone.start;
+		stat.count += 1;
+	}
+}
+
+static inline float ticksToMs(uint64_t ticks) noexcept
+{
+	static const double freq = (double)SDL_GetPerformanceFrequency();
+	return (float)((ticks * 1000.0) / freq);
+}
+
+static uint32_t zoneColor(const char* name) noexcept
+{
+	uint32_t hash = (uint32_t)(((uintptr_t)name >> 3) * 2654435761u);
+	float r, g, b;
+	ImGui::ColorConvertHSVtoRGB((hash % 360) / 360.f, .45f, .85f, r, g, b);
+	return ImGui::GetColorU32(ImVec4(r, g, b, 1.f));
+}
+
+void OFS_Profiler::SetRecording(bool record) noexcept
+{
+	recording.store(record, std::memory_order_relaxed);
+}
+
+void OFS_Profiler::BeginProfiling() noexcept
+{
+	Profiler.frameStart = SDL_GetPerformanceCounter();
+}
+
+void OFS_Profiler::EndProfiling() noexcept
+{
+	if (!IsRecording()) {
+		// zones which were still open when recording stopped and the buffers of exited threads
+		collectZones(nullptr);
+		return;
+	}
+	auto& frame = Profiler.Frame(Profiler.frameCount);
+	frame.start = Profiler.frameStart;
+	frame.end = SDL_GetPerformanceCounter();
+	frame.zones.clear();
+	collectZones(&frame.zones);
+	aggregateFrame(frame);
+	Profiler.frameCount += 1;
+}
+
+void OFS_Profiler::RecordZone(const char* name, uint64_t start, uint64_t end) noexcept
+{
+	ZoneDepth -= 1;
+	// the zone may have started before recording was turned off
+	if (!IsRecording()) return;
+	threadBuffer()->Push({ name, start, end, (uint16_t)ZoneDepth, 0 });
+}
+
+bool OFS_Profiler::ExportChromeTrace(const std::string& path) noexcept
+{
+	FUN_ASSERT(Util::InMainThread(), "wrong thread");
+	if (Profiler.AvailableFrames() == 0) return false;
+
+	const double toUs = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+	const uint64_t origin = Profiler.Frame(Profiler.OldestFrame()).start;
+	auto timestamp = [toUs, origin](uint64_t ticks) noexcept {
+		return ticks > origin ? (ticks - origin) * toUs : 0.0;
+	};
+
+	nlohmann::json events = nlohmann::json::array();
+	events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", ProfilerData::FrameThread },
+		{ "args", { { "name", "Frames" } } } });
+	for (size_t i = 0; i < Profiler.threadNames.size(); i += 1) {
+		events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", i },
+			{ "args", { { "name", Profiler.threadNames[i] } } } });
+	}
+
+	for (size_t frameIdx = Profiler.OldestFrame(); frameIdx < Profiler.frameCount; frameIdx += 1) {
+		auto& frame = Profiler.Frame(frameIdx);
+		events.push_back({ { "name", "Frame" }, { "ph", "X" }, { "pid", 1 }, { "tid", ProfilerData::FrameThread },
+			{ "ts", timestamp(frame.start) }, { "dur", (frame.end - frame.start) * toUs } });
+		for (auto& zone : frame.zones) {
+			events.push_back({ { "name", zone.name }, { "ph", "X" }, { "pid", 1 }, { "tid", zone.thread },
+				{ "ts", timestamp(zone.start) }, { "dur", (zone.end - zone.start) * toUs } });
+		}
+	}
+
+	nlohmann::json trace = {
+		{ "traceEvents", std::move(events) },
+		{ "displayTimeUnit", "ms" }
+	};
+	auto jsonText = Util::SerializeJson(trace);
+	return Util::WriteFile(path.c_str(), jsonText.data(), jsonText.size()) == jsonText.size();
+}
+
+static void drawFrameHistogram(float height) noexcept
+{
+	constexpr float TargetMs = 1000.f / 60.f;
+	constexpr float ScaleMs = TargetMs * 2.f;
+
+	auto draw = ImGui::GetWindowDrawList();
+	const ImVec2 pos = ImGui::GetCursorScreenPos();
+	const ImVec2 size(ImGui::GetContentRegionAvail().x, height);
+	ImGui::InvisibleButton("##frameHistogram", size);
+	const bool hovered = ImGui::IsItemHovered();
+	const auto& style = ImGui::GetStyle();
+
+	draw->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), ImGui::GetColorU32(ImGuiCol_FrameBg), style.FrameRounding);
+
+	// newest frame on the right
+	const float barWidth = size.x / (float)ProfilerData::HistorySize;
+	const uint32_t barColor = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+	const uint32_t slowColor = IM_COL32(220, 80, 80, 255);
+	const uint32_t selectedColor = ImGui::GetColorU32(ImGuiCol_PlotHistogramHovered);
+	for (size_t frameIdx = Profiler.OldestFrame(); frameIdx < Profiler.frameCount; frameIdx += 1) {
+		auto& frame = Profiler.Frame(frameIdx);
+		float ms = ticksToMs(frame.end - frame.start);
+		float barHeight = std::min(ms / ScaleMs, 1.f) * size.y;
+		float x1 = pos.x + size.x - (float)(Profiler.frameCount - frameIdx) * barWidth;
+		ImVec2 p1(x1, pos.y + size.y - barHeight);
+		ImVec2 p2(x1 + std::max(barWidth - 1.f, 1.f), pos.y + size.y);
+
+		bool selected = Profiler.frameSelected && Profiler.selectedFrame == frameIdx;
+		draw->AddRectFilled(p1, p2, selected ? selectedColor : (ms > TargetMs ? slowColor : barColor));
+
+		if (hovered && ImGui::IsMouseHoveringRect(ImVec2(x1, pos.y), p2)) {
+			ImGui::SetTooltip("%.3f ms", ms);
+			if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+				// selecting a frame pauses so it doesn't scroll away
+				Profiler.selectedFrame = frameIdx;
+				Profiler.frameSelected = true;
+				Profiler.paused = true;
+			}
+		}
+	}
+
+	float targetY = pos.y + size.y - (TargetMs / ScaleMs) * size.y;
+	draw->AddLine(ImVec2(pos.x, targetY), ImVec2(pos.x + size.x, targetY), ImGui::GetColorU32(ImGuiCol_TextDisabled));
+}
+
+static void drawTopZones() noexcept
+{
+	struct ZoneSummary
+	{
+		const char* name;
+		uint64_t total;
+		uint64_t max;
+		uint32_t count;
+	};
+	static std::vector<ZoneSummary> summaries;
+	summaries.clear();
+
+	auto& statIndex = Profiler.statIndex;
+	statIndex.clear();
+	const size_t frames = Profiler.AvailableFrames();
+	for (size_t frameIdx = Profiler.OldestFrame(); frameIdx < Profiler.frameCount; frameIdx += 1) {
+		for (auto& stat : Profiler.Frame(frameIdx).stats) {
+			auto [it, inserted] = statIndex.emplace(stat.name, summaries.size());
+			if (inserted) {
+				summaries.push_back({ stat.name, 0, 0, 0 });
+			}
+			auto& summary = summaries[it->second];
+			summary.total += stat.total;
+			summary.max = std::max(summary.max, stat.total);
+			summary.count += stat.count;
+		}
+	}
+	std::sort(summaries.begin(), summaries.end(),
+		[](auto& a, auto& b) noexcept { return a.total > b.total; });
+
+	if (ImGui::BeginTable("##topZones", 4, ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn(TR(PROFILER_ZONE), ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn(TR(PROFILER_AVG_MS), ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn(TR(PROFILER_MAX_MS), ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn(TR(PROFILER_CALLS), ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableHeadersRow();
+		for (auto& summary : summaries) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(summary.name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", ticksToMs(summary.total) / frames);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", ticksToMs(summary.max));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", summary.count / (float)frames);
+		}
+		ImGui::EndTable();
+	}
+}
+
+static void drawFlameView(const ProfilerFrame& frame) noexcept
+{
+	ImGui::BeginChild("##flameView", ImVec2(0.f, 0.f), true);
+	auto draw = ImGui::GetWindowDrawList();
+	const float rowHeight = ImGui::GetFontSize() + 4.f;
+	const float width = ImGui::GetContentRegionAvail().x;
+	const double frameTicks = (double)std::max<uint64_t>(frame.end - frame.start, 1);
+	ImVec2 pos = ImGui::GetCursorScreenPos();
+	const float startY = pos.y;
+
+	static std::vector<uint16_t> threads;
+	threads.clear();
+	for (auto& zone : frame.zones) {
+		if (std::find(threads.begin(), threads.end(), zone.thread) == threads.end()) {
+			threads.push_back(zone.thread);
+		}
+	}
+	std::sort(threads.begin(), threads.end());
+
+	auto xFor = [&](uint64_t ticks) noexcept {
+		double rel = ticks > frame.start ? (ticks - frame.start) / frameTicks : 0.0;
+		return pos.x + (float)std::min(rel, 1.0) * width;
+	};
+
+	for (auto thread : threads) {
+		const char* threadName = thread < Profiler.threadNames.size() ? Profiler.threadNames[thread].c_str() : "";
+		draw->AddText(pos, ImGui::GetColorU32(ImGuiCol_TextDisabled), threadName);
+		pos.y += rowHeight;
+
+		uint16_t maxDepth = 0;
+		for (auto& zone : frame.zones) {
+			if (zone.thread != thread) continue;
+			maxDepth = std::max(maxDepth, zone.depth);
+
+			ImVec2 p1(xFor(zone.start), pos.y + zone.depth * rowHeight);
+			ImVec2 p2(std::max(xFor(zone.end), p1.x + 1.f), p1.y + rowHeight - 1.f);
+			draw->AddRectFilled(p1, p2, zoneColor(zone.name));
+			if (p2.x - p1.x > ImGui::GetFontSize()) {
+				draw->PushClipRect(p1, p2, true);
+				draw->AddText(ImVec2(p1.x + 2.f, p1.y + 2.f), IM_COL32_BLACK, zone.name);
+				draw->PopClipRect();
+			}
+			if (ImGui::IsWindowHovered() && ImGui::IsMouseHoveringRect(p1, p2)) {
+				ImGui::SetTooltip("%s\n%.3f ms", zone.name, ticksToMs(zone.end - zone.start));
+			}
+		}
+		pos.y += (maxDepth + 1) * rowHeight + ImGui::GetStyle().ItemSpacing.y;
+	}
+	ImGui::Dummy(ImVec2(width, pos.y - startY));
+	ImGui::EndChild();
+}
+
+void OFS_Profiler::ShowProfilerWindow(bool* open) noexcept
+{
+	SetRecording(*open && !Profiler.paused);
+	if (!*open) return;
+	OFS_PROFILE(__FUNCTION__);
+	ImGui::Begin(TR_ID(WindowId, Tr::PROFILER), open);
+
+	if (ImGui::Button(Profiler.paused ? TR(RESUME) : TR(PAUSE))) {
+		Profiler.paused = !Profiler.paused;
+		if (!Profiler.paused) {
+			Profiler.frameSelected = false;
+		}
+	}
+	ImGui::SameLine();
+	if (ImGui::Button(TR(CLEAR))) {
+		Profiler.frameCount = 0;
+		Profiler.droppedZones = 0;
+		Profiler.frameSelected = false;
+	}
+	ImGui::SameLine();
+	if (ImGui::Button(TR(EXPORT_CHROME_TRACE))) {
+		Util::SaveFileDialog(TR(EXPORT_CHROME_TRACE), Util::Prefpath("trace.json"),
+			[](auto& result) {
+				if (!result.files.empty()) {
+					if (!OFS_Profiler::ExportChromeTrace(result.files[0])) {
+						LOGF_ERROR("Failed to export trace to \"%s\"", result.files[0].c_str());
+					}
+				}
+			},
+			{ "*.json" }, "Chrome trace (*.json)");
+	}
+
+	const size_t frames = Profiler.AvailableFrames();
+	if (frames == 0) {
+		ImGui::TextDisabled("%s", TR(PROFILER_NO_DATA));
+		ImGui::End();
+		return;
+	}
+
+	uint64_t totalTicks = 0;
+	for (size_t frameIdx = Profiler.OldestFrame(); frameIdx < Profiler.frameCount; frameIdx += 1) {
+		auto& frame = Profiler.Frame(frameIdx);
+		totalTicks += frame.end - frame.start;
+	}
+	ImGui::Text("%s: %.3f ms", TR(PROFILER_AVG_FRAME), ticksToMs(totalTicks) / frames);
+	if (Profiler.droppedZones > 0) {
+		ImGui::SameLine();
+		ImGui::TextDisabled("(%s: %u)", TR(PROFILER_DROPPED_ZONES), Profiler.droppedZones);
+	}
+
+	drawFrameHistogram(ImGui::GetFontSize() * 4.f);
+
+	if (Profiler.frameSelected && Profiler.selectedFrame < Profiler.OldestFrame()) {
+		Profiler.frameSelected = false;
+	}
+	if (ImGui::BeginTabBar("##profilerTabs")) {
+		if (ImGui::BeginTabItem(TR(PROFILER_TOP_ZONES))) {
+			drawTopZones();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem(TR(PROFILER_FLAME_VIEW))) {
+			size_t frameIdx = Profiler.frameSelected ? Profiler.selectedFrame : Profiler.frameCount - 1;
+			auto& frame = Profiler.Frame(frameIdx);
+			ImGui::Text("%s %zu: %.3f ms", TR(PROFILER_FRAME), frameIdx, ticksToMs(frame.end - frame.start));
+			drawFlameView(frame);
+			ImGui::EndTabItem();
+		}
+		ImGui::EndTabBar();
+	}
+
+	ImGui::End();
+}
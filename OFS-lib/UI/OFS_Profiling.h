@@ -1,6 +1,11 @@
 #pragma once
 #if OFS_PROFILE_ENABLED == 1
 #include "tracy/Tracy.hpp"
+#else
+#include "SDL_timer.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
 #endif
 
 #if OFS_PROFILE_ENABLED == 1
@@ -17,15 +22,62 @@ public:
 		//FrameMarkEnd(nullptr);
 	}
 };
+#else
+// Built-in profiler used when Tracy isn't compiled in.
+// Zones get written into a ring buffer per thread and are collected
+// by the main thread at the end of every frame.
+// Nothing gets recorded unless the profiler window is open.
+class OFS_Profiler
+{
+private:
+	static std::atomic<bool> recording;
+public:
+	static constexpr const char* WindowId = "###PROFILER";
+	static thread_local uint32_t ZoneDepth;
+
+	inline static bool IsRecording() noexcept { return recording.load(std::memory_order_relaxed); }
+	static void SetRecording(bool record) noexcept;
+
+	static void BeginProfiling() noexcept;
+	static void EndProfiling() noexcept;
+	static void RecordZone(const char* name, uint64_t start, uint64_t end) noexcept;
+
+	static bool ExportChromeTrace(const std::string& path) noexcept;
+	static void ShowProfilerWindow(bool* open) noexcept;
+};
+
+class OFS_ProfileScope
+{
+private:
+	const char* name;
+	uint64_t start = 0;
+public:
+	inline explicit OFS_ProfileScope(const char* name) noexcept
+		: name(name)
+	{
+		if (OFS_Profiler::IsRecording()) {
+			OFS_Profiler::ZoneDepth += 1;
+			start = SDL_GetPerformanceCounter();
+		}
+	}
+	inline ~OFS_ProfileScope() noexcept
+	{
+		if (start != 0) {
+			OFS_Profiler::RecordZone(name, start, SDL_GetPerformanceCounter());
+		}
+	}
+};
 #endif
 
+#define OFS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define OFS_PROFILE_CONCAT(a, b) OFS_PROFILE_CONCAT_IMPL(a, b)
+
 #if OFS_PROFILE_ENABLED == 1
 #define OFS_PROFILE(name) ZoneScopedN(name)
 #define OFS_BEGINPROFILING() OFS_Profiler::BeginProfiling()
 #define OFS_ENDPROFILING() OFS_Profiler::EndProfiling();
 #else
-#define OFS_PROFILE(name)
-#define OFS_BEGINPROFILING()
-#define OFS_ENDPROFILING()
+#define OFS_PROFILE(name) OFS_ProfileScope OFS_PROFILE_CONCAT(ofsProfileScope, __LINE__)(name)
+#define OFS_BEGINPROFILING() OFS_Profiler::BeginProfiling()
+#define OFS_ENDPROFILING() OFS_Profiler::EndProfiling();
 #endif
-
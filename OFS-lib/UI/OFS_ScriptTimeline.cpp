@@ -14,6 +14,7 @@
 
 #include "state/states/BaseOverlayState.h"
 #include "state/states/WaveformState.h"
+#include "OFS_JobSystem.h"
 
 #include "SDL_events.h"
 #include "SDL_timer.h"
@@ -57,6 +58,35 @@ void ScriptTimeline::FfmpegAudioProcessingFinished(const WaveformProcessingFinis
 	LOG_INFO("Audio processing complete.");
 }
 
+void ScriptTimeline::generateAudioWaveform() noexcept
+{
+	Wave.data.SetGenerating(true);
+	auto samples = std::make_shared<std::vector<float>>();
+	OFS_JobSystem::ptr->Submit(TR(GENERATE_WAVEFORM),
+		[videoPath = videoPath, samples](OFS_JobContext& ctx) noexcept
+		{
+			auto ffmpegPath = Util::FfmpegPath();
+			auto outputPath = Util::Prefpath("tmp");
+			if (!Util::CreateDirectories(outputPath)) {
+				return false;
+			}
+			outputPath = (Util::PathFromString(outputPath) / "audio.flac").u8string();
+			ctx.SetDescription(TR(PROCESSING_AUDIO));
+			if (!OFS_Waveform::GenerateFlac(ffmpegPath.u8string(), videoPath, outputPath, ctx)) {
+				return false;
+			}
+			return OFS_Waveform::LoadFlac(outputPath, *samples, &ctx);
+		},
+		[this, samples](const OFS_Job& job) noexcept
+		{
+			Wave.data.SetGenerating(false);
+			if (job.Succeeded()) {
+				Wave.data.SetSamples(std::move(*samples));
+				EV::Enqueue<WaveformProcessingFinishedEvent>();
+			}
+		});
+}
+
 void ScriptTimeline::Init()
 {
 	overlayStateHandle = BaseOverlayState::RegisterStatic();
@@ -459,20 +489,6 @@ void ScriptTimeline::ShowScriptPositions(
 				ImGui::EndMenu();
 			}
 
-			auto updateAudioWaveformThread = [](void* userData) -> int {
-				auto& ctx = *((ScriptTimeline*)userData);
-				std::error_code ec;
-				auto ffmpegPath = Util::FfmpegPath();
-				auto outputPath = Util::Prefpath("tmp");
-				if (!Util::CreateDirectories(outputPath)) {
-					return 0;
-				}
-				
-				outputPath = (Util::PathFromString(outputPath) / "audio.flac").u8string();
-				bool succ = ctx.Wave.data.GenerateAndLoadFlac(ffmpegPath.u8string(), ctx.videoPath, outputPath);
-				EV::Enqueue<WaveformProcessingFinishedEvent>();
-				return 0;
-			};
 			if (ImGui::BeginMenu(TR_ID("WAVEFORM", Tr::WAVEFORM))) {
 				if(ImGui::BeginMenu(TR_ID("SETTINGS", Tr::SETTINGS))) {
 					ImGui::SetNextItemWidth(ImGui::GetFontSize()*5.f);
@@ -500,8 +516,7 @@ void ScriptTimeline::ShowScriptPositions(
 						}
 						else 
 						{
-							auto handle = SDL_CreateThread(updateAudioWaveformThread, "OFS_GenWaveform", this);
-							SDL_DetachThread(handle);
+							generateAudioWaveform();
 						}
 					}
 				}
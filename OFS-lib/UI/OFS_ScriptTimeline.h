@@ -33,6 +33,7 @@ private:
 
 	void updateSelection(const OverlayDrawingCtx& ctx, bool clear) noexcept;
 	void FfmpegAudioProcessingFinished(const WaveformProcessingFinishedEvent* ev) noexcept;
+	void generateAudioWaveform() noexcept;
 
 	std::string videoPath;
 	uint32_t visibleTimeUpdate = 0;
@@ -40,6 +40,10 @@ public:
 	{
 		Heatmap->Update(totalDuration, actions);
 	}
+	inline void UpdateHeatmap(float totalDuration, const FunscriptArray& actions, float fromTime, float toTime) noexcept
+	{
+		Heatmap->Update(totalDuration, actions, fromTime, toTime);
+	}
 
 	void DrawTimeline() noexcept;
 	void DrawControls() noexcept;
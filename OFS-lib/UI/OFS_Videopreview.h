@@ -22,4 +22,5 @@ public:
 	void CloseVideo() noexcept;
 
 	inline uint32_t FrameTex() const noexcept { return player->FrameTexture(); }
+	inline bool HasPendingUpdates() const noexcept { return player->HasPendingUpdates(); }
 };
\ No newline at end of file
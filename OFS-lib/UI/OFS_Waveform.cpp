@@ -3,13 +3,12 @@
 #include "OFS_Profiling.h"
 #include "OFS_GL.h"
 #include "OFS_ScriptTimeline.h"
+#include "OFS_JobSystem.h"
 
 #define DR_FLAC_IMPLEMENTATION
 #include "dr_flac.h"
 
-#include "subprocess.h"
-
-bool OFS_Waveform::LoadFlac(const std::string& output) noexcept
+bool OFS_Waveform::LoadFlac(const std::string& output, std::vector<float>& samples, OFS_JobContext* ctx) noexcept
 {
 	drflac* flac = drflac_open_file(output.c_str(), NULL);
 	if (!flac) return false;
@@ -21,8 +20,9 @@ bool OFS_Waveform::LoadFlac(const std::string& output) noexcept
 	float maxSample = 0.f;
 
 	uint32_t sampleCount = 0;
+	uint64_t samplesRead = 0;
 	float avgSample = 0.f;
-	Clear();
+	samples.clear();
 	samples.reserve(flac->totalPCMFrameCount / SamplesPerLine);
 	while ((sampleCount = drflac_read_pcm_frames_s16(flac, ChunkSamples.size(), ChunkSamples.data())) > 0) {
 		for (int sampleIdx = 0; sampleIdx < sampleCount; sampleIdx += SamplesPerLine) {
@@ -39,6 +39,15 @@ bool OFS_Waveform::LoadFlac(const std::string& output) noexcept
 			samples.emplace_back(avgSample);
 			avgSample = 0.f;
 		}
+		samplesRead += sampleCount;
+		if (ctx) {
+			if (ctx->ShouldCancel()) {
+				drflac_close(flac);
+				samples.clear();
+				return false;
+			}
+			ctx->SetProgress(samplesRead / ChunkSamples.size(), flac->totalPCMFrameCount / ChunkSamples.size());
+		}
 	}
 	drflac_close(flac);
 	samples.shrink_to_fit();
@@ -57,10 +66,8 @@ bool OFS_Waveform::LoadFlac(const std::string& output) noexcept
 	return true;
 }
 
-bool OFS_Waveform::GenerateAndLoadFlac(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output) noexcept
+bool OFS_Waveform::GenerateFlac(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output, OFS_JobContext& ctx) noexcept
 {
-	generating = true;
-
 	std::array<const char*, 11> args =
 	{
 		ffmpegPath.c_str(),
@@ -73,35 +80,8 @@ bool OFS_Waveform::GenerateAndLoadFlac(const std::string& ffmpegPath, const std:
 		output.c_str(),
 		nullptr
 	};
-	struct subprocess_s proc;
-	if(subprocess_create(args.data(), subprocess_option_no_window, &proc) != 0) {
-		generating = false; 
-		return false; 
-	}
-
-	if(proc.stdout_file) 
-	{
-		fclose(proc.stdout_file);
-		proc.stdout_file = nullptr;
-	}
-	
-	if(proc.stderr_file) 
-	{
-		fclose(proc.stderr_file);
-		proc.stderr_file = nullptr;
-	}
-
-	int return_code;
-	subprocess_join(&proc, &return_code);
-	subprocess_destroy(&proc);
-
-	if (!LoadFlac(output)) {
-		generating = false;
-		return false;
-	}
-
-	generating = false;
-	return true;
+	int returnCode;
+	return ctx.RunProcess(args.data(), &returnCode) && returnCode == 0;
 }
 
 void OFS_WaveformLOD::Init() noexcept
@@ -18,8 +18,12 @@ class OFS_Waveform
 public:
 
 	inline bool BusyGenerating() noexcept { return generating; }
-	bool GenerateAndLoadFlac(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output) noexcept;
-	bool LoadFlac(const std::string& path) noexcept;
+	inline void SetGenerating(bool busy) noexcept { generating = busy; }
+
+	// These are safe to call from a job, they don't touch any waveform state.
+	static bool GenerateFlac(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output, class OFS_JobContext& ctx) noexcept;
+	static bool LoadFlac(const std::string& path, std::vector<float>& outSamples, class OFS_JobContext* ctx = nullptr) noexcept;
+	inline bool LoadFlac(const std::string& path) noexcept { return LoadFlac(path, samples); }
 
 	inline void Clear() noexcept {
 		samples.clear();
@@ -31,6 +35,7 @@ public:
 	}
 
 	inline const std::vector<float>& Samples() const noexcept { return samples; }
+	inline size_t MemoryUsage() const noexcept { return samples.capacity() * sizeof(float); }
 
 	inline size_t SampleCount() const noexcept {
 		return samples.size();
@@ -54,4 +59,10 @@ struct OFS_WaveformLOD
 	void Init() noexcept;
 	void Update(const class OverlayDrawingCtx& ctx) noexcept;
 	void Upload() noexcept;
+
+	// The line buffer also exists as a texture on the gpu
+	inline size_t MemoryUsage() const noexcept
+	{
+		return data.MemoryUsage() + WaveformLineBuffer.capacity() * sizeof(float) * 2;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "OFS_EventBenchmark.h"
+#include "OFS_EventSystem.h"
+#include "OFS_MpscRing.h"
+#include "OFS_FileLogging.h"
+#include "OFS_Util.h"
+
+#include "SDL_atomic.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+
+#include <atomic>
+
+class BenchmarkEvent : public OFS_Event<BenchmarkEvent>
+{
+    public:
+    uint32_t value;
+    BenchmarkEvent(uint32_t value) noexcept
+        : value(value) {}
+};
+
+struct BenchmarkContext
+{
+    std::atomic<bool> go = false;
+    int eventsPerProducer = 0;
+    void* target = nullptr;
+    void (*produce)(void* target, uint32_t value) noexcept = nullptr;
+};
+
+static int ProducerThread(void* user) noexcept
+{
+    auto ctx = static_cast<BenchmarkContext*>(user);
+    while(!ctx->go) { OFS_PAUSE_INTRIN(); }
+    for(int i = 0; i < ctx->eventsPerProducer; i += 1)
+    {
+        ctx->produce(ctx->target, i);
+    }
+    return 0;
+}
+
+template<typename Consume>
+static OFS_EventBenchmarkResult RunStrategy(const char* name, int producers, int eventsPerProducer,
+    void* target, void (*produce)(void*, uint32_t) noexcept, Consume&& consume) noexcept
+{
+    BenchmarkContext ctx;
+    ctx.eventsPerProducer = eventsPerProducer;
+    ctx.target = target;
+    ctx.produce = produce;
+
+    std::vector<SDL_Thread*> threads;
+    for(int i = 0; i < producers; i += 1)
+    {
+        threads.emplace_back(SDL_CreateThread(ProducerThread, "EventBenchmarkProducer", &ctx));
+    }
+
+    const uint64_t total = (uint64_t)producers * eventsPerProducer;
+    uint64_t consumed = 0;
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    ctx.go = true;
+    while(consumed < total)
+    {
+        consumed += consume();
+    }
+    uint64_t end = SDL_GetPerformanceCounter();
+
+    for(auto thread : threads)
+    {
+        SDL_WaitThread(thread, nullptr);
+    }
+
+    OFS_EventBenchmarkResult result;
+    result.name = name;
+    result.events = consumed;
+    result.seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+    return result;
+}
+
+std::vector<OFS_EventBenchmarkResult> OFS_EventBenchmark::Run(int producers, int eventsPerProducer) noexcept
+{
+    std::vector<OFS_EventBenchmarkResult> results;
+
+    // OFS_MpscRing as used by EV::Post
+    {
+        OFS_MpscRing<EventPointer> ring(EV::IngestCapacity);
+        auto produce = [](void* target, uint32_t value) noexcept
+        {
+            auto ring = static_cast<OFS_MpscRing<EventPointer>*>(target);
+            auto ev = EV::Make<BenchmarkEvent>(value);
+            while(!ring->TryPush(std::move(ev))) { OFS_PAUSE_INTRIN(); }
+        };
+        results.emplace_back(RunStrategy("OFS_MpscRing", producers, eventsPerProducer, &ring, produce,
+            [&ring]() noexcept
+            {
+                uint64_t count = 0;
+                EventPointer ev;
+                while(ring.TryPop(ev)) count += 1;
+                return count;
+            }));
+    }
+
+    // SDL_SpinLock guarded vector as used by EventSerializationContext & OFS_FileLogger
+    {
+        struct SpinlockVector
+        {
+            SDL_SpinLock lock = {0};
+            std::vector<EventPointer> events;
+        } spinVec;
+        auto produce = [](void* target, uint32_t value) noexcept
+        {
+            auto spinVec = static_cast<SpinlockVector*>(target);
+            auto ev = EV::Make<BenchmarkEvent>(value);
+            SDL_AtomicLock(&spinVec->lock);
+            spinVec->events.emplace_back(std::move(ev));
+            SDL_AtomicUnlock(&spinVec->lock);
+        };
+        std::vector<EventPointer> drained;
+        results.emplace_back(RunStrategy("SDL_SpinLock vector", producers, eventsPerProducer, &spinVec, produce,
+            [&spinVec, &drained]() noexcept
+            {
+                SDL_AtomicLock(&spinVec.lock);
+                drained.swap(spinVec.events);
+                SDL_AtomicUnlock(&spinVec.lock);
+                uint64_t count = drained.size();
+                drained.clear();
+                return count;
+            }));
+    }
+
+    // eventpp queue as used by EV::Enqueue
+    {
+        OFS_EventQueue queue;
+        uint64_t handled = 0;
+        queue.appendListener(BenchmarkEvent::EventType, BenchmarkEvent::HandleEvent(
+            [&handled](const BenchmarkEvent* ev) noexcept { handled += 1; }));
+        auto produce = [](void* target, uint32_t value) noexcept
+        {
+            auto queue = static_cast<OFS_EventQueue*>(target);
+            queue->enqueue(EV::Make<BenchmarkEvent>(value));
+        };
+        results.emplace_back(RunStrategy("eventpp EventQueue", producers, eventsPerProducer, &queue, produce,
+            [&queue, &handled]() noexcept
+            {
+                handled = 0;
+                queue.process();
+                return handled;
+            }));
+    }
+
+    return results;
+}
+
+void OFS_EventBenchmark::RunAndLog(int producers, int eventsPerProducer) noexcept
+{
+    LOGF_INFO("Event ingestion benchmark: %d producers, %d events each", producers, eventsPerProducer);
+    auto results = Run(producers, eventsPerProducer);
+    for(auto& result : results)
+    {
+        LOGF_INFO("%-20s %8.2f ms %12.0f events/s", result.name, result.seconds * 1000.0, result.EventsPerSecond());
+    }
+}
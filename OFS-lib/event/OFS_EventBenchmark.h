@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Measures how fast worker threads can hand events to a single consumer
+// using the different ingestion paths which exist in the codebase.
+struct OFS_EventBenchmarkResult
+{
+    const char* name = "";
+    uint64_t events = 0;
+    double seconds = 0.0;
+
+    inline double EventsPerSecond() const noexcept { return seconds > 0.0 ? events / seconds : 0.0; }
+};
+
+class OFS_EventBenchmark
+{
+    public:
+    static std::vector<OFS_EventBenchmarkResult> Run(int producers, int eventsPerProducer) noexcept;
+    static void RunAndLog(int producers = 4, int eventsPerProducer = 100000) noexcept;
+};
@@ -12,6 +12,30 @@ static void deferHandler(const OFS_DeferEvent* ev) noexcept
     ev->Function();
 }
 
+void EV::Post(EventPointer ev) noexcept
+{
+    auto self = Get();
+    if(!self->ingest.TryPush(std::move(ev)))
+    {
+        // The ring is full. Fall back to the locking queue instead of dropping the event.
+        // TryPush doesn't touch the value when failing.
+        self->queue.enqueue(ev);
+    }
+}
+
+bool EV::process() noexcept
+{
+    bool dispatched = false;
+    EventPointer ev;
+    while(ingest.TryPop(ev))
+    {
+        queue.directDispatch(ev->Type(), ev);
+        dispatched = true;
+    }
+    ingestFallbacks = ingest.FailedPushes();
+    return queue.process() || dispatched;
+}
+
 bool EV::Init() noexcept
 {
     if(!EV::instance)
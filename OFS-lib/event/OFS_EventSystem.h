@@ -1,6 +1,7 @@
 #pragma once
 
 #include "OFS_Event.h"
+#include "OFS_MpscRing.h"
 #include "eventpp/eventqueue.h"
 #include <vector>
 
@@ -21,11 +22,18 @@ class EV
     static EV* instance;
     static uint32_t eventCounter;
     OFS_EventQueue queue;
-    inline bool process() noexcept { return queue.process(); }
+    // Events posted by worker threads. Drained by the main thread in Process.
+    OFS_MpscRing<EventPointer> ingest;
+    uint32_t ingestFallbacks = 0;
+
+    EV() noexcept : ingest(IngestCapacity) {}
+    bool process() noexcept;
     public:
+    static constexpr size_t IngestCapacity = 4096;
 
     static bool Init() noexcept;
-    inline static void Process() noexcept { Get()->process(); }
+    // Returns true if any event was dispatched.
+    inline static bool Process() noexcept { return Get()->process(); }
     inline static OFS_EventType RegisterEvent() noexcept { return ++eventCounter; }
 
     inline static EV* Get() noexcept { return instance; }
@@ -64,6 +72,24 @@ class EV
     {
         Queue().enqueue(ev);
     }
+
+    // Lock-free path for worker threads.
+    // The event gets dispatched on the main thread during the next EV::Process.
+    template<typename Event, typename... Args>
+    inline static void Post(Args&&... args) noexcept
+    {
+        Post(Make<Event>(std::forward<Args>(args)...));
+    }
+    static void Post(EventPointer ev) noexcept;
+
+    // Runs the function on the main thread during the next EV::Process.
+    inline static void Defer(OFS_DeferEventFn&& fn) noexcept
+    {
+        Post<OFS_DeferEvent>(std::move(fn));
+    }
+
+    inline static size_t IngestSize() noexcept { return Get()->ingest.SizeApprox(); }
+    inline static uint32_t IngestFallbacks() noexcept { return Get()->ingestFallbacks; }
 };
 
 #define EVENT_SYSTEM_BIND(listener, handler) std::move(std::bind(handler, listener, std::placeholders::_1))
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free multi-producer single-consumer ring.
+// Based on Dmitry Vyukov's bounded queue, every cell carries a sequence number
+// which tells producers and the consumer whether the cell is free or filled.
+// Any thread may call TryPush, only one thread may call TryPop at a time.
+template<typename T>
+class OFS_MpscRing
+{
+    private:
+    static constexpr size_t CacheLine = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> buffer;
+    size_t mask = 0;
+
+    alignas(CacheLine) std::atomic<size_t> enqueuePos = 0;
+    alignas(CacheLine) size_t dequeuePos = 0;
+    alignas(CacheLine) std::atomic<uint32_t> failedPushes = 0;
+
+    public:
+    // capacity gets rounded up to the next power of two
+    explicit OFS_MpscRing(size_t capacity) noexcept
+    {
+        size_t size = 2;
+        while(size < capacity) size <<= 1;
+        mask = size - 1;
+        buffer = std::make_unique<Cell[]>(size);
+        for(size_t i = 0; i < size; i += 1) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    OFS_MpscRing(const OFS_MpscRing&) = delete;
+    OFS_MpscRing(OFS_MpscRing&&) = delete;
+
+    // Returns false when the ring is full. The value is left untouched in that case.
+    bool TryPush(T&& value) noexcept
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for(;;) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0) {
+                if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0) {
+                failedPushes.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Must only be called by the single consumer.
+    bool TryPop(T& value) noexcept
+    {
+        Cell* cell = &buffer[dequeuePos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(dequeuePos + 1);
+        if(diff < 0) return false;
+
+        value = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        dequeuePos += 1;
+        return true;
+    }
+
+    // Approximate, only meant for statistics. Called by the consumer.
+    inline size_t SizeApprox() const noexcept
+    {
+        size_t enq = enqueuePos.load(std::memory_order_relaxed);
+        return enq >= dequeuePos ? enq - dequeuePos : 0;
+    }
+    inline size_t Capacity() const noexcept { return mask + 1; }
+    inline uint32_t FailedPushes() const noexcept { return failedPushes.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,260 @@
+#include "OFS_JobSystem.h"
+#include "OFS_EventSystem.h"
+#include "OFS_Localization.h"
+#include "OFS_ImGui.h"
+#include "OFS_Util.h"
+
+#include "SDL_cpuinfo.h"
+#include "SDL_timer.h"
+
+#include "imgui.h"
+#include "subprocess.h"
+
+#include <algorithm>
+
+OFS_JobSystem* OFS_JobSystem::ptr = nullptr;
+
+// Finished jobs stay visible in the jobs window for this long
+static constexpr uint32_t KeepFinishedJobsMs = 10000;
+
+bool OFS_JobContext::ShouldCancel() const noexcept
+{
+    return job->cancelRequested;
+}
+
+void OFS_JobContext::SetProgress(uint32_t progress, uint32_t maxProgress) noexcept
+{
+    job->maxProgress = maxProgress;
+    job->progress = progress;
+}
+
+void OFS_JobContext::SetDescription(const std::string& description) noexcept
+{
+    SDL_AtomicLock(&job->descriptionLock);
+    job->description = description;
+    SDL_AtomicUnlock(&job->descriptionLock);
+}
+
+bool OFS_JobContext::RunProcess(const char* const args[], int* returnCode) noexcept
+{
+    struct subprocess_s proc;
+    if(subprocess_create(args, subprocess_option_no_window, &proc) != 0) {
+        return false;
+    }
+
+    if(proc.stdout_file) {
+        fclose(proc.stdout_file);
+        proc.stdout_file = nullptr;
+    }
+
+    if(proc.stderr_file) {
+        fclose(proc.stderr_file);
+        proc.stderr_file = nullptr;
+    }
+
+    bool terminated = false;
+    while(subprocess_alive(&proc)) {
+        if(ShouldCancel()) {
+            subprocess_terminate(&proc);
+            terminated = true;
+            break;
+        }
+        SDL_Delay(20);
+    }
+
+    int code = -1;
+    subprocess_join(&proc, &code);
+    subprocess_destroy(&proc);
+    if(returnCode) *returnCode = code;
+    return !terminated;
+}
+
+std::string OFS_Job::Description() noexcept
+{
+    SDL_AtomicLock(&descriptionLock);
+    auto copy = description;
+    SDL_AtomicUnlock(&descriptionLock);
+    return copy;
+}
+
+bool OFS_JobSystem::Init(int workerCount) noexcept
+{
+    if(ptr) return true;
+    ptr = new OFS_JobSystem();
+    if(workerCount <= 0) {
+        workerCount = Util::Clamp(SDL_GetCPUCount() - 1, 2, 8);
+    }
+    ptr->pendingMut = SDL_CreateMutex();
+    ptr->pendingCond = SDL_CreateCond();
+    for(int i = 0; i < workerCount; i += 1) {
+        auto thread = SDL_CreateThread(workerThread, "OFS_JobWorker", ptr);
+        if(!thread) {
+            LOGF_ERROR("Failed to create job worker. %s", SDL_GetError());
+            continue;
+        }
+        ptr->workers.emplace_back(thread);
+    }
+    LOGF_INFO("Started %d job workers.", (int)ptr->workers.size());
+    return !ptr->workers.empty();
+}
+
+void OFS_JobSystem::Shutdown() noexcept
+{
+    if(!ptr) return;
+    for(auto& job : ptr->jobs) {
+        job->Cancel();
+    }
+    // Workers drain the remaining queue before exiting.
+    // Jobs which aren't cancellable like saves still get to finish.
+    SDL_LockMutex(ptr->pendingMut);
+    ptr->shouldExit = true;
+    SDL_CondBroadcast(ptr->pendingCond);
+    SDL_UnlockMutex(ptr->pendingMut);
+
+    for(auto thread : ptr->workers) {
+        SDL_WaitThread(thread, nullptr);
+    }
+    SDL_DestroyCond(ptr->pendingCond);
+    SDL_DestroyMutex(ptr->pendingMut);
+    delete ptr;
+    ptr = nullptr;
+}
+
+int OFS_JobSystem::workerThread(void* user) noexcept
+{
+    auto self = static_cast<OFS_JobSystem*>(user);
+    for(;;) {
+        OFS_JobHandle job;
+        SDL_LockMutex(self->pendingMut);
+        while(self->pending.empty() && !self->shouldExit) {
+            SDL_CondWait(self->pendingCond, self->pendingMut);
+        }
+        if(self->pending.empty()) {
+            SDL_UnlockMutex(self->pendingMut);
+            break;
+        }
+        job = std::move(self->pending.front());
+        self->pending.pop_front();
+        SDL_UnlockMutex(self->pendingMut);
+
+        self->busyWorkers += 1;
+        self->runJob(job);
+        self->busyWorkers -= 1;
+    }
+    return 0;
+}
+
+void OFS_JobSystem::runJob(OFS_JobHandle& job) noexcept
+{
+    if(job->cancelRequested) {
+        job->status = OFS_JobStatus::Cancelled;
+    }
+    else {
+        job->status = OFS_JobStatus::Running;
+        OFS_JobContext ctx(job.get());
+        bool succ = job->work(ctx);
+        job->status = job->cancelRequested
+            ? OFS_JobStatus::Cancelled
+            : succ ? OFS_JobStatus::Finished : OFS_JobStatus::Failed;
+    }
+    // Release whatever the job function captured on the worker
+    job->work = OFS_JobFn();
+
+    if(shouldExit) return;
+    EV::Defer([job]() noexcept {
+        job->doneTicks = SDL_GetTicks();
+        if(job->continuation) {
+            job->continuation(*job);
+            job->continuation = OFS_JobContinuation();
+        }
+        job->completed = true;
+    });
+}
+
+OFS_JobHandle OFS_JobSystem::Submit(const std::string& name, OFS_JobFn&& work, OFS_JobContinuation&& continuation) noexcept
+{
+    FUN_ASSERT(Util::InMainThread(), "Jobs must be submitted on the main thread.");
+    auto job = std::make_shared<OFS_Job>();
+    job->name = name;
+    job->work = std::move(work);
+    job->continuation = std::move(continuation);
+    job->submitTicks = SDL_GetTicks();
+
+    auto it = std::remove_if(jobs.begin(), jobs.end(),
+        [now = job->submitTicks](auto& job) noexcept {
+            return job->Completed() && now - job->doneTicks > KeepFinishedJobsMs;
+        });
+    jobs.erase(it, jobs.end());
+    jobs.emplace_back(job);
+
+    SDL_LockMutex(pendingMut);
+    pending.emplace_back(job);
+    SDL_CondSignal(pendingCond);
+    SDL_UnlockMutex(pendingMut);
+    return job;
+}
+
+int32_t OFS_JobSystem::ActiveJobs() const noexcept
+{
+    return (int32_t)std::count_if(jobs.begin(), jobs.end(),
+        [](auto& job) noexcept { return !job->Completed(); });
+}
+
+static const char* JobStatusString(OFS_JobStatus status) noexcept
+{
+    switch(status) {
+        case OFS_JobStatus::Queued: return TR(JOB_QUEUED);
+        case OFS_JobStatus::Running: return TR(JOB_RUNNING);
+        case OFS_JobStatus::Finished: return TR(JOB_FINISHED);
+        case OFS_JobStatus::Failed: return TR(JOB_FAILED);
+        case OFS_JobStatus::Cancelled: return TR(JOB_CANCELLED);
+    }
+    return "";
+}
+
+void OFS_JobSystem::ShowJobsWindow(bool* open) noexcept
+{
+    if(!*open) return;
+    OFS_PROFILE(__FUNCTION__);
+    ImGui::Begin(TR_ID(WindowId, Tr::JOBS), open);
+    ImGui::Text("%s: %d/%d", TR(JOB_WORKERS), BusyWorkers(), WorkerCount());
+    ImGui::Separator();
+
+    if(std::all_of(jobs.begin(), jobs.end(), [](auto& job) noexcept { return job->Hidden; })) {
+        ImGui::TextDisabled("%s", TR(NO_JOBS));
+    }
+
+    for(int i = (int)jobs.size() - 1; i >= 0; i -= 1) {
+        auto& job = jobs[i];
+        if(job->Hidden) continue;
+        ImGui::PushID(job.get());
+        auto status = job->Status();
+        ImGui::TextUnformatted(job->Name().c_str());
+        ImGui::SameLine();
+        ImGui::TextDisabled("(%s)", JobStatusString(status));
+
+        if(status == OFS_JobStatus::Running || status == OFS_JobStatus::Queued) {
+            auto description = job->Description();
+            float progress = job->Progress();
+            if(progress >= 0.f) {
+                ImGui::ProgressBar(progress, ImVec2(-ImGui::GetFontSize() * 5.f, 0.f),
+                    description.empty() ? nullptr : description.c_str());
+            }
+            else {
+                OFS::Spinner("##jobSpinner", ImGui::GetFontSize() / 3.f, 4.f, ImGui::GetColorU32(ImGuiCol_ButtonActive));
+                if(!description.empty()) {
+                    ImGui::SameLine();
+                    ImGui::TextUnformatted(description.c_str());
+                }
+            }
+            if(job->Cancellable) {
+                ImGui::SameLine();
+                if(ImGui::Button(TR(CANCEL), ImVec2(-1.f, 0.f))) {
+                    job->Cancel();
+                }
+            }
+        }
+        ImGui::PopID();
+    }
+    ImGui::End();
+}
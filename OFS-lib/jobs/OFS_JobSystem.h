@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+
+enum class OFS_JobStatus : uint8_t
+{
+    Queued,
+    Running,
+    Finished,
+    Failed,
+    Cancelled
+};
+
+class OFS_Job;
+using OFS_JobHandle = std::shared_ptr<OFS_Job>;
+
+// Passed to the job function. Used to report progress and check for cancellation.
+class OFS_JobContext
+{
+    private:
+    OFS_Job* job;
+    public:
+    OFS_JobContext(OFS_Job* job) noexcept
+        : job(job) {}
+
+    bool ShouldCancel() const noexcept;
+    void SetProgress(uint32_t progress, uint32_t maxProgress) noexcept;
+    void SetDescription(const std::string& description) noexcept;
+
+    // Runs a child process to completion with stdout & stderr closed.
+    // The process gets terminated when the job is cancelled.
+    // Returns false if the process couldn't be started or was terminated.
+    bool RunProcess(const char* const args[], int* returnCode) noexcept;
+};
+
+// Runs on a worker thread. The return value indicates success.
+using OFS_JobFn = std::function<bool(OFS_JobContext& ctx)>;
+// Runs on the main thread after the job is done. Also called for failed and cancelled jobs.
+using OFS_JobContinuation = std::function<void(const OFS_Job& job)>;
+
+class OFS_Job
+{
+    friend class OFS_JobSystem;
+    friend class OFS_JobContext;
+    private:
+    std::string name;
+    std::string description;
+    SDL_SpinLock descriptionLock = {0};
+
+    OFS_JobFn work;
+    OFS_JobContinuation continuation;
+
+    std::atomic<OFS_JobStatus> status = OFS_JobStatus::Queued;
+    std::atomic<uint32_t> progress = 0;
+    std::atomic<uint32_t> maxProgress = 0;
+    std::atomic<bool> cancelRequested = false;
+    // Set after the continuation ran on the main thread
+    bool completed = false;
+    uint32_t submitTicks = 0;
+    uint32_t doneTicks = 0;
+
+    public:
+    bool Cancellable = true;
+    // Not listed in the jobs window, for short lived jobs which get started often
+    bool Hidden = false;
+
+    inline const std::string& Name() const noexcept { return name; }
+    std::string Description() noexcept;
+
+    inline OFS_JobStatus Status() const noexcept { return status; }
+    inline bool Done() const noexcept
+    {
+        auto s = Status();
+        return s == OFS_JobStatus::Finished || s == OFS_JobStatus::Failed || s == OFS_JobStatus::Cancelled;
+    }
+    inline bool Succeeded() const noexcept { return Status() == OFS_JobStatus::Finished; }
+    inline bool Completed() const noexcept { return completed; }
+
+    inline float Progress() const noexcept
+    {
+        uint32_t max = maxProgress;
+        return max > 0 ? (float)progress / (float)max : -1.f;
+    }
+    inline uint32_t ProgressCount() const noexcept { return progress; }
+    inline uint32_t MaxProgressCount() const noexcept { return maxProgress; }
+
+    inline void Cancel() noexcept { if(Cancellable) cancelRequested = true; }
+    inline bool CancelRequested() const noexcept { return cancelRequested; }
+};
+
+// Fixed size worker pool for long running work.
+// Jobs get picked up in submission order.
+class OFS_JobSystem
+{
+    private:
+    std::vector<SDL_Thread*> workers;
+    std::deque<OFS_JobHandle> pending;
+    SDL_mutex* pendingMut = nullptr;
+    SDL_cond* pendingCond = nullptr;
+    std::atomic<bool> shouldExit = false;
+    std::atomic<int32_t> busyWorkers = 0;
+
+    // Only accessed by the main thread
+    std::vector<OFS_JobHandle> jobs;
+
+    static int workerThread(void* user) noexcept;
+    void runJob(OFS_JobHandle& job) noexcept;
+
+    public:
+    static OFS_JobSystem* ptr;
+    static constexpr const char* WindowId = "###JOBS";
+
+    static bool Init(int workerCount = 0) noexcept;
+    static void Shutdown() noexcept;
+
+    OFS_JobSystem() noexcept = default;
+    OFS_JobSystem(const OFS_JobSystem&) = delete;
+    OFS_JobSystem(OFS_JobSystem&&) = delete;
+
+    // Must be called on the main thread.
+    OFS_JobHandle Submit(const std::string& name, OFS_JobFn&& work, OFS_JobContinuation&& continuation = {}) noexcept;
+
+    inline int32_t WorkerCount() const noexcept { return (int32_t)workers.size(); }
+    inline int32_t BusyWorkers() const noexcept { return busyWorkers; }
+    int32_t ActiveJobs() const noexcept;
+
+    void ShowJobsWindow(bool* open) noexcept;
+};
@@ -150,4 +150,16 @@ void OFS_StateManager::ClearProjectAll() noexcept
     ProjectState.clear();
     // Initialize with defaults
     DeserializeStateCollection(nlohmann::json::object(), ProjectState, ProjectHandleMap, false);
+}
+
+size_t OFS_StateManager::MemoryUsage() const noexcept
+{
+    size_t bytes = 0;
+    for (auto& state : ApplicationState) {
+        bytes += sizeof(OFS_State) + state.Metadata->MemoryUsage(state.State);
+    }
+    for (auto& state : ProjectState) {
+        bytes += sizeof(OFS_State) + state.Metadata->MemoryUsage(state.State);
+    }
+    return bytes;
 }
\ No newline at end of file
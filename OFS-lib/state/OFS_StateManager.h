@@ -7,6 +7,23 @@
 #include <any>
 #include <map>
 
+namespace OFS_StateMemory
+{
+    // Rough estimate of the heap memory owned by a state field.
+    template<typename T>
+    inline size_t HeapSize(const T&) noexcept { return 0; }
+
+    inline size_t HeapSize(const std::string& str) noexcept { return str.capacity(); }
+
+    template<typename T, typename Allocator>
+    inline size_t HeapSize(const std::vector<T, Allocator>& vec) noexcept
+    {
+        size_t bytes = vec.capacity() * sizeof(T);
+        for (auto& item : vec) bytes += HeapSize(item);
+        return bytes;
+    }
+}
+
 class OFS_StateMetadata
 {
     public:
@@ -19,6 +36,7 @@ class OFS_StateMetadata
         md.creator = &OFS_StateMetadata::createUntyped<T>;
         md.serializer = &OFS_StateMetadata::serializeUntyped<T>;
         md.deserializer = &OFS_StateMetadata::deserializeUntyped<T>;
+        md.memoryUsage = &OFS_StateMetadata::memoryUsageUntyped<T>;
         return md;
     }
     
@@ -33,15 +51,21 @@ class OFS_StateMetadata
         return deserializer(value, obj, enableBinary);
     }
 
+    size_t MemoryUsage(const std::any& value) const noexcept {
+        return memoryUsage(value);
+    }
+
     private:
     using OFS_StateCreator = std::any(*)() noexcept;
     using OFS_StateSerializer = bool (*)(const std::any&, nlohmann::json&, bool) noexcept;
     using OFS_StateDeserializer = bool (*)(std::any&, const nlohmann::json&, bool) noexcept;
+    using OFS_StateMemoryUsage = size_t (*)(const std::any&) noexcept;
 
     std::string name;
     OFS_StateCreator creator;
     OFS_StateSerializer serializer;
     OFS_StateDeserializer deserializer;
+    OFS_StateMemoryUsage memoryUsage;
 
     template <typename T>
     static std::any createUntyped() noexcept
@@ -71,6 +95,19 @@ class OFS_StateMetadata
         auto& realValue = std::any_cast<T&>(value);
         return enableBinary ? OFS::Serializer<true>::Deserialize(realValue, obj) : OFS::Serializer<false>::Deserialize(realValue, obj);
     }
+
+    template<typename T>
+    static size_t memoryUsageUntyped(const std::any& value) noexcept
+    {
+        auto& realValue = std::any_cast<const T&>(value);
+        size_t bytes = sizeof(T);
+        for_each(refl::reflect<T>().members, [&](auto member) noexcept {
+            if constexpr (refl::descriptor::is_field(member) && !refl::descriptor::is_static(member)) {
+                bytes += OFS_StateMemory::HeapSize(member(realValue));
+            }
+        });
+        return bytes;
+    }
 };
 
 class OFS_StateRegistry
@@ -186,4 +223,6 @@ class OFS_StateManager
     nlohmann::json SerializeProjectAll(bool enableBinary) noexcept;
     bool DeserializeProjectAll(const nlohmann::json& project, bool enableBinary) noexcept;
     void ClearProjectAll() noexcept;
+
+    size_t MemoryUsage() const noexcept;
 };
@@ -59,6 +59,8 @@ struct WaveformState
         BinSamples = std::move(compressedBin);
     }
 
+    inline size_t MemoryUsage() const noexcept { return BinSamples.capacity() + Filename.capacity(); }
+
     inline static WaveformState& StaticStateSlow() noexcept
     {
         // This shouldn't be done in hot paths but shouldn't be a problem otherwise.
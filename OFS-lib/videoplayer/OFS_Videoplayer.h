@@ -5,6 +5,19 @@
 
 #include "OFS_VideoplayerEvents.h"
 
+// The playback position at a point in time.
+// While playing the position advances with speed from there on.
+struct OFS_PlaybackAnchor
+{
+    double time = 0.0;
+    // SDL_GetPerformanceCounter() when time was valid
+    uint64_t counter = 0;
+    float speed = 1.f;
+    bool paused = true;
+    // Changes with every seek, unlike a jump in time it can't be mistaken for a frame hitch
+    uint32_t seeks = 0;
+};
+
 class OFS_Videoplayer
 {
     private:
@@ -14,6 +27,8 @@ class OFS_Videoplayer
     uint32_t frameTexture = 0;
     // The position which was last requested via any of the seeking functions.
     float logicalPosition = 0.f;
+    // Incremented by all seeking functions, see OFS_PlaybackAnchor
+    uint32_t seekCount = 0;
     // Helper for Mute/Unmute
     float lastVolume = 0.f;
     VideoplayerType playerType;
@@ -53,6 +68,8 @@ class OFS_Videoplayer
     }
     inline void SyncWithPlayerTime() noexcept { SetPositionExact(CurrentPlayerTime()); }
     void Update(float delta) noexcept;
+    // True when the player has events or a new frame which Update hasn't consumed yet.
+    bool HasPendingUpdates() const noexcept;
 
     uint16_t VideoWidth() const noexcept;
     uint16_t VideoHeight() const noexcept;
@@ -70,6 +87,8 @@ class OFS_Videoplayer
     float CurrentPercentPosition() const noexcept;
     // Also uses the logical position
     double CurrentTime() const noexcept;
+    // What CurrentTime() extrapolates from, with a high resolution timestamp
+    OFS_PlaybackAnchor PlaybackAnchor() const noexcept;
 
     // The "actual" position reported by the player
     double CurrentPlayerPosition() const noexcept; 
@@ -64,6 +64,8 @@ struct MpvPlayerContext
     float* logicalPosition = nullptr;
 
     uint64_t smoothTimer = 0;
+    // SDL_GetPerformanceCounter() taken together with smoothTimer
+    uint64_t smoothCounter = 0;
     VideoplayerType playerType;
 };
 
@@ -327,6 +329,7 @@ inline static void ProcessEvents(MpvPlayerContext* ctx) noexcept
                         auto newPercentPos = (*(double*)prop->data) / 100.0;
                         ctx->data.percentPos = newPercentPos;
                         ctx->smoothTimer = SDL_GetTicks64();
+                        ctx->smoothCounter = SDL_GetPerformanceCounter();
                         if(!ctx->data.paused) {
                             *ctx->logicalPosition = newPercentPos;
                         }
@@ -346,6 +349,7 @@ inline static void ProcessEvents(MpvPlayerContext* ctx) noexcept
                             *ctx->logicalPosition += positionOffset;
                         }
                         ctx->smoothTimer = SDL_GetTicks64();
+                        ctx->smoothCounter = SDL_GetPerformanceCounter();
                         ctx->data.paused = paused;
                         notifyPaused(ctx);
                         break;
@@ -395,6 +399,12 @@ void OFS_Videoplayer::Update(float delta) noexcept
     }
 }
 
+bool OFS_Videoplayer::HasPendingUpdates() const noexcept
+{
+    return SDL_AtomicGet(&CTX->hasEvents) > 0
+        || SDL_AtomicGet(&CTX->renderUpdate) > 0;
+}
+
 void OFS_Videoplayer::SetVolume(float volume) noexcept
 {
     CTX->data.currentVolume = volume;
@@ -464,6 +474,7 @@ void OFS_Videoplayer::AddSpeed(float speed) noexcept
 void OFS_Videoplayer::SetPositionPercent(float percentPos, bool pausesVideo) noexcept
 {
     logicalPosition = percentPos;
+    seekCount += 1;
     CTX->data.percentPos = percentPos;
     stbsp_snprintf(CTX->tmpBuf.data(), CTX->tmpBuf.size(), "%.08f", (float)(percentPos * 100.0f));
     const char* cmd[]{ "seek", CTX->tmpBuf.data(), "absolute-percent+exact", NULL };
@@ -612,6 +623,22 @@ double OFS_Videoplayer::CurrentTime() const noexcept
     }
 }
 
+OFS_PlaybackAnchor OFS_Videoplayer::PlaybackAnchor() const noexcept
+{
+    OFS_PlaybackAnchor anchor;
+    anchor.time = logicalPosition * CTX->data.duration;
+    anchor.counter = CTX->smoothCounter;
+    anchor.speed = CTX->data.currentSpeed;
+    anchor.paused = CTX->data.paused;
+    anchor.seeks = seekCount;
+    if(anchor.paused || anchor.counter == 0)
+    {
+        // Paused or no position update yet, the current position is valid now
+        anchor.counter = SDL_GetPerformanceCounter();
+    }
+    return anchor;
+}
+
 double OFS_Videoplayer::CurrentPlayerPosition() const noexcept
 {
     return CTX->data.percentPos;
@@ -5,11 +5,13 @@
 #include "OFS_DynamicFontAtlas.h"
 #include "OFS_BlockingTask.h"
 #include "OFS_EventSystem.h"
+#include "OFS_JobSystem.h"
 
 #include "OFS_Util.h"
 #include "subprocess.h"
 
 #include <algorithm>
+#include <deque>
 
 static std::array<const char*, 6> VideoExtensions{
     ".mp4",
@@ -82,6 +84,80 @@ OFS_Project::~OFS_Project() noexcept
 {
 }
 
+// Saves run one at a time in the order they were made so writes to the same file stay in order.
+// The continuation of a save submits the next one, no worker ever waits on another job.
+struct OFS_ProjectSaveQueue
+{
+    struct PendingSave
+    {
+        std::string path;
+        std::shared_ptr<nlohmann::json> state;
+        // scripts to mark as saved with the version they were saved at
+        std::vector<std::pair<std::weak_ptr<Funscript>, uint32_t>> savedScripts;
+    };
+    // only used on the main thread
+    std::deque<PendingSave> pending;
+    OFS_JobHandle running;
+};
+
+static bool writeProjectState(const std::string& path, const nlohmann::json& projectState) noexcept
+{
+#if 1
+    auto projectBin = Util::SerializeCBOR(projectState);
+    return Util::WriteFile(path.c_str(), projectBin.data(), projectBin.size()) == projectBin.size();
+#else
+    auto projectJson = Util::SerializeJson(projectState, false);
+    return Util::WriteFile(path.c_str(), projectJson.data(), projectJson.size()) == projectJson.size();
+#endif
+}
+
+static void markSaved(const OFS_ProjectSaveQueue::PendingSave& save) noexcept
+{
+    for (auto& [weakScript, editVersion] : save.savedScripts) {
+        auto script = weakScript.lock();
+        // edits made after the state was captured are still unsaved
+        if (script && script->EditVersion() == editVersion) {
+            script->ClearUnsavedEdits();
+        }
+    }
+}
+
+static void submitNextSave(const std::shared_ptr<OFS_ProjectSaveQueue>& queue) noexcept
+{
+    if (queue->running || queue->pending.empty()) return;
+    auto save = std::make_shared<OFS_ProjectSaveQueue::PendingSave>(std::move(queue->pending.front()));
+    queue->pending.pop_front();
+
+    queue->running = OFS_JobSystem::ptr->Submit(TR(SAVE_PROJECT),
+        [save](OFS_JobContext& ctx) noexcept {
+            return writeProjectState(save->path, *save->state);
+        },
+        [queue, save](const OFS_Job& job) noexcept {
+            if (job.Succeeded()) {
+                markSaved(*save);
+            }
+            else {
+                LOGF_ERROR("Failed to save project \"%s\".", save->path.c_str());
+                Util::MessageBoxAlert(TR(ERROR_STR), std::string(TR(SAVE_PROJECT_FAILED_MSG)) + "\n" + save->path);
+            }
+            queue->running.reset();
+            submitNextSave(queue);
+        });
+    queue->running->Cancellable = false;
+}
+
+void OFS_Project::FlushSaves() noexcept
+{
+    // continuations don't run anymore once the job system is shut down
+    if (!saveQueue) return;
+    for (auto& save : saveQueue->pending) {
+        if (!writeProjectState(save.path, *save.state)) {
+            LOGF_ERROR("Failed to save project \"%s\".", save.path.c_str());
+        }
+    }
+    saveQueue->pending.clear();
+}
+
 void OFS_Project::loadNecessaryGlyphs() noexcept
 {
     // This should be called after loading or importing.
@@ -276,20 +352,22 @@ void OFS_Project::Save(const std::string& path, bool clearUnsavedChanges) noexce
         projectState.binaryFunscriptData.resize(size);
     }
 
+    // The state is captured here, encoding and writing happens in a job.
 #if 1
-    auto projectState = OFS_StateManager::Get()->SerializeProjectAll(true);
-    auto projectBin = Util::SerializeCBOR(projectState);
-    Util::WriteFile(path.c_str(), projectBin.data(), projectBin.size());
+    auto projectState = std::make_shared<nlohmann::json>(OFS_StateManager::Get()->SerializeProjectAll(true));
 #else
-    auto projectState = OFS_StateManager::Get()->SerializeProjectAll(false);
-    auto projectJson = Util::SerializeJson(projectState, false);
-    Util::WriteFile(path.c_str(), projectJson.data(), projectJson.size());
+    auto projectState = std::make_shared<nlohmann::json>(OFS_StateManager::Get()->SerializeProjectAll(false));
 #endif
+    OFS_ProjectSaveQueue::PendingSave save{ path, std::move(projectState) };
+    // the scripts only count as saved once the write succeeded
     if (clearUnsavedChanges) {
         for (auto& script : Funscripts) {
-            script->ClearUnsavedEdits();
+            save.savedScripts.emplace_back(script, script->EditVersion());
         }
     }
+    if (!saveQueue) saveQueue = std::make_shared<OFS_ProjectSaveQueue>();
+    saveQueue->pending.push_back(std::move(save));
+    submitNextSave(saveQueue);
 }
 
 void OFS_Project::Update(float delta, bool idleMode) noexcept
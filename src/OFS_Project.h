@@ -15,12 +15,16 @@ public:
 
 #define OFS_PROJECT_EXT ".ofsp"
 
+struct OFS_ProjectSaveQueue;
+
 class OFS_Project {
 private:
     uint32_t stateHandle = 0xFFFF'FFFF;
     uint32_t bookmarkStateHandle = 0xFFFF'FFFF;
 
     std::string lastPath;
+    // shared with the save jobs, which may outlive the project
+    std::shared_ptr<OFS_ProjectSaveQueue> saveQueue;
 
     std::string notValidError;
     bool valid = false;
@@ -48,6 +52,8 @@ public:
     bool Load(const std::string& path) noexcept;
     void Save(bool clearUnsavedChanges) noexcept { Save(lastPath, clearUnsavedChanges); }
     void Save(const std::string& path, bool clearUnsavedChanges) noexcept;
+    // Writes the saves which are still queued, call after the job system was shut down.
+    void FlushSaves() noexcept;
 
     bool ImportFromFunscript(const std::string& path) noexcept;
     bool ImportFromMedia(const std::string& path) noexcept;
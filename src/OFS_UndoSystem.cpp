@@ -38,7 +38,8 @@ static std::array<Tr, (int32_t)StateType::TOTAL_UNDOSTATE_TYPES> stateTranslatio
     Tr::MOVE_TO_CURRENT_POSITION,
 
     Tr::SIMPLIFY,
-    Tr::LUA_SCRIPT
+    Tr::LUA_SCRIPT,
+    Tr::WEBSOCKET_API
 };
 
 // FIXME: UndoStack and RedoStack should be filtered when scripts are removed / projects change
@@ -115,6 +116,19 @@ void UndoSystem::Snapshot(StateType type, UndoContextScripts&& scriptsToSnapshot
     }
 }
 
+void UndoSystem::SnapshotInterval(StateType type, std::weak_ptr<const class Funscript> scriptToSnapshot, float fromTime, float toTime) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto script = scriptToSnapshot.lock();
+    if (!script) {
+        FUN_ASSERT(false, "Stale weak_ptr.");
+        return;
+    }
+    UndoStack.emplace_back(UndoContextScripts{ scriptToSnapshot }, type);
+    ClearRedo();
+    script->undoSystem->SnapshotInterval(type, fromTime, toTime);
+}
+
 bool UndoSystem::Undo() noexcept
 {
     if (UndoStack.empty()) return false;
@@ -169,3 +183,11 @@ void UndoSystem::ClearRedo() noexcept
 {
     RedoStack.clear();
 }
+
+size_t UndoSystem::MemoryUsage() const noexcept
+{
+    size_t bytes = (UndoStack.capacity() + RedoStack.capacity()) * sizeof(UndoContext);
+    for (auto& context : UndoStack) bytes += context.Scripts.capacity() * sizeof(UndoContextScripts::value_type);
+    for (auto& context : RedoStack) bytes += context.Scripts.capacity() * sizeof(UndoContextScripts::value_type);
+    return bytes;
+}
@@ -37,6 +37,7 @@ enum StateType : int32_t {
 
     SIMPLIFY = 21,
     CUSTOM_LUA = 22,
+    WEBSOCKET_API = 23,
     // add more here & update stateStrings in UndoSystem.cpp
 
 
@@ -74,10 +75,15 @@ public:
     void Snapshot(StateType type,
         UndoContextScripts&& scriptsToSnapshot,
         bool clearRedo = true) noexcept;
+    // Only keeps the actions in [fromTime, toTime], for edits which don't touch anything else
+    void SnapshotInterval(StateType type, std::weak_ptr<const class Funscript> scriptToSnapshot, float fromTime, float toTime) noexcept;
     bool Undo() noexcept;
     bool Redo() noexcept;
 
     inline bool MatchUndoTop(int32_t type) const noexcept { return !UndoEmpty() && UndoStack.back().Type == type; }
     inline bool UndoEmpty() const noexcept { return UndoStack.empty(); }
     inline bool RedoEmpty() const noexcept { return RedoStack.empty(); }
+
+    // Only the contexts, the snapshots are owned by the FunscriptUndoSystem of each script.
+    size_t MemoryUsage() const noexcept;
 };
@@ -10,12 +10,15 @@
 #include "OFS_Shader.h"
 #include "OFS_MpvLoader.h"
 #include "OFS_Localization.h"
+#include "OFS_EventBenchmark.h"
+#include "OFS_JobSystem.h"
 
 #include "imgui.h"
 #include "state/OpenFunscripterState.h"
 #include "state/states/VideoplayerWindowState.h"
 #include "state/states/BaseOverlayState.h"
 #include "state/states/ChapterState.h"
+#include "state/states/WaveformState.h"
 
 #include <filesystem>
 
@@ -213,6 +216,7 @@ bool OpenFunscripter::Init(int argc, char* argv[])
     preferences->SetTheme(static_cast<OFS_Theme>(prefState.currentTheme));
 
     EV::Init();
+    OFS_JobSystem::Init();
     LoadedProject = std::make_unique<OFS_Project>();
 
     LOG_INFO("Main video player init...");
@@ -1390,13 +1394,15 @@ void OpenFunscripter::render() noexcept
     glFinish();
 }
 
-void OpenFunscripter::processEvents() noexcept
+bool OpenFunscripter::processEvents() noexcept
 {
     OFS_PROFILE(__FUNCTION__);
     auto wrappedEvent = EV::MakeTyped<OFS_SDL_Event>();
     auto& event = wrappedEvent->sdl;
     bool IsExiting = false;
+    bool anyEvent = false;
     while (SDL_PollEvent(&event)) {
+        anyEvent = true;
         ImGui_ImplSDL2_ProcessEvent(&event);
         switch (event.type) {
             case SDL_QUIT: {
@@ -1442,7 +1448,8 @@ void OpenFunscripter::processEvents() noexcept
         OFS_SDL_Event::EventType = event.type;
         EV::Queue().directDispatch(OFS_SDL_Event::EventType, wrappedEvent);
     }
-    EV::Process();
+    bool anyDispatched = EV::Process();
+    return anyEvent || anyDispatched;
 }
 
 void OpenFunscripter::ExportClip(const ExportClipForChapter* ev) noexcept
@@ -1464,12 +1471,27 @@ void OpenFunscripter::FunscriptChanged(const FunscriptActionsChangedEvent* ev) n
     auto ptr = ev->Script;
     for (int i = 0, size = LoadedFunscripts().size(); i < size; i += 1) {
         if (LoadedFunscripts()[i].get() == ptr) {
-            extensions->ScriptChanged(i);
+            extensions->ScriptChanged(i, ev->FromTime, ev->ToTime);
+            // the heatmap only shows the active script
+            if ((uint32_t)i == LoadedProject->ActiveIdx()) {
+                invalidateHeatmap(ev->FromTime, ev->ToTime);
+            }
             break;
         }
     }
+}
 
-    Status = Status | OFS_Status::OFS_GradientNeedsUpdate;
+void OpenFunscripter::invalidateHeatmap(float fromTime, float toTime) noexcept
+{
+    if (Status & OFS_Status::OFS_GradientNeedsUpdate) {
+        heatmapFromTime = std::min(heatmapFromTime, fromTime);
+        heatmapToTime = std::max(heatmapToTime, toTime);
+    }
+    else {
+        heatmapFromTime = fromTime;
+        heatmapToTime = toTime;
+    }
+    Status |= OFS_Status::OFS_GradientNeedsUpdate;
 }
 
 void OpenFunscripter::ScriptTimelineActionClicked(const FunscriptActionClickedEvent* ev) noexcept
@@ -1526,7 +1548,7 @@ void OpenFunscripter::VideoDuration(const DurationChangeEvent* ev) noexcept
     auto& projectState = LoadedProject->State();
     projectState.metadata.duration = player->Duration();
     player->SetPositionExact(projectState.lastPlayerPosition);
-    Status |= OFS_Status::OFS_GradientNeedsUpdate;
+    invalidateHeatmap();
 }
 
 void OpenFunscripter::VideoLoaded(const VideoLoadedEvent* ev) noexcept
@@ -1564,6 +1586,32 @@ void OpenFunscripter::update() noexcept
     }
 
     webApi->Update();
+    sampleMemoryUsage();
+}
+
+void OpenFunscripter::sampleMemoryUsage() noexcept
+{
+    if (!memoryStats.BeginSample(SDL_GetTicks())) {
+        return;
+    }
+    OFS_PROFILE(__FUNCTION__);
+
+    size_t scriptBytes = CopiedSelection.MemoryUsage();
+    size_t scriptUndoBytes = 0;
+    for (auto& script : LoadedFunscripts()) {
+        scriptBytes += script->Actions().MemoryUsage() + script->Selection().MemoryUsage();
+        scriptUndoBytes += script->undoSystem->MemoryUsage();
+    }
+    // The waveform state is part of the project state but gets reported with the waveform
+    size_t waveformStateBytes = WaveformState::StaticStateSlow().MemoryUsage();
+
+    memoryStats.Add("scripts", TR(MEMORY_SCRIPTS), scriptBytes);
+    memoryStats.Add("scriptUndo", TR(MEMORY_SCRIPT_UNDO), scriptUndoBytes);
+    memoryStats.Add("undo", TR(MEMORY_UNDO), undoSystem->MemoryUsage());
+    memoryStats.Add("waveform", TR(MEMORY_WAVEFORM), scriptTimeline.Wave.MemoryUsage() + waveformStateBytes);
+    memoryStats.Add("lua", TR(MEMORY_LUA), OFS_LuaExtension::TotalMemoryUsage());
+    memoryStats.Add("state", TR(MEMORY_STATE), OFS_StateManager::Get()->MemoryUsage() - waveformStateBytes);
+    memoryStats.EndSample();
 }
 
 void OpenFunscripter::autoBackup() noexcept
@@ -1656,12 +1704,47 @@ void OpenFunscripter::setIdle(bool idle) noexcept
     IdleMode = idle;
 }
 
-void OpenFunscripter::Step() noexcept
+void OpenFunscripter::RequestRedraw() noexcept
+{
+    LastDirtyTick = SDL_GetTicks();
+}
+
+bool OpenFunscripter::needsRedraw() noexcept
+{
+    const auto& prefState = PreferenceState::State(preferences->StateHandle());
+    if (!prefState.redrawOnDemand) return true;
+
+    // Animations and anything which changes without producing events
+    if (!player->IsPaused() || player->HasPendingUpdates()) return true;
+    if (playerControls.videoPreview->HasPendingUpdates()) return true;
+    if (blockingTask.Running || OFS_JobSystem::ptr->ActiveJobs() > 0) return true;
+    // Lua tasks and process callbacks only run in drawn frames
+    if (extensions->HasPendingWork()) return true;
+    if (ImGui::GetIO().WantTextInput) return true; // blinking cursor
+
+    // ImGui needs a few frames to settle after input. Hover delays for tooltips for example.
+    // The heartbeat keeps timers like the autobackup going.
+    uint32_t now = SDL_GetTicks();
+    return now - LastDirtyTick < RedrawSettleMs
+        || now - LastDrawTick >= RedrawHeartbeatMs;
+}
+
+bool OpenFunscripter::Step() noexcept
 {
     OFS_BEGINPROFILING();
+    if (processEvents()) {
+        RequestRedraw();
+    }
+    if (!needsRedraw()) {
+        SkippedFrames += 1;
+        OFS_FileLogger::Flush();
+        OFS_ENDPROFILING();
+        return false;
+    }
+    RenderedFrames += 1;
+    LastDrawTick = SDL_GetTicks();
     {
         OFS_PROFILE(__FUNCTION__);
-        processEvents();
         newFrame();
         update();
         {
@@ -1702,6 +1785,7 @@ void OpenFunscripter::Step() noexcept
             OFS_FileLogger::DrawLogWindow(&ofsState.showDebugLog);
             keys->RenderKeybindingWindow();
             chapterMgr->ShowWindow(&ofsState.showChapterManager);
+            OFS_JobSystem::ptr->ShowJobsWindow(&ofsState.showJobs);
 
             if (preferences->ShowPreferenceWindow()) {}
 
@@ -1709,7 +1793,7 @@ void OpenFunscripter::Step() noexcept
 
             if (Status & OFS_GradientNeedsUpdate) {
                 Status &= ~(OFS_GradientNeedsUpdate);
-                playerControls.UpdateHeatmap(player->Duration(), ActiveFunscript()->Actions());
+                playerControls.UpdateHeatmap(player->Duration(), ActiveFunscript()->Actions(), heatmapFromTime, heatmapToTime);
             }
 
             playerControls.DrawTimeline();
@@ -1768,6 +1852,9 @@ void OpenFunscripter::Step() noexcept
             if (DebugMetrics) {
                 ImGui::ShowMetricsWindow(&DebugMetrics);
             }
+#if OFS_PROFILE_ENABLED == 0
+            OFS_Profiler::ShowProfilerWindow(&ShowProfiler);
+#endif
 
             playerWindow->DrawVideoPlayer(NULL, &ofsState.showVideo);
         }
@@ -1779,6 +1866,7 @@ void OpenFunscripter::Step() noexcept
     OFS_ENDPROFILING();
     SDL_GL_SwapWindow(window);
     player->NotifySwap();
+    return true;
 }
 
 int OpenFunscripter::Run() noexcept
@@ -1791,13 +1879,20 @@ int OpenFunscripter::Run() noexcept
     while (!(Status & OFS_Status::OFS_ShouldExit)) {
 
         uint64_t FrameStart = SDL_GetPerformanceCounter();
-        Step();
+        bool frameDrawn = Step();
         uint64_t FrameEnd = SDL_GetPerformanceCounter();
 
         const auto& prefState = PreferenceState::State(preferences->StateHandle());
         float frameLimit = IdleMode ? 10.f : (float)prefState.framerateLimit;
         const float minFrameTime = (float)PerfFreq / frameLimit;
 
+        if (!frameDrawn) {
+            // Nothing to draw. Sleep until input arrives or the next frame would be due.
+            // mpv doesn't wake up SDL so this must time out.
+            SDL_WaitEventTimeout(NULL, (int)(1000.f / frameLimit));
+            continue;
+        }
+
         int32_t sleepMs = ((minFrameTime - (float)(FrameEnd - FrameStart)) / minFrameTime) * (1000.f / frameLimit);
         if (!IdleMode) sleepMs -= 1;
         if (sleepMs > 0) SDL_Delay(sleepMs);
@@ -1819,6 +1914,9 @@ int OpenFunscripter::Run() noexcept
 
 void OpenFunscripter::Shutdown() noexcept
 {
+    // Waits for the running save and cancels everything else
+    OFS_JobSystem::Shutdown();
+    if (LoadedProject) LoadedProject->FlushSaves();
     SaveState();
 
     OFS_DynFontAtlas::Shutdown();
@@ -1935,7 +2033,7 @@ void OpenFunscripter::UpdateNewActiveScript(uint32_t activeIndex) noexcept
 {
     LoadedProject->SetActiveIdx(activeIndex);
     updateTitle();
-    Status = Status | OFS_Status::OFS_GradientNeedsUpdate;
+    invalidateHeatmap();
 }
 
 void OpenFunscripter::updateTitle() noexcept
@@ -2601,6 +2699,7 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
             if (ImGui::MenuItem(TR(ETCODE), NULL, &ofsState.showETCode)) {}
             if (ImGui::MenuItem(TR(WEBSOCKET_API), NULL, &ofsState.showWsApi)) {}
             if (ImGui::MenuItem(TR(CHAPTERS), NULL, &ofsState.showChapterManager)) {}
+            if (ImGui::MenuItem(TR(JOBS), NULL, &ofsState.showJobs)) {}
 
 
             ImGui::Separator();
@@ -2650,6 +2749,13 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
             if (ImGui::BeginMenu(TR(DEBUG))) {
                 if (ImGui::MenuItem(TR(METRICS), NULL, &DebugMetrics)) {}
                 if (ImGui::MenuItem(TR(LOG_OUTPUT), NULL, &ofsState.showDebugLog)) {}
+#if OFS_PROFILE_ENABLED == 0
+                if (ImGui::MenuItem(TR(PROFILER), NULL, &ShowProfiler)) {}
+#endif
+                if (ImGui::MenuItem(TR(EVENT_BENCHMARK))) {
+                    OFS_EventBenchmark::RunAndLog();
+                    ofsState.showDebugLog = true;
+                }
 #ifndef NDEBUG
                 if (ImGui::MenuItem("ImGui Demo", NULL, &DebugDemo)) {}
 #endif
@@ -2683,6 +2789,10 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
             if (ImGui::MenuItem(TR(DEV_MODE), NULL, &OFS_LuaExtensions::DevMode)) {}
             OFS::Tooltip(TR(DEV_MODE_TOOLTIP));
             if (ImGui::MenuItem(TR(SHOW_LOGS), NULL, &OFS_LuaExtensions::ShowLogs)) {}
+            if (ImGui::MenuItem(TR(SHOW_EXTENSION_STATS), NULL, &OFS_LuaExtensions::ShowStats)) {}
+            ImGui::SetNextItemWidth(ImGui::GetFontSize() * 8.f);
+            ImGui::SliderFloat(TR(EXTENSION_TASK_BUDGET), &OFS_LuaExtensions::TaskBudgetMs, 1.f, 50.f, "%.0f ms", ImGuiSliderFlags_AlwaysClamp);
+            OFS::Tooltip(TR(EXTENSION_TASK_BUDGET_TOOLTIP));
             if (ImGui::MenuItem(TR(EXTENSION_DIR))) {
                 Util::OpenFileExplorer(Util::Prefpath(OFS_LuaExtensions::ExtensionDir));
             }
@@ -2696,6 +2806,12 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
                             Util::MessageBoxAlert(TR(UNKNOWN_ERROR), ext.Error);
                         }
                     }
+                    if (ext.IsLoading()) {
+                        ImGui::TextDisabled("%s", TR(EXTENSION_LOADING));
+                    }
+                    else if (ext.IsDeferred()) {
+                        ImGui::TextDisabled("%s", TR(EXTENSION_DEFERRED));
+                    }
                     if (ImGui::MenuItem(Util::Format(TR(SHOW_WINDOW), ext.NameId.c_str()), NULL, &ext.WindowOpen, ext.Active)) {}
                     if (ImGui::MenuItem(Util::Format(TR(OPEN_DIRECTORY), ext.NameId.c_str()), NULL)) {
                         Util::OpenFileExplorer(ext.Directory);
@@ -2870,6 +2986,19 @@ void OpenFunscripter::ShowStatisticsWindow(bool* open) noexcept
             (int)(pos * 100.f), (int)(target * 100.f), interval * 1000.f);
     }
 
+    if (ImGui::CollapsingHeader(TR(MEMORY_USAGE))) {
+        memoryStats.ShowStats();
+    }
+
+    const auto& prefState = PreferenceState::State(preferences->StateHandle());
+    if (prefState.redrawOnDemand) {
+        ImGui::Separator();
+        uint64_t totalFrames = RenderedFrames + SkippedFrames;
+        ImGui::Text("%s: %llu", TR(FRAMES_RENDERED), (unsigned long long)RenderedFrames);
+        ImGui::Text("%s: %llu (%.1f%%)", TR(FRAMES_SKIPPED), (unsigned long long)SkippedFrames,
+            totalFrames > 0 ? (SkippedFrames * 100.0) / totalFrames : 0.0);
+    }
+
     ImGui::End();
 }
 
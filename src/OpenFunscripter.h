@@ -23,6 +23,7 @@
 #include "OFS_VideoplayerWindow.h"
 #include "OFS_WebsocketApi.h"
 #include "OFS_ChapterManager.h"
+#include "OFS_MemoryStats.h"
 
 #include <memory>
 #include <chrono>
@@ -48,27 +49,46 @@ private:
     bool DebugDemo = false;
 #endif
     bool DebugMetrics = false;
+#if OFS_PROFILE_ENABLED == 0
+    bool ShowProfiler = false;
+#endif
     bool ShowAbout = false;
     bool IdleMode = false;
     uint32_t IdleTimer = 0;
 
+    // Redraw on demand
+    static constexpr uint32_t RedrawSettleMs = 750;
+    static constexpr uint32_t RedrawHeartbeatMs = 1000;
+    uint32_t LastDirtyTick = 0;
+    uint32_t LastDrawTick = 0;
+    uint64_t RenderedFrames = 0;
+    uint64_t SkippedFrames = 0;
+
+    // part of the active script the heatmap has to redo, see OFS_GradientNeedsUpdate
+    float heatmapFromTime = 0.f;
+    float heatmapToTime = std::numeric_limits<float>::max();
+
     FunscriptArray CopiedSelection;
+    OFS_MemoryStats memoryStats;
     std::chrono::steady_clock::time_point lastBackup;
 
     char tmpBuf[2][32];
 
     void setIdle(bool idle) noexcept;
+    bool needsRedraw() noexcept;
     void registerBindings();
 
     void update() noexcept;
     void newFrame() noexcept;
     void render() noexcept;
     void autoBackup() noexcept;
+    void sampleMemoryUsage() noexcept;
+    void invalidateHeatmap(float fromTime = 0.f, float toTime = std::numeric_limits<float>::max()) noexcept;
 
     void exitApp(bool force = false) noexcept;
 
     bool imguiSetup() noexcept;
-    void processEvents() noexcept;
+    bool processEvents() noexcept;
 
     void ExportClip(const class ExportClipForChapter* ev) noexcept;
 
@@ -161,7 +181,10 @@ public:
 
     bool Init(int argc, char* argv[]);
     int Run() noexcept;
-    void Step() noexcept;
+    // Returns false when the frame was skipped because nothing changed
+    bool Step() noexcept;
+    // Keeps frames coming for a moment when redraw on demand is enabled
+    void RequestRedraw() noexcept;
     void Shutdown() noexcept;
 
     inline const std::vector<std::shared_ptr<Funscript>>& LoadedFunscripts() const noexcept
@@ -5,6 +5,7 @@
 #include "OFS_EventSystem.h"
 #include "OFS_VideoplayerEvents.h"
 #include "OFS_Localization.h"
+#include "OFS_JobSystem.h"
 
 #include "imgui.h"
 #include "imgui_stdlib.h"
@@ -85,25 +86,27 @@ void OFS_ChapterManager::ShowWindow(bool* open) noexcept
     ImGui::End();
 }
 
-bool OFS_ChapterManager::ExportClip(const Chapter& chapter, const std::string& outputDirStr) noexcept
+OFS_JobHandle OFS_ChapterManager::ExportClip(const Chapter& chapter, const std::string& outputDirStr) noexcept
 {
     auto app = OpenFunscripter::ptr;
-    char startTimeChar[16];
-    char endTimeChar[16];
-    stbsp_snprintf(startTimeChar, sizeof(startTimeChar), "%f", chapter.startTime);
-    stbsp_snprintf(endTimeChar, sizeof(endTimeChar), "%f", chapter.endTime);
-
-    
     auto outputDir = Util::PathFromString(outputDirStr);
     auto mediaPath = Util::PathFromString(app->player->VideoPath());
 
     auto& projectState = app->LoadedProject->State();
 
+    // The clipped scripts are serialized on the main thread.
+    // Writing them and cutting the media happens in the job.
+    struct ClipFile
+    {
+        std::string path;
+        std::string text;
+    };
+    std::vector<ClipFile> scriptFiles;
+
     for(auto& script : app->LoadedFunscripts())
     {
         auto scriptOutputPath = (outputDir / (chapter.name + "_" + script->Title()));
         scriptOutputPath.replace_extension(".funscript");
-        auto scriptOutputPathStr = scriptOutputPath.u8string();
 
         auto clippedScript = Funscript();
         auto slice = script->GetSelection(chapter.startTime, chapter.endTime);
@@ -115,50 +118,52 @@ bool OFS_ChapterManager::ExportClip(const Chapter& chapter, const std::string& o
 
         // FIXME: chapters and bookmarks are not included
         auto funscriptJson = clippedScript.Serialize(projectState.metadata, false);
-        auto funscriptText = Util::SerializeJson(funscriptJson);
-        Util::WriteFile(scriptOutputPathStr.c_str(), funscriptText.data(), funscriptText.size());
+        scriptFiles.emplace_back(ClipFile{ scriptOutputPath.u8string(), Util::SerializeJson(funscriptJson) });
     }
 
     auto clippedMedia = Util::PathFromString("");
     clippedMedia.replace_filename(chapter.name + "_" + mediaPath.filename().u8string());
     clippedMedia.replace_extension(mediaPath.extension());
-    
     auto videoOutputPath = outputDir / clippedMedia;
-    auto videoOutputString = videoOutputPath.u8string();
-    
-    auto ffmpegPath = Util::FfmpegPath().u8string();
-    auto mediaPathStr = mediaPath.u8string();
-
-    std::array<const char*, 17> args = {
-        ffmpegPath.c_str(),
-        "-y",
-        "-ss", startTimeChar,
-        "-to", endTimeChar,
-        "-i", mediaPathStr.c_str(),
-        "-vcodec", "copy",
-        "-acodec", "copy",
-        videoOutputString.c_str(),
-        nullptr
-    };
-
-    struct subprocess_s proc;
-    if (subprocess_create(args.data(), subprocess_option_no_window, &proc) != 0) {
-        return false;
-    }
-
-    if (proc.stdout_file) {
-        fclose(proc.stdout_file);
-        proc.stdout_file = nullptr;
-    }
 
-    if (proc.stderr_file) {
-        fclose(proc.stderr_file);
-        proc.stderr_file = nullptr;
-    }
-
-    int returnCode;
-    subprocess_join(&proc, &returnCode);
-    subprocess_destroy(&proc);
+    return OFS_JobSystem::ptr->Submit(FMT("%s: %s", TR(EXPORT_CLIP), chapter.name.c_str()),
+        [scriptFiles = std::move(scriptFiles),
+            startTime = chapter.startTime, endTime = chapter.endTime,
+            mediaPathStr = mediaPath.u8string(),
+            videoOutputString = videoOutputPath.u8string()](OFS_JobContext& ctx) noexcept
+        {
+            for(auto& file : scriptFiles)
+            {
+                Util::WriteFile(file.path.c_str(), file.text.data(), file.text.size());
+            }
 
-    return returnCode == 0;
-}
\ No newline at end of file
+            char startTimeChar[16];
+            char endTimeChar[16];
+            stbsp_snprintf(startTimeChar, sizeof(startTimeChar), "%f", startTime);
+            stbsp_snprintf(endTimeChar, sizeof(endTimeChar), "%f", endTime);
+            auto ffmpegPath = Util::FfmpegPath().u8string();
+
+            std::array<const char*, 17> args = {
+                ffmpegPath.c_str(),
+                "-y",
+                "-ss", startTimeChar,
+                "-to", endTimeChar,
+                "-i", mediaPathStr.c_str(),
+                "-vcodec", "copy",
+                "-acodec", "copy",
+                videoOutputString.c_str(),
+                nullptr
+            };
+
+            ctx.SetDescription(videoOutputString);
+            int returnCode;
+            return ctx.RunProcess(args.data(), &returnCode) && returnCode == 0;
+        },
+        [](const OFS_Job& job) noexcept
+        {
+            if(job.Status() == OFS_JobStatus::Failed)
+            {
+                Util::MessageBoxAlert(TR(ERROR_STR), TR(EXPORT_CLIP_FAILED));
+            }
+        });
+}
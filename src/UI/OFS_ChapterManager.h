@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <string>
 
+#include "OFS_JobSystem.h"
+
 class OFS_ChapterManager
 {
     private:
@@ -14,7 +16,7 @@ class OFS_ChapterManager
     OFS_ChapterManager(OFS_ChapterManager&&) = delete;
     ~OFS_ChapterManager() noexcept;
 
-    static bool ExportClip(const class Chapter& chapter, const std::string& outputDirStr) noexcept;
+    static OFS_JobHandle ExportClip(const class Chapter& chapter, const std::string& outputDirStr) noexcept;
     void ShowWindow(bool* open) noexcept;
 
     class ChapterState& State() noexcept;
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <iterator>
 
@@ -301,79 +302,162 @@ namespace sevfate {
         return false;
     }
 
-    void AxisScriptLink::apply(tcode::CommandEndpoint& ep, size_t delta_ms)
+    void AxisScriptLink::sync_snapshot()
     {
+        if (!_snapshot) {
+            return;
+        }
         std::shared_ptr<Funscript> linked_funscript = _script.lock();
+        uint32_t version = linked_funscript ? linked_funscript->EditVersion() : 0;
+        if (linked_funscript.get() == _published_script && version == _published_version) [[likely]] {
+            return;
+        }
+        auto& snapshot = _snapshot->back();
+        snapshot.linked = linked_funscript != nullptr;
         if (linked_funscript) {
-            auto& player = OpenFunscripter::ptr->player;
-            // TODO: Replace with event-driven logic.
-            if (player->IsPaused() && !_paused_update_state) {
-                _paused_update_state = true;
-                _ms_until_next_update = 0; // Triggers a normal update once when paused.
+            snapshot.actions = linked_funscript->Actions();
+        }
+        else {
+            snapshot.actions.clear();
+        }
+        _snapshot->publish();
+        _published_script = linked_funscript.get();
+        _published_version = version;
+    }
+
+    uint32_t AxisScriptLink::_scale_target(tcode::CommandEndpoint& ep, float v) const
+    {
+        auto [limit_min, limit_max, reversal] = ep.extract_axis_limits<uint16_t>();
+        if (reversal) {
+            limit_min = TARGET_DEFAULT;
+            limit_max = TARGET_DEFAULT;
+        }
+        if (_invert) {
+            v = 1.f - v;
+        }
+        return tcode::map(v, 0.f, 1.f, (float)limit_min, (float)limit_max);
+    }
+
+    void AxisScriptLink::_fill_schedule(const FunscriptArray& actions, double speed)
+    {
+        // Long segments are split so the device gets refreshed regularly.
+        const double max_duration = MAX_UPDATE_PERIOD_MS / 1000. * speed;
+        while (_schedule.size() < LOOKAHEAD_SEGMENTS) {
+            double start_time = _scheduled_until;
+            auto next_it = actions.upper_bound(FunscriptAction(start_time, 0));
+            if (next_it == actions.end()) {
+                // The device stays at the last action.
+                break;
+            }
+            ScheduledSegment segment;
+            segment.start_time = start_time;
+            if (next_it == actions.begin()) {
+                // Nothing to interpolate from before the first action.
+                segment.target = next_it->pos / 100.f;
+                segment.jump = true;
             }
-            else if (!player->IsPaused() && _paused_update_state) {
-                _paused_update_state = false;
-                _ms_until_next_update = 0; // Returns to normal operation when un-paused.
+            else if (std::prev(next_it)->flags & FunscriptAction::ModeFlagBits::Step) {
+                segment.target = std::prev(next_it)->pos / 100.f;
+                segment.jump = true;
             }
-            assert(_ms_until_next_update >= 0);
-            if (_ms_until_next_update <= delta_ms) {
-                auto current_playback_time = player->CurrentTime();
-                auto [pos, target, interval] = linked_funscript->getInterpolatedAction(current_playback_time);
-                auto [limit_min, limit_max, reversal] = ep.extract_axis_limits<uint16_t>();
-                if (reversal) {
-                    limit_min = TARGET_DEFAULT;
-                    limit_max = TARGET_DEFAULT;
+            else {
+                segment.target = next_it->pos / 100.f;
+            }
+            double end_time = next_it->atS;
+            if (end_time - start_time > max_duration) {
+                end_time = start_time + max_duration;
+                if (!segment.jump) {
+                    segment.target = std::get<0>(Funscript::getInterpolatedAction(actions, end_time));
                 }
-                if (_ms_until_next_update == 0) {
-                    /**
-                     * Link has been reset.
-                     * Send immediate normal update command to sync with device.
-                     */
-                    uint32_t scaled_pos;
-                    if (_invert) {
-                        scaled_pos =
-                            tcode::map(1.f - pos, 0.f, 1.f, (float)limit_min, (float)limit_max);
-                    }
-                    else {
-                        scaled_pos =
-                            tcode::map(pos, 0.f, 1.f, (float)limit_min, (float)limit_max);
-                    }
+            }
+            segment.duration = end_time - start_time;
+            _schedule.push_back(segment);
+            _scheduled_until = end_time;
+        }
+    }
 
-                    _send_normal_cmd(ep, { scaled_pos, TARGET_MAX });
-                    _ms_until_next_update = _paused_update_state ? 60 * 1000 : 1;
-                }
-                else if (!_paused_update_state) {
-                    uint32_t scaled_tgt;
-                    if (_invert) {
-                        scaled_tgt =
-                            tcode::map(1.f - target, 0.f, 1.f, (float)limit_min, (float)limit_max);
-                    }
-                    else {
-                        scaled_tgt =
-                            tcode::map(target, 0.f, 1.f, (float)limit_min, (float)limit_max);
-                    }
+    void AxisScriptLink::apply(tcode::CommandEndpoint& ep, const PlaybackClock& clock, uint64_t counter)
+    {
+        if (!_snapshot) {
+            return;
+        }
+        if (_snapshot->update()) {
+            // Edited or relinked, already scheduled segments may be outdated.
+            _reschedule = true;
+        }
+        const ScriptSnapshot& linked_funscript = _snapshot->front();
+        if (!linked_funscript.linked) {
+            return;
+        }
+        if (clock.epoch != _clock_epoch) {
+            // Seek, pause, resume, speed change or a restarted output thread.
+            _clock_epoch = clock.epoch;
+            _resync = true;
+        }
+        const auto& actions = linked_funscript.actions;
 
-                    // Limit minimum speed of sent commands.
-                    float ms_interval = std::min(interval, 60.f) * 1000.f;
-                    if (ep.supports_interval_update()) {
-                        _send_interval_cmd(ep, { scaled_tgt, TARGET_MAX }, ms_interval);
-                    }
-                    else {
-                        // Fallback. TODO: Adapt based on axis supported commands.
-                        _send_normal_cmd(ep, { scaled_tgt, TARGET_MAX });
-                    }
-                    // Limit to 60 second max interval between sent commands.
-                    _ms_until_next_update = std::min(static_cast<int32_t>(ms_interval), MAX_UPDATE_PERIOD_MS);
-                }
+        if (clock.anchor.paused) {
+            if (_resync) {
+                // Sync to the paused position once.
+                auto [pos, target, interval] = Funscript::getInterpolatedAction(actions, clock.anchor.time);
+                _send_normal_cmd(ep, { _scale_target(ep, pos), TARGET_MAX });
+                _schedule.clear();
+                _resync = false;
+                _reschedule = false;
+            }
+            _next_command_in_ms = 0.f;
+            return;
+        }
+
+        const double speed = std::max(clock.anchor.speed, 0.01f);
+        // Where playback will be once a command sent now reaches the device.
+        const double device_time = clock.time_at(counter) + _latency_ms / 1000. * speed;
+        if (_resync) {
+            auto [pos, target, interval] = Funscript::getInterpolatedAction(actions, device_time);
+            _send_normal_cmd(ep, { _scale_target(ep, pos), TARGET_MAX });
+            _schedule.clear();
+            _scheduled_until = device_time;
+            _resync = false;
+            _reschedule = false;
+            // An endpoint holds one pending update, the first segment goes out with the next tick.
+            _next_command_in_ms = 0.f;
+            return;
+        }
+        // Also when stalled for longer than everything that was scheduled.
+        if (_reschedule || _scheduled_until <= device_time) {
+            // The first segment continues from the current position.
+            _schedule.clear();
+            _scheduled_until = device_time;
+            _reschedule = false;
+        }
+        _fill_schedule(actions, speed);
+        if (_schedule.empty()) {
+            _next_command_in_ms = 0.f;
+            return;
+        }
+
+        // After a stall only the segment playback is in right now matters.
+        size_t due = 0;
+        while (due < _schedule.size() && _schedule[due].start_time <= device_time) {
+            due++;
+        }
+        if (due > 0) {
+            ScheduledSegment segment = _schedule[due - 1];
+            _schedule.erase(_schedule.begin(), _schedule.begin() + due);
+            uint32_t scaled_tgt = _scale_target(ep, segment.target);
+            // Whatever was missed of the segment is made up by moving faster.
+            double remaining = segment.start_time + segment.duration - device_time;
+            uint32_t ms_interval = std::lround(std::clamp(remaining / speed * 1000., 1., 60. * 1000.));
+            if (!segment.jump && ep.supports_interval_update()) {
+                _send_interval_cmd(ep, { scaled_tgt, TARGET_MAX }, ms_interval);
             }
             else {
-                _ms_until_next_update -= delta_ms;
-                // Saturate.
-                if (_ms_until_next_update < 0) {
-                    _ms_until_next_update = 0;
-                }
+                // Fallback. TODO: Adapt based on axis supported commands.
+                _send_normal_cmd(ep, { scaled_tgt, TARGET_MAX });
             }
+            _fill_schedule(actions, speed);
         }
+        _next_command_in_ms = _schedule.empty() ? 0.f : static_cast<float>((_schedule.front().start_time - device_time) / speed * 1000.);
     }
 
 } // namespace sevfate
@@ -7,14 +7,17 @@
 
 #include "tcode/Messages.hpp"
 #include <Funscript/Funscript.h>
+#include <UI/OFS_ETCode/output_thread.hpp>
 #include <tcode/ParserDispatcherRegistry.hpp>
 #include <tcode/Utils.hpp>
 
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace sevfate {
 
@@ -183,6 +186,13 @@ namespace sevfate {
         void _sort();
     };
 
+    /** Copy of a linked script, owned by the output thread once published. */
+    struct ScriptSnapshot {
+        /** False while no script is linked or the linked one got closed. */
+        bool linked = false;
+        FunscriptArray actions{};
+    };
+
     class AxisScriptLink {
     public:
         typedef tcode::fractional<uint32_t> normal_cmd_t;
@@ -195,11 +205,39 @@ namespace sevfate {
         static constexpr uint32_t TARGET_MAX = tcode::make_nines<uint32_t, TARGET_DIGIT_COUNT>();
         static constexpr uint32_t TARGET_DEFAULT = (TARGET_MAX + 1) / 2;
         static constexpr int32_t MAX_UPDATE_PERIOD_MS = 333;
+        static constexpr int32_t MAX_LATENCY_MS = 500;
+        /** Segments computed ahead of the playback position. */
+        static constexpr size_t LOOKAHEAD_SEGMENTS = 4;
+
+        /** A move which the device has to start at start_time, times are in script seconds. */
+        struct ScheduledSegment {
+            double start_time = 0.0;
+            double duration = 0.0;
+            float target = 0.f;
+            /** Step actions hold their position, the target is sent as a normal update. */
+            bool jump = false;
+        };
 
         std::weak_ptr<Funscript> _script = {};
+        /** Written by the UI thread, read by the output thread. */
+        std::shared_ptr<SnapshotBuffer<ScriptSnapshot>> _snapshot = {};
+        /** What was last published to _snapshot, UI thread only. */
+        const Funscript* _published_script = nullptr;
+        uint32_t _published_version = 0;
         bool _invert = false;
-        bool _paused_update_state = false;
-        int32_t _ms_until_next_update = 0;
+        /** Commands are sent this much earlier than their segment starts. */
+        int32_t _latency_ms = 0;
+
+        /** Output thread state, see apply(). */
+        std::vector<ScheduledSegment> _schedule{};
+        /** End of the last scheduled segment. */
+        double _scheduled_until = 0.0;
+        uint32_t _clock_epoch = UINT32_MAX;
+        /** Set to send the current position as a normal update and reschedule. */
+        bool _resync = true;
+        /** Set to drop the schedule, the next segment continues from the current position. */
+        bool _reschedule = false;
+        float _next_command_in_ms = 0.f;
         std::variant<std::monostate, normal_cmd_t, interval_cmd_t, speed_cmd_t> _last_command;
 
     public:
@@ -207,8 +245,15 @@ namespace sevfate {
         AxisScriptLink(const AxisScriptLink&) noexcept = default;
         AxisScriptLink& operator=(const AxisScriptLink&) noexcept = default;
 
-        void apply(tcode::CommandEndpoint& ep, size_t delta_ms);
+        /**
+         * Runs on the output thread, with the registry locked.
+         * Segments between the upcoming actions are computed ahead of time and each one is sent
+         * _latency_ms before it starts, so it arrives at the device when playback gets there.
+         */
+        void apply(tcode::CommandEndpoint& ep, const PlaybackClock& clock, uint64_t counter);
         void build_ui(tcode::CommandEndpoint& ep);
+        /** Publishes the linked script to the output thread if it changed since the last call. */
+        void sync_snapshot();
 
         const auto& get_last_command() const
         {
@@ -216,6 +261,9 @@ namespace sevfate {
         }
 
     private:
+        void _fill_schedule(const FunscriptArray& actions, double speed);
+        uint32_t _scale_target(tcode::CommandEndpoint& ep, float v) const;
+
         bool _send_normal_cmd(tcode::CommandEndpoint& ep, tcode::fractional<uint32_t> v);
         bool _send_interval_cmd(tcode::CommandEndpoint& ep, tcode::fractional<uint32_t> v, uint32_t interval);
         bool _send_speed_cmd(tcode::CommandEndpoint& ep, tcode::fractional<uint32_t> v, uint32_t speed);
@@ -247,7 +295,8 @@ namespace sevfate {
         AxisControlElement& operator=(const AxisControlElement&) = delete;
         AxisControlElement(AxisControlElement&& o) noexcept : _axis_idx(o._axis_idx), _stop_on_pause(o._stop_on_pause),
                                                               _ctl_state(std::exchange(o._ctl_state, AxisControlState::Unknown)),
-                                                              _ctl_manual(std::move(o._ctl_manual)), _ctl_pattern(std::move(o._ctl_pattern)) {}
+                                                              _ctl_manual(std::move(o._ctl_manual)), _ctl_pattern(std::move(o._ctl_pattern)),
+                                                              _ctl_script(std::move(o._ctl_script)) {}
         AxisControlElement& operator=(AxisControlElement&& o) noexcept
         {
             _axis_idx = o._axis_idx;
@@ -255,6 +304,7 @@ namespace sevfate {
             _ctl_state = std::exchange(o._ctl_state, AxisControlState::Unknown);
             _ctl_manual = std::move(o._ctl_manual);
             _ctl_pattern = std::move(o._ctl_pattern);
+            _ctl_script = std::move(o._ctl_script);
             return *this;
         }
         ~AxisControlElement()
@@ -18,6 +18,7 @@ eTCodeInteractive::eTCodeInteractive() noexcept
 }
 eTCodeInteractive::~eTCodeInteractive()
 {
+    _output.stop();
     EV::Queue().removeListener(PlayPauseChangeEvent::EventType, _play_pause_change_handle);
 }
 
@@ -48,11 +49,3 @@ void eTCodeInteractive::_on_video_playpause_change(const PlayPauseChangeEvent* e
     }
 }
 
-size_t eTCodeInteractive::_handle_axes_get_time_delta()
-{
-    auto current_time = std::chrono::steady_clock::now();
-    auto delta_time = current_time - _handle_axes_last_time;
-    size_t delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(delta_time).count();
-    _handle_axes_last_time += std::chrono::milliseconds(delta_ms);
-    return delta_ms;
-}
@@ -9,6 +9,7 @@
 #include <OFS_VideoplayerEvents.h>
 #include <OFS_EventSystem.h>
 #include <UI/OFS_ETCode/axis_control.hpp>
+#include <UI/OFS_ETCode/output_thread.hpp>
 #include <UI/OFS_ETCode/state.hpp>
 #include <tcode/ParserDispatcher.hpp>
 
@@ -43,8 +44,12 @@ protected:
     std::map<cmd_idx_prop_name_key_t, plot_history_t, std::less<>> _plot_history{};
     std::map<cmd_idx_prop_name_key_t, text_input_t, std::less<>> _text_input_tmp{};
 
+    /** Structural changes only on the UI thread, while holding the registry lock. */
     std::vector<sevfate::AxisControlElement> _axis_control_state;
-    std::chrono::steady_clock::time_point _handle_axes_last_time;
+    /** Smoothed time spent in device I/O per frame, in milliseconds. */
+    double _io_time_ms = 0.0;
+    /** Sends axis commands and pending requests while connected. */
+    sevfate::AxisOutputThread _output;
 
     /** Internal configuration */
     static constexpr uint32_t AXIS_DEFAULT_DIGIT_COUNT = 3;
@@ -65,6 +70,9 @@ public:
 
     void render_ui(bool* open);
 
+    bool is_connected() const { return _connection_active && _state.is_connected(); }
+    double io_time_ms() const { return _io_time_ms; }
+
 private:
     void _build_connection_tab();
     void _build_info_tab(tcode::Registry& reg);
@@ -84,11 +92,14 @@ private:
         tcode::PropertyMetadata& prop_meta);
     void _build_property(tcode::common::CommandIndex cmd_idx, const std::string& prop_name, tcode::PropertyMetadata& prop_meta);
 
-    void _handle_axes();
+    /** Runs on the output thread. */
+    void _handle_axes(const sevfate::PlaybackClock& clock, uint64_t counter, size_t delta_ms);
     void _handle_axes_on_pause();
     void _handle_axes_on_play();
-    size_t _handle_axes_get_time_delta();
+    /** Hands the player clock and script changes to the output thread. */
+    void _sync_axes();
     void _handle_io();
+    void _build_output_stats();
     /** Performs a manual state reset */
     void _disconnect();
 
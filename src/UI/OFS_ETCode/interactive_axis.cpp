@@ -190,7 +190,10 @@ namespace sevfate {
                 const bool is_selected = loaded_script == linked_funscript;
                 if (ImGui::Selectable(loaded_script->Title().c_str(), is_selected)) {
                     _script = loaded_script;
-                    _ms_until_next_update = 0;
+                    if (!_snapshot) {
+                        _snapshot = std::make_shared<SnapshotBuffer<ScriptSnapshot>>();
+                    }
+                    _resync = true;
                 }
                 if (is_selected) {
                     ImGui::SetItemDefaultFocus();
@@ -199,7 +202,14 @@ namespace sevfate {
             ImGui::EndCombo();
         }
         if (ImGui::Checkbox("Invert", &_invert)) {
-            _ms_until_next_update = 0;
+            _resync = true;
+        }
+        if (ImGui::SliderInt("Latency", &_latency_ms, 0, MAX_LATENCY_MS, "%d ms", ImGuiSliderFlags_AlwaysClamp)) {
+            _reschedule = true;
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Commands are sent this much ahead of the script.\n"
+                              "Set it to the delay between sending a command and the device moving.");
         }
         if (ImGui::TreeNode("Debug display")) {
             auto& last_cmd = get_last_command();
@@ -223,7 +233,8 @@ namespace sevfate {
                     /* NOP */
                 } break;
             }
-            ImGui::Text("Next command in %d ms", _ms_until_next_update);
+            ImGui::Text("Next command in %.1f ms", _next_command_in_ms);
+            ImGui::Text("Scheduled segments: %zu", _schedule.size());
             ImGui::TreePop();
         }
     }
@@ -288,9 +299,8 @@ void eTCodeInteractive::_build_axis_control(tcode::common::CommandIndex cmd_idx,
     }
 }
 
-void eTCodeInteractive::_handle_axes()
+void eTCodeInteractive::_handle_axes(const sevfate::PlaybackClock& clock, uint64_t counter, size_t delta_ms)
 {
-    auto delta_ms = _handle_axes_get_time_delta();
     auto [reg_lck, reg] = _state.acquire_registry();
     for (auto& cmd_idx_ep : reg.get_endpoints()) {
         tcode::common::CommandIndex cmd_idx = cmd_idx_ep.first;
@@ -308,13 +318,22 @@ void eTCodeInteractive::_handle_axes()
                     ep_ctl_state.get_ctl_pattern().apply(ep, delta_ms);
                 } break;
                 case sevfate::AxisControlState::Script: {
-                    ep_ctl_state.get_ctl_script().apply(ep, delta_ms);
+                    ep_ctl_state.get_ctl_script().apply(ep, clock, counter);
                 } break;
             }
         }
     }
 }
 
+void eTCodeInteractive::_sync_axes()
+{
+    _output.publish_clock(OpenFunscripter::ptr->player->PlaybackAnchor());
+    // The output thread only reads the vector, it's only resized on this thread.
+    for (auto& ep_ctl_state : _axis_control_state) {
+        ep_ctl_state.get_ctl_script().sync_snapshot();
+    }
+}
+
 void eTCodeInteractive::_handle_axes_on_pause()
 {
     auto [reg_lck, reg] = _state.acquire_registry();
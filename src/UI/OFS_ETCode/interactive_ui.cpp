@@ -85,7 +85,15 @@ void eTCodeInteractive::render_ui(bool* open)
      * If I ever manage to get async rendering working,
      * this should move after the queue submission.
      */
+    auto io_start = std::chrono::steady_clock::now();
     _handle_io();
+    if (is_connected()) {
+        std::chrono::duration<double, std::milli> io_time = std::chrono::steady_clock::now() - io_start;
+        _io_time_ms += (io_time.count() - _io_time_ms) * 0.1;
+    }
+    else {
+        _io_time_ms = 0.0;
+    }
 }
 
 void eTCodeInteractive::_build_connection_tab()
@@ -131,6 +139,9 @@ void eTCodeInteractive::_build_connection_tab()
     ImGui::Checkbox("Apply default property update intervals",
         &_enable_suggested_property_intervals);
     ImGui::Checkbox("Enable packet tracing", &_enable_packet_tracing);
+    ImGui::EndDisabled();
+    _build_output_stats();
+    ImGui::BeginDisabled(_connection_active);
     if (ImGui::CollapsingHeader("Serial port settings")) {
         bool en = _conn_cfg.serial_port_enabled();
         if (ImGui::Checkbox("Enable", &en)) {
@@ -200,6 +211,22 @@ void eTCodeInteractive::_build_connection_tab()
     ImGui::Separator();
     ImGui::TextUnformatted("Middle click properties to refresh them!");
 }
+void eTCodeInteractive::_build_output_stats()
+{
+    if (!_output.is_running() || !ImGui::CollapsingHeader("Output timing")) {
+        return;
+    }
+    const auto& stats = _output.get_stats();
+    ImGui::BulletText("Period: %.2f ms", std::chrono::duration<double, std::milli>(sevfate::AxisOutputThread::PERIOD).count());
+    ImGui::BulletText("Ticks: %llu (%llu overruns)", static_cast<unsigned long long>(stats.ticks),
+        static_cast<unsigned long long>(stats.overruns));
+    ImGui::BulletText("Wake-up lateness: mean %.0f us, p99 %.0f us, max %.0f us", stats.lateness_mean_us(),
+        stats.lateness_percentile_us(0.99), stats.lateness_max_us);
+    ImGui::BulletText("Tick work: mean %.0f us, max %.0f us", stats.work_mean_us(), stats.work_max_us);
+    if (ImGui::Button("Reset statistics")) {
+        _output.reset_stats();
+    }
+}
 void eTCodeInteractive::_build_info_tab(tcode::Registry& reg)
 {
     if (ImGui::CollapsingHeader("Connection info")) {
@@ -404,14 +431,25 @@ void eTCodeInteractive::_handle_io()
 {
     if (_connection_active) {
         if (_state.is_connected()) {
-            // Calculate and apply patterns.
-            _handle_axes();
-            // Send any pending requests.
-            if (!_state.is_response_pending() && _state.send_registry_pending_requests()) {
-                _state.end_request();
+            // Patterns, scripts and pending requests are sent from the output thread.
+            _sync_axes();
+            if (!_output.is_running()) {
+                _output.start([this](const sevfate::PlaybackClock& clock, uint64_t counter, size_t delta_ms) {
+                    if (!_state.is_connected()) {
+                        return;
+                    }
+                    // Calculate and apply patterns.
+                    _handle_axes(clock, counter, delta_ms);
+                    // Send any pending requests.
+                    if (!_state.is_response_pending() && _state.send_registry_pending_requests()) {
+                        _state.end_request();
+                    }
+                });
             }
         }
         else if (!_state.is_connecting()) {
+            // Restarted once the new connection is up.
+            _output.stop();
             // Create different packet trace files for each connection.
             _state.set_packet_tracing(false);
             // Try to (re)connect.
@@ -434,6 +472,8 @@ void eTCodeInteractive::_handle_io()
 }
 void eTCodeInteractive::_disconnect()
 {
+    // Nothing may touch the axes or the connection from here on.
+    _output.stop();
     // Reset extra UI state.
     _text_input_tmp.clear();
     _axis_control_state.clear();
@@ -446,8 +486,6 @@ void eTCodeInteractive::_disconnect()
 }
 void eTCodeInteractive::_connection_setup()
 {
-    // Reset time offset for axes pattern delta time.
-    _handle_axes_last_time = std::chrono::steady_clock::now();
     // Set extra options before finalizing connection.
     _state.set_packet_tracing(_enable_packet_tracing);
     _state.start_detached_event_loop([this](tcode::ParserDispatcher& state) {
@@ -0,0 +1,141 @@
+#include "output_thread.hpp"
+
+#include <SDL_timer.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace sevfate {
+
+    double PlaybackClock::time_at(uint64_t counter) const
+    {
+        if (anchor.paused) {
+            return anchor.time;
+        }
+        // The anchor may be newer than counter, which was taken before picking it up.
+        double elapsed = static_cast<double>(static_cast<int64_t>(counter - anchor.counter)) / static_cast<double>(SDL_GetPerformanceFrequency());
+        return anchor.time + elapsed * anchor.speed;
+    }
+
+    bool PlaybackClock::continues_with(const OFS_PlaybackAnchor& next) const
+    {
+        if (next.seeks != anchor.seeks || next.paused != anchor.paused || next.speed != anchor.speed) {
+            return false;
+        }
+        return std::abs(time_at(next.counter) - next.time) <= DRIFT_TOLERANCE_S;
+    }
+
+    void OutputJitterStats::add(double lateness_us, double work_us)
+    {
+        uint32_t bucket = 0;
+        while (bucket < BUCKET_COUNT - 1 && lateness_us > bucket_limit_us(bucket)) {
+            bucket++;
+        }
+        lateness_buckets[bucket]++;
+        ticks++;
+        lateness_total_us += lateness_us;
+        lateness_max_us = std::max(lateness_max_us, lateness_us);
+        work_total_us += work_us;
+        work_max_us = std::max(work_max_us, work_us);
+    }
+
+    double OutputJitterStats::lateness_percentile_us(double p) const
+    {
+        if (ticks == 0) {
+            return 0.0;
+        }
+        uint64_t target = static_cast<uint64_t>(std::ceil(p * ticks));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BUCKET_COUNT - 1; i++) {
+            seen += lateness_buckets[i];
+            if (seen >= target) {
+                return std::min(bucket_limit_us(i), lateness_max_us);
+            }
+        }
+        return lateness_max_us;
+    }
+
+    AxisOutputThread::~AxisOutputThread()
+    {
+        stop();
+    }
+
+    void AxisOutputThread::start(tick_callback_t&& tick)
+    {
+        stop();
+        _running = true;
+        _thread = std::thread(&AxisOutputThread::_thread_main, this, std::move(tick));
+    }
+
+    void AxisOutputThread::stop()
+    {
+        _running = false;
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+    void AxisOutputThread::publish_clock(const OFS_PlaybackAnchor& anchor)
+    {
+        _clock.back() = anchor;
+        _clock.publish();
+    }
+
+    const OutputJitterStats& AxisOutputThread::get_stats()
+    {
+        _stats.update();
+        return _stats.front();
+    }
+
+    void AxisOutputThread::_thread_main(tick_callback_t tick)
+    {
+        using clock_t = std::chrono::steady_clock;
+        using us_t = std::chrono::duration<double, std::micro>;
+
+        OutputJitterStats stats;
+        // A fresh epoch makes every link resync, whatever it scheduled before the restart is stale.
+        PlaybackClock clock;
+        _clock.update();
+        clock.anchor = _clock.front();
+        clock.epoch = ++_epoch;
+        auto deadline = clock_t::now();
+        auto last_tick = deadline;
+        auto next_stats_publish = deadline + STATS_PUBLISH_INTERVAL;
+
+        while (_running.load(std::memory_order_relaxed)) {
+            deadline += PERIOD;
+            std::this_thread::sleep_until(deadline);
+            auto wake_time = clock_t::now();
+
+            // Whole milliseconds are handed out, the remainder carries over to the next tick.
+            size_t delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(wake_time - last_tick).count();
+            last_tick += std::chrono::milliseconds(delta_ms);
+
+            if (_clock.update()) {
+                const auto& anchor = _clock.front();
+                if (!clock.continues_with(anchor)) {
+                    clock.epoch = ++_epoch;
+                }
+                clock.anchor = anchor;
+            }
+            tick(clock, SDL_GetPerformanceCounter(), delta_ms);
+
+            auto done_time = clock_t::now();
+            if (_reset_stats.exchange(false, std::memory_order_relaxed)) {
+                stats = OutputJitterStats();
+            }
+            stats.add(us_t(wake_time - deadline).count(), us_t(done_time - wake_time).count());
+            if (done_time - deadline > PERIOD) {
+                // Don't try to catch up on missed ticks, the callback already got the full delta.
+                stats.overruns++;
+                deadline = done_time;
+            }
+            if (done_time >= next_stats_publish) {
+                _stats.back() = stats;
+                _stats.publish();
+                next_stats_publish = done_time + STATS_PUBLISH_INTERVAL;
+            }
+        }
+    }
+
+} // namespace sevfate
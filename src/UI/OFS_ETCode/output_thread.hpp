@@ -0,0 +1,175 @@
+#ifndef SATR_VK_SEVFATE_OUTPUT_THREAD_HPP
+#define SATR_VK_SEVFATE_OUTPUT_THREAD_HPP
+/**
+ * @file
+ * @brief Device output thread, decoupled from the UI frame loop.
+ */
+
+#include <OFS_Videoplayer.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace sevfate {
+
+    /**
+     * Single producer, single consumer triple buffer.
+     * The writer fills back() and publishes it, the reader picks up the latest published value.
+     * Neither side ever waits on the other, the reader skips values it was too slow for.
+     */
+    template<typename T>
+    class SnapshotBuffer {
+    protected:
+        static constexpr uint8_t INDEX_MASK = 0x3;
+        static constexpr uint8_t DIRTY_BIT = 0x4;
+
+        std::array<T, 3> _slots{};
+        /** Index of the slot in between writer and reader. */
+        std::atomic<uint8_t> _middle = 1;
+        uint8_t _back = 0;
+        uint8_t _front = 2;
+
+    public:
+        SnapshotBuffer() = default;
+        SnapshotBuffer(const SnapshotBuffer&) = delete;
+        SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+        /** Writer side. The slot holds an older value which has to be overwritten completely. */
+        T& back()
+        {
+            return _slots[_back];
+        }
+        void publish()
+        {
+            _back = _middle.exchange(_back | DIRTY_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        /**
+         * Reader side.
+         * @returns true if a newer value was picked up.
+         */
+        bool update()
+        {
+            if (!(_middle.load(std::memory_order_relaxed) & DIRTY_BIT)) {
+                return false;
+            }
+            _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+        const T& front() const
+        {
+            return _slots[_front];
+        }
+    };
+
+    struct PlaybackClock {
+        /**
+         * Seeks are detected through OFS_PlaybackAnchor::seeks.
+         * Smaller differences to where the previous anchor extrapolates to are drift and frame hitches
+         * which get absorbed, only jumps the player made on its own beyond this count as seeks.
+         */
+        static constexpr double DRIFT_TOLERANCE_S = 0.5;
+
+        OFS_PlaybackAnchor anchor{};
+        /** Changes on every seek, pause, resume and speed change and whenever the output thread starts. */
+        uint32_t epoch = 0;
+
+        /** Playback time in seconds at the given SDL_GetPerformanceCounter() value. */
+        double time_at(uint64_t counter) const;
+        /** @returns false if playback jumped or changed its state between the anchors. */
+        bool continues_with(const OFS_PlaybackAnchor& next) const;
+    };
+
+    /** Timing of the output thread ticks, in microseconds. */
+    struct OutputJitterStats {
+        static constexpr uint32_t BUCKET_COUNT = 16;
+        static constexpr double FIRST_BUCKET_US = 4.0;
+
+        /** How late the thread woke up compared to its schedule. */
+        std::array<uint32_t, BUCKET_COUNT> lateness_buckets{};
+        uint64_t ticks = 0;
+        /** Ticks which woke up more than a whole period late and got rescheduled. */
+        uint64_t overruns = 0;
+        double lateness_total_us = 0.0;
+        double lateness_max_us = 0.0;
+        /** Time spent in the tick itself, including waiting for the registry. */
+        double work_total_us = 0.0;
+        double work_max_us = 0.0;
+
+        void add(double lateness_us, double work_us);
+        /** Upper bound of the bucket containing the percentile. */
+        double lateness_percentile_us(double p) const;
+        double lateness_mean_us() const
+        {
+            return ticks > 0 ? lateness_total_us / ticks : 0.0;
+        }
+        double work_mean_us() const
+        {
+            return ticks > 0 ? work_total_us / ticks : 0.0;
+        }
+        static double bucket_limit_us(uint32_t bucket)
+        {
+            return FIRST_BUCKET_US * static_cast<double>(1u << bucket);
+        }
+    };
+
+    /**
+     * Ticks at a fixed period on its own thread.
+     * The UI publishes the player clock every frame, the thread extrapolates it
+     * with the high resolution counter so frame hitches don't reach the device.
+     */
+    class AxisOutputThread {
+    public:
+        /** Called on the output thread with the whole milliseconds passed since the last call. */
+        using tick_callback_t = std::function<void(const PlaybackClock& clock, uint64_t counter, size_t delta_ms)>;
+
+        static constexpr std::chrono::microseconds PERIOD{ 1000 };
+        static constexpr std::chrono::milliseconds STATS_PUBLISH_INTERVAL{ 250 };
+
+    protected:
+        std::thread _thread;
+        std::atomic<bool> _running = false;
+        std::atomic<bool> _reset_stats = false;
+        /** Last epoch handed out, continues across restarts so links resync after a reconnect. */
+        uint32_t _epoch = 0;
+        SnapshotBuffer<OFS_PlaybackAnchor> _clock;
+        SnapshotBuffer<OutputJitterStats> _stats;
+
+    public:
+        AxisOutputThread() = default;
+        AxisOutputThread(const AxisOutputThread&) = delete;
+        AxisOutputThread& operator=(const AxisOutputThread&) = delete;
+        ~AxisOutputThread();
+
+        bool is_running() const
+        {
+            return _running.load(std::memory_order_relaxed);
+        }
+
+        void start(tick_callback_t&& tick);
+        /** Blocks until the current tick finished. */
+        void stop();
+
+        /** @name UI thread interface */
+        ///@{
+        void publish_clock(const OFS_PlaybackAnchor& anchor);
+        /** Latest statistics, refreshed every STATS_PUBLISH_INTERVAL. */
+        const OutputJitterStats& get_stats();
+        void reset_stats()
+        {
+            _reset_stats.store(true, std::memory_order_relaxed);
+        }
+        ///@}
+
+    private:
+        void _thread_main(tick_callback_t tick);
+    };
+
+} // namespace sevfate
+
+#endif /*SATR_VK_SEVFATE_OUTPUT_THREAD_HPP*/
@@ -87,6 +87,10 @@ bool OFS_Preferences::ShowPreferenceWindow() noexcept
 						save = true;
 					}
 					OFS::Tooltip(TR(VSYNC_TOOLTIP));
+					if (ImGui::Checkbox(TR(REDRAW_ON_DEMAND), &state.redrawOnDemand)) {
+						save = true;
+					}
+					OFS::Tooltip(TR(REDRAW_ON_DEMAND_TOOLTIP));
 					ImGui::Separator();
 					ImGui::InputText(TR(FONT), state.fontOverride.empty() ? (char*)TR(DEFAULT_FONT) : (char*)state.fontOverride.c_str(),
 						state.fontOverride.size(), ImGuiInputTextFlags_ReadOnly);
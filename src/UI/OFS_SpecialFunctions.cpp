@@ -13,8 +13,16 @@
 
 #include "SDL_thread.h"
 #include "SDL_atomic.h"
+#include "OFS_JobSystem.h"
 
 #include <cmath>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64)
+#define OFS_RDP_SSE2
+#include "emmintrin.h"
+#endif
 
 SpecialFunctionsWindow::SpecialFunctionsWindow() noexcept
 {
@@ -37,6 +45,12 @@ void SpecialFunctionsWindow::SetFunction(SpecialFunctionType functionEnum) noexc
         case SpecialFunctionType::RamerDouglasPeucker:
             function = new RamerDouglasPeucker();
             break;
+        case SpecialFunctionType::VisvalingamWhyatt:
+            function = new VisvalingamWhyatt();
+            break;
+        case SpecialFunctionType::SimplifyToCount:
+            function = new SimplifyToCount();
+            break;
         default:
             function = new FunctionRangeExtender();
             functionEnum = SpecialFunctionType::RangeExtender;
@@ -59,6 +73,8 @@ void SpecialFunctionsWindow::ShowFunctionsWindow(bool* open) noexcept
         {
             case SpecialFunctionType::RangeExtender: return TR(FUNCTIONS_RANGE_EXTENDER);
             case SpecialFunctionType::RamerDouglasPeucker: return TR(FUNCTIONS_SIMPLIFY);
+            case SpecialFunctionType::VisvalingamWhyatt: return TR(FUNCTIONS_SIMPLIFY_AREA);
+            case SpecialFunctionType::SimplifyToCount: return TR(FUNCTIONS_SIMPLIFY_COUNT);
         }
         return "";
     };
@@ -70,6 +86,14 @@ void SpecialFunctionsWindow::ShowFunctionsWindow(bool* open) noexcept
         {
             SetFunction(SpecialFunctionType::RamerDouglasPeucker);
         }
+        if(ImGui::Selectable(TR(FUNCTIONS_SIMPLIFY_AREA), state.selectedFunction == SpecialFunctionType::VisvalingamWhyatt))
+        {
+            SetFunction(SpecialFunctionType::VisvalingamWhyatt);
+        }
+        if(ImGui::Selectable(TR(FUNCTIONS_SIMPLIFY_COUNT), state.selectedFunction == SpecialFunctionType::SimplifyToCount))
+        {
+            SetFunction(SpecialFunctionType::SimplifyToCount);
+        }
         if(ImGui::Selectable(TR(FUNCTIONS_RANGE_EXTENDER), state.selectedFunction == SpecialFunctionType::RangeExtender))
         {
             SetFunction(SpecialFunctionType::RangeExtender);
@@ -137,145 +161,586 @@ void FunctionRangeExtender::DrawUI() noexcept
     }
 }
 
-RamerDouglasPeucker::RamerDouglasPeucker() noexcept
+struct SimplifyPreview::Job
 {
-    auto app = OpenFunscripter::ptr;
-    eventUnsub = EV::MakeUnsubscibeFn(FunscriptSelectionChangedEvent::EventType, EV::Queue().appendListener(FunscriptSelectionChangedEvent::EventType,
-        FunscriptSelectionChangedEvent::HandleEvent(EVENT_SYSTEM_BIND(this, &RamerDouglasPeucker::SelectionChanged))));
+    std::shared_ptr<const FunscriptArray> points;
+    std::shared_ptr<SimplifyWork> work;
+    FunscriptArray result;
+    uint32_t generation = 0;
+    // set by the prepare job
+    uint32_t parts = 0;
+    // parts which didn't return yet, the last one runs Finish
+    SDL_atomic_t remaining = {0};
+
+    // only used on the main thread
+    std::vector<OFS_JobHandle> handles;
+    uint32_t partsDone = 0;
+    bool cancelled = false;
+    bool failed = false;
+    bool done = false;
+
+    void Cancel() noexcept
+    {
+        cancelled = true;
+        for (auto& handle : handles) handle->Cancel();
+    }
+};
+
+static void SimplifyPartsDone(const std::shared_ptr<SimplifyPreview::Job>& job, const OFS_Job& part) noexcept
+{
+    if (!part.Succeeded()) {
+        // a cancelled part leaves the result incomplete
+        job->failed = true;
+        job->Cancel();
+    }
+    job->partsDone += 1;
+    job->done = job->partsDone == job->parts;
 }
 
-RamerDouglasPeucker::~RamerDouglasPeucker() noexcept
+static void SimplifyPrepared(const std::shared_ptr<SimplifyPreview::Job>& job, const OFS_Job& prepare) noexcept
 {
-    eventUnsub();
+    if (!prepare.Succeeded() || job->cancelled) {
+        job->failed = true;
+        job->done = true;
+        return;
+    }
+    if (job->parts == 0) {
+        job->done = true;
+        return;
+    }
+    SDL_AtomicSet(&job->remaining, (int)job->parts);
+    for (uint32_t i = 0; i < job->parts; i += 1) {
+        auto& handle = job->handles.emplace_back(OFS_JobSystem::ptr->Submit(TR(SIMPLIFY_PREVIEW),
+            [job, i](OFS_JobContext& ctx) noexcept {
+                job->work->Part(i);
+                if (SDL_AtomicAdd(&job->remaining, -1) == 1) {
+                    job->work->Finish(job->result);
+                }
+                return true;
+            },
+            [job](const OFS_Job& part) noexcept { SimplifyPartsDone(job, part); }));
+        // every slider move starts new ones, they would flood the jobs window
+        handle->Hidden = true;
+    }
 }
 
-void RamerDouglasPeucker::SelectionChanged(const FunscriptSelectionChangedEvent* ev) noexcept
+SimplifyPreview::~SimplifyPreview() noexcept
 {
-    OFS_PROFILE(__FUNCTION__);
-    auto app = OpenFunscripter::ptr;
-    if (!app->ActiveFunscript()->Selection().empty()) {
-        epsilon = 0.f;
-        createUndoState = true;
+    // the jobs own everything they use, the result gets dropped
+    if (running) running->Cancel();
+}
+
+void SimplifyPreview::start(std::shared_ptr<const FunscriptArray>&& points, std::shared_ptr<SimplifyWork>&& work) noexcept
+{
+    auto job = std::make_shared<Job>();
+    job->points = std::move(points);
+    job->work = std::move(work);
+    job->generation = generation;
+    auto& handle = job->handles.emplace_back(OFS_JobSystem::ptr->Submit(TR(SIMPLIFY_PREVIEW),
+        [job](OFS_JobContext& ctx) noexcept {
+            job->parts = job->work->Prepare(*job->points);
+            if (job->parts == 0) {
+                job->work->Finish(job->result);
+            }
+            return true;
+        },
+        [job](const OFS_Job& prepare) noexcept { SimplifyPrepared(job, prepare); }));
+    handle->Hidden = true;
+    running = std::move(job);
+}
+
+void SimplifyPreview::Request(std::shared_ptr<const FunscriptArray> points, std::shared_ptr<SimplifyWork> work) noexcept
+{
+    if (running) {
+        // only the latest request is of interest
+        pendingPoints = std::move(points);
+        pendingWork = std::move(work);
+        running->Cancel();
+        return;
     }
+    start(std::move(points), std::move(work));
 }
 
-inline static float PointLineDistance(FunscriptAction pt, FunscriptAction lineStart, FunscriptAction lineEnd) noexcept {
-    float dx = lineEnd.atS - lineStart.atS;
-    float dy = lineEnd.pos - lineStart.pos;
+bool SimplifyPreview::Poll(FunscriptArray& result) noexcept
+{
+    if (!running || !running->done) return false;
+    auto job = std::move(running);
+    if (pendingWork) {
+        start(std::move(pendingPoints), std::move(pendingWork));
+        pendingWork.reset();
+    }
+    if (job->failed || job->generation != generation) return false;
+    result = std::move(job->result);
+    return true;
+}
 
-    // Normalize
-    float mag = sqrtf(dx * dx + dy * dy);
-    if (mag > 0.0f) {
-        dx /= mag;
-        dy /= mag;
+void SimplifyPreview::Cancel() noexcept
+{
+    generation += 1;
+    pendingPoints.reset();
+    pendingWork.reset();
+    if (running) running->Cancel();
+}
+
+// Runs a simplification which can't be split up as a single job
+class SequentialSimplifyWork : public SimplifyWork
+{
+public:
+    using SimplifyFn = std::function<void(const FunscriptArray& points, FunscriptArray& result)>;
+private:
+    SimplifyFn fn;
+    FunscriptArray result;
+public:
+    SequentialSimplifyWork(SimplifyFn&& fn) noexcept
+        : fn(std::move(fn)) {}
+
+    uint32_t Prepare(const FunscriptArray& points) noexcept override
+    {
+        fn(points, result);
+        return 0;
     }
-    float pvx = pt.atS - lineStart.atS;
-    float pvy = pt.pos - lineStart.pos;
+    void Finish(FunscriptArray& out) noexcept override { out = std::move(result); }
+};
 
-    // Get dot product (project pv onto normalized direction)
-    float pvdot = dx * pvx + dy * pvy;
+// Points split into coordinate arrays so the distance scan can use SIMD
+struct RdpPoints
+{
+    std::vector<float> x;
+    std::vector<float> y;
+};
 
-    // Scale line direction vector and subtract it from pv
-    float ax = pvx - pvdot * dx;
-    float ay = pvy - pvdot * dy;
+// Returns the index of the point in (first, last) furthest away from the line between first and last.
+// Distances are compared as |cross product| which is the distance scaled by the length of the line.
+static int32_t FurthestPoint(const RdpPoints& pts, int32_t first, int32_t last, float* outScaledDistance) noexcept
+{
+    const float x0 = pts.x[first], y0 = pts.y[first];
+    const float dx = pts.x[last] - x0;
+    const float dy = pts.y[last] - y0;
+    const float* xs = pts.x.data();
+    const float* ys = pts.y.data();
+
+    int32_t i = first + 1;
+    float best = -1.f;
+    int32_t bestIdx = first;
+
+#ifdef OFS_RDP_SSE2
+    const __m128 vx0 = _mm_set1_ps(x0), vy0 = _mm_set1_ps(y0);
+    const __m128 vdx = _mm_set1_ps(dx), vdy = _mm_set1_ps(dy);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 vbest = _mm_set1_ps(-1.f);
+    __m128i vbestIdx = _mm_set1_epi32(first);
+    __m128i vidx = _mm_setr_epi32(i, i + 1, i + 2, i + 3);
+    const __m128i four = _mm_set1_epi32(4);
+    for (; i + 4 <= last; i += 4) {
+        __m128 px = _mm_sub_ps(_mm_loadu_ps(xs + i), vx0);
+        __m128 py = _mm_sub_ps(_mm_loadu_ps(ys + i), vy0);
+        __m128 cross = _mm_and_ps(_mm_sub_ps(_mm_mul_ps(vdx, py), _mm_mul_ps(vdy, px)), absMask);
+        // strictly greater keeps the first index per lane
+        __m128 greater = _mm_cmpgt_ps(cross, vbest);
+        vbest = _mm_or_ps(_mm_and_ps(greater, cross), _mm_andnot_ps(greater, vbest));
+        __m128i greaterI = _mm_castps_si128(greater);
+        vbestIdx = _mm_or_si128(_mm_and_si128(greaterI, vidx), _mm_andnot_si128(greaterI, vbestIdx));
+        vidx = _mm_add_epi32(vidx, four);
+    }
 
-    return sqrtf(ax * ax + ay * ay);
+    alignas(16) float lanes[4];
+    alignas(16) int32_t laneIdx[4];
+    _mm_store_ps(lanes, vbest);
+    _mm_store_si128((__m128i*)laneIdx, vbestIdx);
+    for (int lane = 0; lane < 4; lane += 1) {
+        if (lanes[lane] > best || (lanes[lane] == best && laneIdx[lane] < bestIdx)) {
+            best = lanes[lane];
+            bestIdx = laneIdx[lane];
+        }
+    }
+#endif
+    // the remainder, or everything without SSE2
+    for (; i < last; i += 1) {
+        float cross = std::abs(dx * (ys[i] - y0) - dy * (xs[i] - x0));
+        if (cross > best) {
+            best = cross;
+            bestIdx = i;
+        }
+    }
+    *outScaledDistance = best;
+    return bestIdx;
 }
 
-static std::vector<bool> DouglasPeucker(const FunscriptArray& points, int startIndex, int lastIndex, float epsilon) noexcept {
-    OFS_PROFILE(__FUNCTION__);
-    std::vector<std::pair<int, int>> stk;
-    stk.push_back(std::make_pair(startIndex, lastIndex));
-    
-    int globalStartIndex = startIndex;
-    auto bitArray = std::vector<bool>();
-    bitArray.resize(lastIndex - startIndex + 1, true);
-
-    while (!stk.empty()) {
-        startIndex = stk.back().first;
-        lastIndex = stk.back().second;
-        stk.pop_back();
-
-        float dmax = 0.f;
-        int index = startIndex;
-
-        for (int i = index + 1; i < lastIndex; ++i) {
-            if (bitArray[i - globalStartIndex]) {
-                float d = PointLineDistance(points[i], points[startIndex], points[lastIndex]);
-
-                if (d > dmax) {
-                    index = i;
-                    dmax = d;
-                }
-            }
+// Simplifies [first, last] using an explicit stack, keep is written for indices in (first, last) only.
+static void DouglasPeuckerRange(const RdpPoints& pts, int32_t first, int32_t last, float epsilon, uint8_t* keep) noexcept
+{
+    std::vector<std::pair<int32_t, int32_t>> stack;
+    stack.emplace_back(first, last);
+    while (!stack.empty()) {
+        auto [start, end] = stack.back();
+        stack.pop_back();
+        if (end - start < 2) continue;
+
+        float scaledDistance;
+        int32_t index = FurthestPoint(pts, start, end, &scaledDistance);
+        float length = std::sqrt((pts.x[end] - pts.x[start]) * (pts.x[end] - pts.x[start])
+            + (pts.y[end] - pts.y[start]) * (pts.y[end] - pts.y[start]));
+        if (scaledDistance > epsilon * length) {
+            keep[index] = 1;
+            stack.emplace_back(start, index);
+            stack.emplace_back(index, end);
         }
+    }
+}
+
+// Splits the points into independent ranges in Prepare, the parts simplify them in parallel
+class RdpSimplifyWork : public SimplifyWork
+{
+    // owned by the preview job, alive until Finish
+    const FunscriptArray* points = nullptr;
+    float epsilon;
+    int32_t maxParts;
+    RdpPoints pts;
+    std::vector<uint8_t> keep;
+    std::vector<std::pair<int32_t, int32_t>> ranges;
+    SDL_atomic_t nextRange = { 0 };
+
+public:
+    RdpSimplifyWork(float epsilon, int32_t maxParts) noexcept
+        : epsilon(epsilon), maxParts(maxParts) {}
+
+    uint32_t Prepare(const FunscriptArray& source) noexcept override;
+    void Part(uint32_t part) noexcept override;
+    void Finish(FunscriptArray& newActions) noexcept override;
+};
+
+uint32_t RdpSimplifyWork::Prepare(const FunscriptArray& source) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    points = &source;
+    int32_t count = (int32_t)source.size();
+    if (count < 3) {
+        keep.assign(count, 1);
+        return 0;
+    }
 
-        if (dmax > epsilon) {
-            stk.push_back(std::make_pair(startIndex, index));
-            stk.push_back(std::make_pair(index, lastIndex));
+    pts.x.resize(count);
+    pts.y.resize(count);
+    for (int32_t i = 0; i < count; i += 1) {
+        pts.x[i] = source[i].atS;
+        pts.y[i] = source[i].pos;
+    }
+    keep.assign(count, 0);
+    keep.front() = 1;
+    keep.back() = 1;
+
+    // Split the largest ranges until there are enough independent ones to keep every part busy.
+    // Ranges never overlap except for their end points, which are already decided.
+    constexpr int32_t MinParallelRange = 4096;
+    int32_t partCount = count >= MinParallelRange ? maxParts : 1;
+    ranges.emplace_back(0, count - 1);
+    auto rangeSize = [](auto& range) noexcept { return range.second - range.first; };
+    auto largerRange = [&](auto& a, auto& b) noexcept { return rangeSize(a) < rangeSize(b); };
+    while (partCount > 1 && (int32_t)ranges.size() < partCount * 4) {
+        std::pop_heap(ranges.begin(), ranges.end(), largerRange);
+        auto [start, end] = ranges.back();
+        if (end - start < MinParallelRange / 4) {
+            std::push_heap(ranges.begin(), ranges.end(), largerRange);
+            break;
         }
-        else {
-            for (int i = startIndex + 1; i < lastIndex; ++i) {
-                bitArray[i - globalStartIndex] = false;
-            }
+        ranges.pop_back();
+        float scaledDistance;
+        int32_t index = FurthestPoint(pts, start, end, &scaledDistance);
+        float length = std::sqrt((pts.x[end] - pts.x[start]) * (pts.x[end] - pts.x[start])
+            + (pts.y[end] - pts.y[start]) * (pts.y[end] - pts.y[start]));
+        if (scaledDistance > epsilon * length) {
+            keep[index] = 1;
+            ranges.emplace_back(start, index);
+            std::push_heap(ranges.begin(), ranges.end(), largerRange);
+            ranges.emplace_back(index, end);
+            std::push_heap(ranges.begin(), ranges.end(), largerRange);
         }
+        if (ranges.empty()) break;
     }
-
-    return bitArray;
+    // largest first so they don't end up last in one part
+    std::sort(ranges.begin(), ranges.end(), [&](auto& a, auto& b) noexcept { return rangeSize(a) > rangeSize(b); });
+
+    partCount = std::min(partCount, (int32_t)ranges.size());
+    if (partCount <= 1) {
+        // not worth more jobs
+        Part(0);
+        return 0;
+    }
+    return (uint32_t)partCount;
 }
 
-static void DouglasPeucker(const FunscriptArray& points, float epsilon, FunscriptArray& newActions) noexcept {
+void RdpSimplifyWork::Part(uint32_t part) noexcept
+{
     OFS_PROFILE(__FUNCTION__);
-    auto bitArray = DouglasPeucker(points, 0, points.size() - 1, epsilon);
-    newActions.reserve(points.size());
+    // every part takes the next range until none are left
+    for (int idx = SDL_AtomicAdd(&nextRange, 1); idx < (int)ranges.size(); idx = SDL_AtomicAdd(&nextRange, 1)) {
+        DouglasPeuckerRange(pts, ranges[idx].first, ranges[idx].second, epsilon, keep.data());
+    }
+}
 
-    for (int i = 0, n = points.size(); i < n; ++i) {
-        if (bitArray[i]) {
+void RdpSimplifyWork::Finish(FunscriptArray& newActions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto& source = *points;
+    int32_t count = (int32_t)source.size();
+    newActions.clear();
+    newActions.reserve(count);
+    for (int32_t i = 0; i < count; i += 1) {
+        if (keep[i]) {
             // we can safely assume points to be sorted
-            newActions.emplace_back_unsorted(points[i]);
+            newActions.emplace_back_unsorted(source[i]);
+        }
+    }
+}
+
+void RamerDouglasPeuckerSimplify(const FunscriptArray& points, float epsilon, int32_t maxParts, FunscriptArray& newActions) noexcept
+{
+    RdpSimplifyWork work(epsilon, maxParts);
+    uint32_t parts = work.Prepare(points);
+    for (uint32_t part = 0; part < parts; part += 1) {
+        work.Part(part);
+    }
+    work.Finish(newActions);
+}
+
+// Removes points by their effective area, the triangle with their neighbours.
+// The area of a point never gets smaller than the one of the point removed before it,
+// so the areas come out of the heap in order and minArea works as a threshold.
+// Stops at the first point with an area of at least minArea or once targetCount points remain,
+// pass 0 as targetCount to only use the threshold and infinity as minArea to only use the count.
+void VisvalingamWhyattSimplify(const FunscriptArray& points, float minArea, int32_t targetCount, FunscriptArray& newActions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    int32_t count = (int32_t)points.size();
+    newActions.clear();
+    targetCount = std::max(targetCount, 2);
+    if (count < 3 || count <= targetCount) {
+        newActions = points;
+        return;
+    }
+
+    std::vector<int32_t> prev(count);
+    std::vector<int32_t> next(count);
+    // negative once removed
+    std::vector<float> area(count, std::numeric_limits<float>::max());
+    auto triangleArea = [&points](int32_t a, int32_t b, int32_t c) noexcept {
+        auto pa = points[a], pb = points[b], pc = points[c];
+        return .5f * std::abs((pb.atS - pa.atS) * (pc.pos - pa.pos) - (pc.atS - pa.atS) * (pb.pos - pa.pos));
+    };
+
+    struct Entry
+    {
+        float area;
+        int32_t idx;
+        inline bool operator>(const Entry& other) const noexcept { return area > other.area || (area == other.area && idx > other.idx); }
+    };
+    std::vector<Entry> heap;
+    heap.reserve(count);
+    for (int32_t i = 0; i < count; i += 1) {
+        prev[i] = i - 1;
+        next[i] = i + 1;
+        if (i > 0 && i < count - 1) {
+            area[i] = triangleArea(i - 1, i, i + 1);
+            heap.push_back({ area[i], i });
+        }
+    }
+    auto heapOrder = std::greater<Entry>();
+    std::make_heap(heap.begin(), heap.end(), heapOrder);
+
+    int32_t remaining = count;
+    while (!heap.empty()) {
+        auto entry = heap.front();
+        if (remaining <= targetCount || entry.area >= minArea) break;
+        std::pop_heap(heap.begin(), heap.end(), heapOrder);
+        heap.pop_back();
+        // outdated entry of a point which got removed or whose area changed
+        if (area[entry.idx] != entry.area) continue;
+
+        int32_t before = prev[entry.idx];
+        int32_t after = next[entry.idx];
+        area[entry.idx] = -1.f;
+        next[before] = after;
+        prev[after] = before;
+        remaining -= 1;
+
+        for (int32_t neighbour : { before, after }) {
+            if (neighbour == 0 || neighbour == count - 1) continue;
+            area[neighbour] = std::max(triangleArea(prev[neighbour], neighbour, next[neighbour]), entry.area);
+            heap.push_back({ area[neighbour], neighbour });
+            std::push_heap(heap.begin(), heap.end(), heapOrder);
         }
     }
+
+    newActions.reserve(remaining);
+    for (int32_t i = 0; i < count; i = next[i]) {
+        // we can safely assume points to be sorted
+        newActions.emplace_back_unsorted(points[i]);
+    }
+}
+
+SimplifyFunctionBase::SimplifyFunctionBase() noexcept
+{
+    eventUnsub = EV::MakeUnsubscibeFn(FunscriptSelectionChangedEvent::EventType, EV::Queue().appendListener(FunscriptSelectionChangedEvent::EventType,
+        FunscriptSelectionChangedEvent::HandleEvent(EVENT_SYSTEM_BIND(this, &SimplifyFunctionBase::SelectionChanged))));
+}
+
+SimplifyFunctionBase::~SimplifyFunctionBase() noexcept
+{
+    eventUnsub();
+}
+
+void SimplifyFunctionBase::SelectionChanged(const FunscriptSelectionChangedEvent* ev) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto app = OpenFunscripter::ptr;
+    if (!app->ActiveFunscript()->Selection().empty()) {
+        resetParameters();
+        createUndoState = true;
+        source.reset();
+        preview.Cancel();
+    }
+}
+
+size_t SimplifyFunctionBase::sourceSize() noexcept
+{
+    return source ? source->size() : ctx().SelectionSize();
+}
+
+void SimplifyFunctionBase::applyResult(const FunscriptArray& newActions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto app = OpenFunscripter::ptr;
+    auto script = app->ActiveFunscript();
+    if (script != sourceScript.lock()) return;
+    if (applied) {
+        // the previous preview gets replaced
+        if (!script->undoSystem->MatchUndoTop(StateType::SIMPLIFY)) return;
+        app->undoSystem->Undo();
+    }
+    app->undoSystem->Snapshot(StateType::SIMPLIFY, script);
+    ctx().RemoveSelectedActions();
+    ctx().AddMultipleActions(newActions);
+    applied = true;
 }
 
-void RamerDouglasPeucker::DrawUI() noexcept
+void SimplifyFunctionBase::DrawUI() noexcept
 {
     OFS_PROFILE(__FUNCTION__);
     auto app = OpenFunscripter::ptr;
+    FunscriptArray newActions;
+    if (preview.Poll(newActions)) {
+        applyResult(newActions);
+    }
+
     if (app->ActiveFunscript()->SelectionSize() > 4 || (app->ActiveFunscript()->undoSystem->MatchUndoTop(StateType::SIMPLIFY))) {
-        if (ImGui::DragFloat(TR(EPSILON), &epsilon, 0.001f, 0.f, 0.f, "%.3f", ImGuiSliderFlags_AlwaysClamp)) {
-            epsilon = std::max(epsilon, 0.f);
-            if (createUndoState ||
+        if (drawParameters()) {
+            if (createUndoState || !source ||
                 !app->ActiveFunscript()->undoSystem->MatchUndoTop(StateType::SIMPLIFY)) {
-                // calculate average distance in selection
-                int count = 0;
-                for (int i = 0, size = ctx().Selection().size(); i < size - 1; ++i) {
-                    auto action1 = ctx().Selection()[i];
-                    auto action2 = ctx().Selection()[i + 1];
-                    
-                    float dx = action1.atS - action2.atS;
-                    float dy = action1.pos - action2.pos;
-                    float distance = sqrtf((dx * dx) + (dy * dy));
-                    averageDistance += distance;
-                    ++count;
-                }
-                averageDistance /= (float)count;
-            }
-            else {
-                app->undoSystem->Undo();
+                source = std::make_shared<const FunscriptArray>(ctx().Selection());
+                sourceScript = app->ActiveFunscript();
+                applied = false;
+                preview.Cancel();
+                sourceChanged();
             }
-            app->undoSystem->Snapshot(StateType::SIMPLIFY, app->ActiveFunscript());
-
             createUndoState = false;
-            auto selection = ctx().Selection();
-            ctx().RemoveSelectedActions();
-            FunscriptArray newActions;
-            newActions.reserve(selection.size());
-            float scaledEpsilon = epsilon * averageDistance;
-            DouglasPeucker(selection, scaledEpsilon, newActions);
-            ctx().AddMultipleActions(newActions);
+            preview.Request(source, simplifier());
+        }
+        if (preview.Busy()) {
+            ImGui::SameLine();
+            OFS::Spinner("##simplifySpinner", ImGui::GetFontSize() / 3.f, 4.f, ImGui::GetColorU32(ImGuiCol_ButtonActive));
         }
     }
     else {
         ImGui::Text(TR(SIMPLIFY_TXT));
     }
-}
\ No newline at end of file
+}
+
+// Ramer-Douglas-Peucker
+bool RamerDouglasPeucker::drawParameters() noexcept
+{
+    bool changed = ImGui::DragFloat(TR(EPSILON), &epsilon, 0.001f, 0.f, 0.f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+    epsilon = std::max(epsilon, 0.f);
+    return changed;
+}
+
+void RamerDouglasPeucker::sourceChanged() noexcept
+{
+    // calculate average distance in selection
+    auto& selection = *source;
+    int count = 0;
+    averageDistance = 0.f;
+    for (int i = 0, size = selection.size(); i < size - 1; ++i) {
+        auto action1 = selection[i];
+        auto action2 = selection[i + 1];
+
+        float dx = action1.atS - action2.atS;
+        float dy = action1.pos - action2.pos;
+        float distance = sqrtf((dx * dx) + (dy * dy));
+        averageDistance += distance;
+        ++count;
+    }
+    averageDistance /= (float)std::max(count, 1);
+}
+
+std::shared_ptr<SimplifyWork> RamerDouglasPeucker::simplifier() const noexcept
+{
+    float scaledEpsilon = epsilon * averageDistance;
+    return std::make_shared<RdpSimplifyWork>(scaledEpsilon, Util::Clamp(OFS_JobSystem::ptr->WorkerCount(), 1, 16));
+}
+
+// Visvalingam-Whyatt
+bool VisvalingamWhyatt::drawParameters() noexcept
+{
+    bool changed = ImGui::DragFloat(TR(AREA_THRESHOLD), &threshold, 0.001f, 0.f, 0.f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+    OFS::Tooltip(TR(AREA_THRESHOLD_TOOLTIP));
+    threshold = std::max(threshold, 0.f);
+    return changed;
+}
+
+void VisvalingamWhyatt::sourceChanged() noexcept
+{
+    // the threshold is relative to the average area in the selection
+    auto& selection = *source;
+    int count = 0;
+    averageArea = 0.f;
+    for (int i = 1, size = selection.size(); i < size - 1; ++i) {
+        auto a = selection[i - 1], b = selection[i], c = selection[i + 1];
+        averageArea += .5f * std::abs((b.atS - a.atS) * (c.pos - a.pos) - (c.atS - a.atS) * (b.pos - a.pos));
+        ++count;
+    }
+    averageArea /= (float)std::max(count, 1);
+}
+
+std::shared_ptr<SimplifyWork> VisvalingamWhyatt::simplifier() const noexcept
+{
+    float minArea = threshold * averageArea;
+    return std::make_shared<SequentialSimplifyWork>([minArea](const FunscriptArray& points, FunscriptArray& result) noexcept {
+        VisvalingamWhyattSimplify(points, minArea, 0, result);
+    });
+}
+
+// target count
+bool SimplifyToCount::drawParameters() noexcept
+{
+    int32_t maxCount = (int32_t)sourceSize();
+    if (targetCount <= 0 || targetCount > maxCount) targetCount = maxCount;
+    bool changed = ImGui::SliderInt(TR(TARGET_ACTION_COUNT), &targetCount, 2, std::max(maxCount, 2), "%d", ImGuiSliderFlags_AlwaysClamp);
+
+    // what devices with a command rate limit care about
+    auto& points = source ? *source : ctx().Selection();
+    if (points.size() > 1) {
+        float duration = points.back().atS - points.front().atS;
+        if (duration > 0.f) {
+            ImGui::Text(TR(ACTIONS_PER_SECOND_FMT), targetCount / duration);
+        }
+    }
+    return changed;
+}
+
+std::shared_ptr<SimplifyWork> SimplifyToCount::simplifier() const noexcept
+{
+    int32_t count = targetCount;
+    return std::make_shared<SequentialSimplifyWork>([count](const FunscriptArray& points, FunscriptArray& result) noexcept {
+        VisvalingamWhyattSimplify(points, std::numeric_limits<float>::infinity(), count, result);
+    });
+}
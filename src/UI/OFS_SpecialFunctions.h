@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <functional>
 #include "Funscript.h"
 
 #include "state/SpecialFunctionsState.h"
@@ -25,19 +26,110 @@ public:
 	virtual void DrawUI() noexcept override;
 };
 
-class RamerDouglasPeucker : public FunctionBase
+// A simplification run by SimplifyPreview as OFS_JobSystem jobs.
+// Prepare runs first and returns the number of parts, the parts run as parallel jobs
+// and Finish runs after the last of them. Without parts Finish follows Prepare right away.
+class SimplifyWork
+{
+public:
+	virtual ~SimplifyWork() noexcept {}
+	virtual uint32_t Prepare(const FunscriptArray& points) noexcept = 0;
+	virtual void Part(uint32_t part) noexcept {}
+	virtual void Finish(FunscriptArray& result) noexcept = 0;
+};
+
+// The simplifications behind the functions below, also used by the tests.
+// RamerDouglasPeuckerSimplify runs the parts of the parallel version one after another.
+void RamerDouglasPeuckerSimplify(const FunscriptArray& points, float epsilon, int32_t maxParts, FunscriptArray& newActions) noexcept;
+// Pass 0 as targetCount to only use minArea and infinity as minArea to only use targetCount.
+void VisvalingamWhyattSimplify(const FunscriptArray& points, float minArea, int32_t targetCount, FunscriptArray& newActions) noexcept;
+
+// Simplifies a copy of the selection with the job system.
+// While a request is running only the latest new request is kept,
+// the result of a finished request is returned by Poll.
+class SimplifyPreview
+{
+public:
+	struct Job;
+private:
+	std::shared_ptr<Job> running;
+	std::shared_ptr<const FunscriptArray> pendingPoints;
+	std::shared_ptr<SimplifyWork> pendingWork;
+	uint32_t generation = 0;
+
+	void start(std::shared_ptr<const FunscriptArray>&& points, std::shared_ptr<SimplifyWork>&& work) noexcept;
+public:
+	~SimplifyPreview() noexcept;
+	void Request(std::shared_ptr<const FunscriptArray> points, std::shared_ptr<SimplifyWork> work) noexcept;
+	bool Poll(FunscriptArray& result) noexcept;
+	// drops the results of everything requested so far and cancels the running jobs
+	void Cancel() noexcept;
+	inline bool Busy() const noexcept { return running != nullptr; }
+};
+
+// Preview and undo flow shared by the simplification functions.
+// Every preview simplifies the selection as it was when a parameter was first changed.
+class SimplifyFunctionBase : public FunctionBase
 {
-	float epsilon = 0.0f;
-	float averageDistance = 0.f;
 	bool createUndoState = true;
+	// set once a preview replaced the selection
+	bool applied = false;
+	SimplifyPreview preview;
 	UnsubscribeFn eventUnsub;
+
+	void applyResult(const FunscriptArray& newActions) noexcept;
+protected:
+	std::shared_ptr<const FunscriptArray> source;
+	std::weak_ptr<Funscript> sourceScript;
+
+	// returns true if a parameter changed
+	virtual bool drawParameters() noexcept = 0;
+	virtual void resetParameters() noexcept = 0;
+	// called after a new source was taken from the selection
+	virtual void sourceChanged() noexcept {}
+	virtual std::shared_ptr<SimplifyWork> simplifier() const noexcept = 0;
+	// size of the source, or the selection if there is none yet
+	size_t sourceSize() noexcept;
 public:
-	RamerDouglasPeucker() noexcept;
-	virtual ~RamerDouglasPeucker() noexcept;
+	SimplifyFunctionBase() noexcept;
+	virtual ~SimplifyFunctionBase() noexcept;
 	void SelectionChanged(const FunscriptSelectionChangedEvent* ev) noexcept;
 	virtual void DrawUI() noexcept override;
 };
 
+class RamerDouglasPeucker : public SimplifyFunctionBase
+{
+	float epsilon = 0.0f;
+	float averageDistance = 0.f;
+protected:
+	virtual bool drawParameters() noexcept override;
+	virtual void resetParameters() noexcept override { epsilon = 0.f; }
+	virtual void sourceChanged() noexcept override;
+	virtual std::shared_ptr<SimplifyWork> simplifier() const noexcept override;
+};
+
+// Removes the point with the smallest effective area until all remaining ones are above the threshold
+class VisvalingamWhyatt : public SimplifyFunctionBase
+{
+	float threshold = 0.f;
+	float averageArea = 0.f;
+protected:
+	virtual bool drawParameters() noexcept override;
+	virtual void resetParameters() noexcept override { threshold = 0.f; }
+	virtual void sourceChanged() noexcept override;
+	virtual std::shared_ptr<SimplifyWork> simplifier() const noexcept override;
+};
+
+// Removes the points with the smallest effective area until the requested count is reached
+class SimplifyToCount : public SimplifyFunctionBase
+{
+	int32_t targetCount = 0;
+protected:
+	virtual bool drawParameters() noexcept override;
+	virtual void resetParameters() noexcept override { targetCount = 0; }
+	virtual std::shared_ptr<SimplifyWork> simplifier() const noexcept override;
+};
+
 class SpecialFunctionsWindow {
 private:
 	FunctionBase* function = nullptr;
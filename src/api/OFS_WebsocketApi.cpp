@@ -2,10 +2,12 @@
 #include "OFS_WebsocketApiClient.h"
 #include "OFS_FileLogging.h"
 #include "OFS_EventSystem.h"
+#include "OFS_Profiling.h"
 
 #include "OpenFunscripter.h"
 #include "OFS_VideoplayerEvents.h"
 #include "OFS_WebsocketApiEvents.h"
+#include "OFS_WebsocketApiLoadTest.h"
 #include "state/WebsocketApiState.h"
 #include "state/states/ChapterState.h"
 
@@ -17,11 +19,17 @@
 #include "SDL_thread.h"
 #include "SDL_atomic.h"
 
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
 struct CivetwebContext
 {
     mg_context* web = nullptr;
 	char errtxtbuf[256] = {0};
 	SDL_atomic_t clientsConnected = {0};
+	// the server of the load test, its clients only get the load test events
+	bool loadTest = false;
 };
 
 #define CTX static_cast<CivetwebContext*>(ctx)
@@ -30,14 +38,20 @@ static const char WS_URL[] = "/ofs";
 
 /* Define websocket sub-protocols. */
 /* This must be static data, available between mg_start and mg_stop. */
-static const char* subprotocols[] = {"ofs-api.json", NULL};
-static struct mg_websocket_subprotocols wsprot = {1, subprotocols};
+static const char* subprotocols[] = {"ofs-api.json", "ofs-api.cbor", NULL};
+static struct mg_websocket_subprotocols wsprot = {2, subprotocols};
 
 /* Handler for new websocket connections. */
 static int ws_connect_handler(const struct mg_connection *conn, void *ctx) noexcept
 {
+	const struct mg_request_info *ri = mg_get_request_info(conn);
+	auto protocol = WsProtocol::Json;
+	if (ri->acceptedWebSocketSubprotocol && strcmp(ri->acceptedWebSocketSubprotocol, "ofs-api.cbor") == 0) {
+		protocol = WsProtocol::Cbor;
+	}
+
 	/* Allocate data for websocket client context, and initialize context. */
-    auto clientCtx = new OFS_WebsocketClient();
+    auto clientCtx = new OFS_WebsocketClient(protocol, CTX->loadTest);
 	if (!clientCtx) {
 		/* reject client */
 		return 1;
@@ -46,7 +60,6 @@ static int ws_connect_handler(const struct mg_connection *conn, void *ctx) noexc
 	mg_set_user_connection_data(conn, clientCtx);
 
 	/* DEBUG: New client connected (but not ready to receive data yet). */
-	const struct mg_request_info *ri = mg_get_request_info(conn);
 	LOGF_INFO("Client connected with subprotocol: %s\n",
 	       ri->acceptedWebSocketSubprotocol);
 
@@ -91,6 +104,7 @@ static int ws_data_handler(struct mg_connection *conn,
 		break;
 	case MG_WEBSOCKET_OPCODE_BINARY:
 		messageType = "binary";
+		clientCtx->ReceiveBinary(data, datasize);
 		break;
 	case MG_WEBSOCKET_OPCODE_CONNECTION_CLOSE:
 		messageType = "conn_close";
@@ -105,7 +119,8 @@ static int ws_data_handler(struct mg_connection *conn,
 	LOGF_DEBUG("Websocket received %lu bytes of %s data from client\n",
 	       (unsigned long)datasize,
 	       messageType);
-	return 1;
+	/* Returning 0 closes the connection. */
+	return clientCtx->ShouldDisconnect() ? 0 : 1;
 }
 
 
@@ -123,27 +138,132 @@ static void ws_close_handler(const struct mg_connection *conn, void *ctx) noexce
     delete clientCtx;
 }
 
+static void dispatchSerializedEvent(EventSerializationContext* ctx, ToJsonInterface& event, OFS_EventType type, const std::string& scriptName, uint32_t clientId) noexcept
+{
+	// Only encode what the connected clients negotiated
+	std::string jsonText;
+	std::vector<uint8_t> cbor;
+	if(OFS_WebsocketClient::ClientCount(WsProtocol::Json) > 0)
+	{
+		nlohmann::json json;
+		event.Serialize(json);
+		jsonText = Util::SerializeJson(json);
+	}
+	if(OFS_WebsocketClient::ClientCount(WsProtocol::Cbor) > 0)
+	{
+		nlohmann::json json;
+		event.SerializePacked(json);
+		cbor = Util::SerializeCBOR(json);
+	}
+	EV::Queue().directDispatch(WsSerializedEvent::EventType, 
+		std::move(EV::Make<WsSerializedEvent>(std::move(jsonText), std::move(cbor), type, scriptName, clientId, ctx->loadTest)));
+}
+
+static void sendFunscriptSnapshot(EventSerializationContext* ctx, const WsFunscriptUpdate* update, uint32_t version, uint32_t clientId) noexcept
+{
+	Funscript::FunscriptData data;
+	data.Actions = update->actions;
+	WsFunscriptChange change(update->name, std::move(data), update->metadata, version);
+	dispatchSerializedEvent(ctx, change, WsFunscriptChange::EventType, update->name, clientId);
+}
+
+static void serializeFunscriptUpdate(EventSerializationContext* ctx, const WsFunscriptUpdate* update) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	// Nobody gets to see this version, whoever subscribes later asks for a snapshot
+	if(!OFS_WebsocketClient::AnyClientWants(WsFunscriptDelta::EventType, update->name)
+		&& !OFS_WebsocketClient::AnyClientWants(WsFunscriptChange::EventType, update->name))
+	{
+		return;
+	}
+
+	auto actions = WsNormalizeActions(update->actions);
+	auto it = ctx->scriptVersions.find(update->name);
+	if(it == ctx->scriptVersions.end())
+	{
+		// Clients don't know about this script yet
+		auto& state = ctx->scriptVersions[update->name];
+		state.version = 1;
+		state.actions = std::move(actions);
+		sendFunscriptSnapshot(ctx, update, state.version, 0);
+		return;
+	}
+
+	auto& state = it->second;
+	WsFunscriptDelta delta(update->name, state.version + 1);
+	delta.Diff(state.actions, actions);
+	if(update->metadataChanged)
+	{
+		nlohmann::json funscript;
+		Funscript::Serialize(funscript, Funscript::FunscriptData(), update->metadata, true);
+		delta.metadata = std::move(funscript["metadata"]);
+	}
+
+	if(!delta.Empty())
+	{
+		state.version = delta.version;
+		state.actions = std::move(actions);
+		dispatchSerializedEvent(ctx, delta, WsFunscriptDelta::EventType, update->name, 0);
+	}
+
+	if(update->snapshot)
+	{
+		sendFunscriptSnapshot(ctx, update, state.version, update->clientId);
+	}
+}
+
+static void serializeEvent(EventSerializationContext* ctx, const EventPointer& ev, OFS_EventType type) noexcept
+{
+	if(type == WsFunscriptUpdate::EventType)
+	{
+		auto update = std::static_pointer_cast<const WsFunscriptUpdate>(ev);
+		if(ctx->http) ctx->http->PublishScript(update);
+		serializeFunscriptUpdate(ctx, update.get());
+		return;
+	}
+	else if(type == WsFunscriptReset::EventType)
+	{
+		ctx->scriptVersions.clear();
+		if(ctx->http) ctx->http->ClearScripts();
+		return;
+	}
+
+	std::string scriptName;
+	if(type == WsFunscriptRemove::EventType)
+	{
+		scriptName = static_cast<const WsFunscriptRemove*>(ev.get())->name;
+		ctx->scriptVersions.erase(scriptName);
+		if(ctx->http) ctx->http->RemoveScript(scriptName);
+	}
+
+	if(!OFS_WebsocketClient::AnyClientWants(type, scriptName)) return;
+	auto toJson = dynamic_cast<ToJsonInterface*>(ev.get());
+	dispatchSerializedEvent(ctx, *toJson, type, scriptName, 0);
+}
+
 static int EventSerializationThread(void* user) noexcept
 {
 	auto ctx = static_cast<EventSerializationContext*>(user);
 	auto waitMut = SDL_CreateMutex();
+	std::vector<EventPointer> events;
 	SDL_LockMutex(waitMut);
 	while(!ctx->shouldExit)
 	{
 		if(SDL_CondWait(ctx->processCond, waitMut) == 0)
 		{
+			// Serialize outside of the lock so the main thread never waits on it
 			SDL_AtomicLock(&ctx->eventLock);
-			for(auto& ev : ctx->events)
+			std::swap(events, ctx->events);
+			SDL_AtomicUnlock(&ctx->eventLock);
+
+			for(auto& ev : events)
 			{
-				auto toJson = dynamic_cast<ToJsonInterface*>(ev.get());
-				nlohmann::json json;
-				toJson->Serialize(json);
-				auto jsonText = Util::SerializeJson(json);
-				EV::Queue().directDispatch(WsSerializedEvent::EventType, 
-					std::move(EV::Make<WsSerializedEvent>(std::move(jsonText))));
+				auto type = ev->Type();
+				auto start = SDL_GetPerformanceCounter();
+				serializeEvent(ctx, ev, type);
+				ctx->AddStats(type, SDL_GetPerformanceCounter() - start);
 			}
-			ctx->events.clear();
-			SDL_AtomicUnlock(&ctx->eventLock);
+			events.clear();
 		}
 	}
 	SDL_DestroyMutex(waitMut);
@@ -155,6 +275,10 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 {
 	stateHandle = OFS_AppState<WebsocketApiState>::Register(WebsocketApiState::StateName);
 	eventSerializationCtx = std::make_unique<EventSerializationContext>();
+	http = std::make_unique<WsHttpApi>();
+	eventSerializationCtx->http = http.get();
+	// starts the server clock
+	WsServerTimeUs();
 
 	auto serializationThread = SDL_CreateThread(
 		EventSerializationThread, "WebsocketEventSerialization", eventSerializationCtx.get());
@@ -200,38 +324,34 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 		}
 	));
 
-	EV::Queue().appendListener(TimeChangeEvent::EventType, TimeChangeEvent::HandleEvent(
-		[this](const TimeChangeEvent* ev) noexcept
-		{
-			if(ClientsConnected() > 0 && ev->playerType == VideoplayerType::Main)
-			{
-				eventSerializationCtx->Push<WsTimeChange>(ev->time);
-			}
-		}
-	));
-
 	EV::Queue().appendListener(ProjectLoadedEvent::EventType, ProjectLoadedEvent::HandleEvent(
 		[this](const ProjectLoadedEvent* ev) noexcept
 		{
+			// All scripts were replaced, versions start over
+			eventSerializationCtx->Push<WsFunscriptReset>();
+			http->MetadataChanged();
 			if(ClientsConnected() > 0) 
 			{
 				// WsProjectChange remains handled by each internal client 
 				// this makes this event really expensive depending on the number of connected clients
 				EV::Queue().directDispatch(WsProjectChange::EventType, EV::Make<WsProjectChange>());
 			}
+			if(CTX->web) RequestSnapshot(0, std::string());
 		}
 	));
 
 	EV::Queue().appendListener(FunscriptNameChangedEvent::EventType, FunscriptNameChangedEvent::HandleEvent(
 		[this](const FunscriptNameChangedEvent* ev) noexcept
 		{
-			if(ClientsConnected() > 0)
+			// the http api needs the scripts even without websocket clients
+			if(CTX->web)
 			{
 				// Funscript name changes are handled as the old name being removed and the new one added
 				auto app = OpenFunscripter::ptr;
 				auto& projectState = app->LoadedProject->State();
 				eventSerializationCtx->Push<WsFunscriptRemove>(ev->oldName);
-				eventSerializationCtx->Push<WsFunscriptChange>(ev->Script->Title(), ev->Script->Data(), projectState.metadata);
+				eventSerializationCtx->Push<WsFunscriptUpdate>(ev->Script->Title(), ev->Script->Actions(), projectState.metadata, false, true, 0,
+					http->ScriptETag(*ev->Script));
 			}
 		}
 	));
@@ -240,14 +360,16 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 		MetadataChanged::HandleEvent(
 			[this](const MetadataChanged* ev) noexcept
 			{
+				http->MetadataChanged();
 				auto app = OpenFunscripter::ptr;				
 				for(int i=0, size=app->LoadedFunscripts().size(); i < size; i += 1)
 				{
 					auto scriptIdx = i;
 					if(scriptIdx + 1 > this->scriptUpdateCooldown.size()) {
-						scriptUpdateCooldown.resize(scriptIdx + 1, 0);
+						scriptUpdateCooldown.resize(scriptIdx + 1);
 					}
-					scriptUpdateCooldown[scriptIdx] = SDL_GetTicks();
+					scriptUpdateCooldown[scriptIdx].tick = SDL_GetTicks();
+					scriptUpdateCooldown[scriptIdx].metadataChanged = true;
 				}
 			}
 		));
@@ -256,14 +378,16 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 		ChapterStateChanged::HandleEvent(
 			[this](const ChapterStateChanged* ev) noexcept
 			{
+				http->MetadataChanged();
 				auto app = OpenFunscripter::ptr;				
 				for(int i=0, size=app->LoadedFunscripts().size(); i < size; i += 1)
 				{
 					auto scriptIdx = i;
 					if(scriptIdx + 1 > this->scriptUpdateCooldown.size()) {
-						scriptUpdateCooldown.resize(scriptIdx + 1, 0);
+						scriptUpdateCooldown.resize(scriptIdx + 1);
 					}
-					scriptUpdateCooldown[scriptIdx] = SDL_GetTicks();
+					scriptUpdateCooldown[scriptIdx].tick = SDL_GetTicks();
+					scriptUpdateCooldown[scriptIdx].metadataChanged = true;
 				}
 			}
 		));
@@ -271,7 +395,7 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 	EV::Queue().appendListener(FunscriptRemovedEvent::EventType, FunscriptRemovedEvent::HandleEvent(
 		[this](const FunscriptRemovedEvent* ev) noexcept
 		{
-			if(ClientsConnected() > 0)
+			if(CTX->web)
 			{
 				eventSerializationCtx->Push<WsFunscriptRemove>(ev->name);
 			}
@@ -281,7 +405,7 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 	EV::Queue().appendListener(FunscriptActionsChangedEvent::EventType, FunscriptActionsChangedEvent::HandleEvent(
 		[this](const FunscriptActionsChangedEvent* ev) noexcept
 		{
-			if(ClientsConnected() > 0)
+			if(CTX->web)
 			{
 				auto app = OpenFunscripter::ptr;
 				auto it = std::find_if(app->LoadedFunscripts().begin(), app->LoadedFunscripts().end(), 
@@ -291,9 +415,9 @@ OFS_WebsocketApi::OFS_WebsocketApi() noexcept
 				{
 					auto scriptIdx = std::distance(app->LoadedFunscripts().begin(), it);
 					if(scriptIdx + 1 > this->scriptUpdateCooldown.size()) {
-						scriptUpdateCooldown.resize(scriptIdx + 1, 0);
+						scriptUpdateCooldown.resize(scriptIdx + 1);
 					}
-					scriptUpdateCooldown[scriptIdx] = SDL_GetTicks();
+					scriptUpdateCooldown[scriptIdx].tick = SDL_GetTicks();
 				}
 			}
 		}
@@ -318,38 +442,59 @@ bool OFS_WebsocketApi::Init() noexcept
     return true;
 }
 
-bool OFS_WebsocketApi::StartServer() noexcept
+static bool startWebsocketServer(CivetwebContext* server, const char* ports, int threads) noexcept
 {
-	if(CTX->web) return true;
-	auto& state = WebsocketApiState::State(stateHandle);
-
-	const char* options[] = {"listening_ports", state.port.c_str(), "num_threads", "4", NULL, NULL};
+	auto threadCount = std::to_string(threads);
+	// Writes to a stalled client give up after the request timeout instead of pinning its send thread.
+	// The connection threads wake up every websocket timeout to notice clients closed by the server,
+	// the pings keep idle clients connected.
+	const char* options[] = {
+		"listening_ports", ports,
+		"num_threads", threadCount.c_str(),
+		"request_timeout_ms", "10000",
+		"websocket_timeout_ms", "1000",
+		"enable_websocket_ping_pong", "yes",
+		NULL, NULL
+	};
 
     /* Start the server using the advanced API. */
 	struct mg_callbacks callbacks = {0};
 
 	struct mg_init_data mg_start_init_data = {0};
 	mg_start_init_data.callbacks = &callbacks;
-	mg_start_init_data.user_data = ctx;
+	mg_start_init_data.user_data = server;
 	mg_start_init_data.configuration_options = options;
 
 	struct mg_error_data mg_start_error_data = {0};
-	mg_start_error_data.text = CTX->errtxtbuf;
-	mg_start_error_data.text_buffer_size = sizeof(CTX->errtxtbuf);
+	mg_start_error_data.text = server->errtxtbuf;
+	mg_start_error_data.text_buffer_size = sizeof(server->errtxtbuf);
 
-	CTX->web = mg_start2(&mg_start_init_data, &mg_start_error_data);
-    if(!CTX->web)
+	server->web = mg_start2(&mg_start_init_data, &mg_start_error_data);
+    if(!server->web)
         return false;
 
     /* Register the websocket callback functions. */
-	mg_set_websocket_handler_with_subprotocols(CTX->web,
+	mg_set_websocket_handler_with_subprotocols(server->web,
 	                                           WS_URL,
 	                                           &wsprot,
 	                                           ws_connect_handler,
 	                                           ws_ready_handler,
 	                                           ws_data_handler,
 	                                           ws_close_handler,
-	                                           ctx);
+	                                           server);
+	return true;
+}
+
+bool OFS_WebsocketApi::StartServer() noexcept
+{
+	if(CTX->web) return true;
+	auto& state = WebsocketApiState::State(stateHandle);
+
+	if(!startWebsocketServer(CTX, state.port.c_str(), ServerThreads))
+		return false;
+	http->Register(CTX->web);
+	// scripts only get pushed to the serialization thread while the server runs
+	if(OpenFunscripter::ptr && OpenFunscripter::ptr->LoadedProject) RequestSnapshot(0, std::string());
 	return true;
 }
 
@@ -364,32 +509,113 @@ void OFS_WebsocketApi::StopServer() noexcept
 
 void OFS_WebsocketApi::Update() noexcept
 {
-	if(ClientsConnected() <= 0) return;
+	if(!CTX->web) return;
+	http->Update(ImGui::GetIO().DeltaTime);
 
+	// Scripts are also sent without websocket clients, the http api serves them
 	for(int i=0, size=scriptUpdateCooldown.size(); i < size; i += 1)
 	{
 		auto& cd = scriptUpdateCooldown[i];
-		if(cd == 0) continue;
-		if(SDL_GetTicks() - cd >= 200)
+		if(cd.tick == 0) continue;
+		if(SDL_GetTicks() - cd.tick >= 200)
 		{
 			auto app = OpenFunscripter::ptr;
 			if(i >= 0 && i < app->LoadedFunscripts().size())
 			{
+				// The serialization thread turns this into a funscript_delta
 				auto& projectState = app->LoadedProject->State();
 				auto& script = app->LoadedFunscripts()[i];
-				eventSerializationCtx->Push<WsFunscriptChange>(script->Title(), script->Data(), projectState.metadata);
-				LOGF_DEBUG("[WsFunscriptChange]: ScriptIdx: %d", i);
+				eventSerializationCtx->Push<WsFunscriptUpdate>(script->Title(), script->Actions(), projectState.metadata, cd.metadataChanged, false, 0,
+					http->ScriptETag(*script));
+				LOGF_DEBUG("[WsFunscriptUpdate]: ScriptIdx: %d", i);
 			}
-			cd = 0;
+			cd = ScriptUpdate();
 		}
 	}
 
+	if(ClientsConnected() > 0) updatePlaybackAnchor();
+
 	if(!eventSerializationCtx->EventsEmpty())
 	{
 		eventSerializationCtx->StartProcessing();
 	}
-	
-	OFS_WebsocketClient::CommandBuffer.ProcessCommands();
+}
+
+void OFS_WebsocketApi::updatePlaybackAnchor() noexcept
+{
+	auto app = OpenFunscripter::ptr;
+	auto anchor = app->player->PlaybackAnchor();
+	auto now = SDL_GetTicks();
+
+	bool changed = anchor.seeks != lastAnchor.seeks || anchor.paused != lastAnchor.paused || anchor.speed != lastAnchor.speed;
+	if(!changed)
+	{
+		// Jumps the player made on its own, smaller differences are drift which the periodic anchor corrects
+		double expected = lastAnchor.time;
+		if(!lastAnchor.paused)
+		{
+			double elapsed = (double)(int64_t)(anchor.counter - lastAnchor.counter) / (double)SDL_GetPerformanceFrequency();
+			expected += elapsed * lastAnchor.speed;
+		}
+		changed = std::abs(expected - anchor.time) > AnchorDriftThreshold;
+	}
+
+	if(changed || now - lastAnchorTick >= AnchorIntervalMs)
+	{
+		eventSerializationCtx->Push<WsPlaybackAnchor>(anchor.time, WsServerTimeUs(anchor.counter), anchor.speed, anchor.paused);
+		lastAnchor = anchor;
+		lastAnchorTick = now;
+	}
+
+	// Clients which only understand time_change follow playback through it,
+	// each client limits it to its maxTimeRate.
+	if(changed || !anchor.paused)
+	{
+		eventSerializationCtx->Push<WsTimeChange>(anchor.time);
+	}
+}
+
+void OFS_WebsocketApi::RequestSnapshot(uint32_t clientId, const std::string& name) noexcept
+{
+	auto app = OpenFunscripter::ptr;
+	auto& projectState = app->LoadedProject->State();
+	for(auto& script : app->LoadedFunscripts())
+	{
+		if(!name.empty() && script->Title() != name) continue;
+		eventSerializationCtx->Push<WsFunscriptUpdate>(script->Title(), script->Actions(), projectState.metadata, false, true, clientId,
+			http->ScriptETag(*script));
+	}
+}
+
+bool OFS_WebsocketApi::RunLoadTest(const WsLoadTestConfig& config, WsLoadTestResult& result) noexcept
+{
+	if(mg_init_library(0) != 0) return false;
+
+	// A server of its own on a random local port with a worker thread per test client,
+	// when called from OFS real clients stay on the main server and don't get any of the synthetic events.
+	EventSerializationContext serialization;
+	serialization.loadTest = true;
+	auto serializationThread = SDL_CreateThread(
+		EventSerializationThread, "WebsocketLoadTestSerialization", &serialization);
+	SDL_DetachThread(serializationThread);
+
+	bool success = false;
+	CivetwebContext server;
+	server.loadTest = true;
+	if(startWebsocketServer(&server, "127.0.0.1:0", config.clients + 1))
+	{
+		mg_server_port ports;
+		mg_get_server_ports(server.web, 1, &ports);
+		success = OFS_WebsocketLoadTest::Run(&serialization, ports.port, config, result);
+		mg_stop(server.web);
+	}
+	else
+	{
+		LOGF_ERROR("Websocket load test: failed to start the server. %s", server.errtxtbuf);
+	}
+	serialization.Shutdown();
+	mg_exit_library();
+	return success;
 }
 
 void OFS_WebsocketApi::Shutdown() noexcept
@@ -421,8 +647,44 @@ void OFS_WebsocketApi::ShowWindow(bool* open) noexcept
 		mg_get_server_ports(CTX->web, 1, &ports);
 		
 		ImGui::TextColored(ImVec4(0.f, 1.f, 0.f, 1.f), "ws://0.0.0.0:%d%s", ports.port, WS_URL);
+		ImGui::TextColored(ImVec4(0.f, 1.f, 0.f, 1.f), "http://0.0.0.0:%d/state", ports.port);
 		auto clientCount = ClientsConnected();
 		ImGui::Text("%s: %d", TR(CLIENT_COUNT), clientCount);
+
+		if(clientCount > 0 && ImGui::BeginTable("##wsClients", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn(TR(WS_CLIENT));
+			ImGui::TableSetupColumn(TR(WS_PROTOCOL));
+			ImGui::TableSetupColumn(TR(WS_QUEUED));
+			ImGui::TableSetupColumn(TR(WS_QUEUED_BYTES));
+			ImGui::TableSetupColumn(TR(WS_PEAK_BYTES));
+			ImGui::TableSetupColumn(TR(WS_SENT));
+			ImGui::TableSetupColumn(TR(WS_DROPPED));
+			ImGui::TableHeadersRow();
+
+			OFS_WebsocketClient::ForEachClient([](OFS_WebsocketClient& client) noexcept
+			{
+				if(client.IsLoadTest()) return;
+				auto& stats = client.QueueStats();
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", client.Id());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(client.Protocol() == WsProtocol::Cbor ? "cbor" : "json");
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", stats.queuedMessages.load(std::memory_order_relaxed));
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(Util::FormatBytes(stats.queuedBytes.load(std::memory_order_relaxed)));
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(Util::FormatBytes(stats.peakBytes.load(std::memory_order_relaxed)));
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", stats.sentMessages.load(std::memory_order_relaxed));
+				ImGui::TableNextColumn();
+				ImGui::Text("%u (+%u)", stats.droppedMessages.load(std::memory_order_relaxed), stats.coalescedMessages.load(std::memory_order_relaxed));
+				if(ImGui::IsItemHovered()) ImGui::SetTooltip("%s", TR(WS_DROPPED_TOOLTIP));
+			});
+			ImGui::EndTable();
+		}
 	}
 
 	auto textChanged = ImGui::InputText(TR(PORT), &state.port, ImGuiInputTextFlags_CallbackCharFilter | ImGuiInputTextFlags_CharsDecimal,
@@ -5,12 +5,60 @@
 #include <memory>
 #include <vector>
 #include <atomic>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
 
 #include "SDL_thread.h"
 #include "SDL_atomic.h"
 #include "SDL_timer.h"
 
 #include "OFS_Event.h"
+#include "OFS_WebsocketApiEvents.h"
+#include "OFS_WebsocketApiHttp.h"
+#include "OFS_Videoplayer.h"
+
+struct WsLoadTestConfig;
+struct WsLoadTestResult;
+
+// Internal, turned into a funscript_delta or funscript_change by the serialization thread
+class WsFunscriptUpdate : public OFS_Event<WsFunscriptUpdate>
+{
+    public:
+    std::string name;
+    FunscriptArray actions;
+    Funscript::Metadata metadata;
+    bool metadataChanged = false;
+    // send a full funscript_change to clientId, 0 sends it to everyone
+    bool snapshot = false;
+    uint32_t clientId = 0;
+    // see WsHttpApi::ScriptETag, the http api serves the script from this update
+    std::string etag;
+
+    WsFunscriptUpdate(const std::string& name, const FunscriptArray& actions, const Funscript::Metadata& metadata, 
+        bool metadataChanged, bool snapshot, uint32_t clientId, const std::string& etag = std::string()) noexcept
+        : name(name), actions(actions), metadata(metadata), metadataChanged(metadataChanged), snapshot(snapshot), clientId(clientId), etag(etag) {}
+};
+
+// Internal, forgets the versions of all scripts
+class WsFunscriptReset : public OFS_Event<WsFunscriptReset>
+{
+};
+
+// Time the serialization thread spent on one type of event
+struct WsSerializationStats
+{
+    OFS_EventType type = BaseEvent::InvalidType;
+    uint32_t count = 0;
+    uint64_t ticks = 0;
+};
+
+// The last version of a script which was sent to clients
+struct WsFunscriptVersion
+{
+    uint32_t version = 0;
+    WsActionArray actions;
+};
 
 struct EventSerializationContext
 {
@@ -22,6 +70,17 @@ struct EventSerializationContext
     SDL_SpinLock eventLock = {0};
     std::vector<EventPointer> events;
 
+    // only accessed by the serialization thread
+    std::unordered_map<std::string, WsFunscriptVersion> scriptVersions;
+
+    SDL_SpinLock statsLock = {0};
+    std::vector<WsSerializationStats> stats;
+
+    // set for the context of the load test server, its events only reach the load test clients
+    bool loadTest = false;
+    // gets every script update, null for the load test
+    WsHttpApi* http = nullptr;
+
     EventSerializationContext() noexcept
     {
         processCond = SDL_CreateCond();
@@ -43,6 +102,25 @@ struct EventSerializationContext
         return empty;
     }
 
+    inline void AddStats(OFS_EventType type, uint64_t ticks) noexcept
+    {
+        SDL_AtomicLock(&statsLock);
+        auto it = std::find_if(stats.begin(), stats.end(), [type](auto& s) noexcept { return s.type == type; });
+        if(it == stats.end()) it = stats.insert(stats.end(), WsSerializationStats{ type, 0, 0 });
+        it->count += 1;
+        it->ticks += ticks;
+        SDL_AtomicUnlock(&statsLock);
+    }
+
+    inline std::vector<WsSerializationStats> Stats(bool reset) noexcept
+    {
+        SDL_AtomicLock(&statsLock);
+        auto result = stats;
+        if(reset) stats.clear();
+        SDL_AtomicUnlock(&statsLock);
+        return result;
+    }
+
     inline int StartProcessing() noexcept
     {
         return SDL_CondSignal(processCond);
@@ -64,10 +142,30 @@ class OFS_WebsocketApi
     private:
     void* ctx = nullptr;
     uint32_t stateHandle = 0xFFFF'FFFF;
-    std::vector<uint32_t> scriptUpdateCooldown;
+    struct ScriptUpdate
+    {
+        uint32_t tick = 0;
+        bool metadataChanged = false;
+    };
+    std::vector<ScriptUpdate> scriptUpdateCooldown;
     std::unique_ptr<EventSerializationContext> eventSerializationCtx;
+    std::unique_ptr<WsHttpApi> http;
+
+    // playback_anchor is sent on seeks, pause and speed changes
+    // and at least every AnchorIntervalMs so clients can correct drift.
+    // time_change goes out on those changes and every frame during playback,
+    // limited per client by WsSubscription::maxTimeRate.
+    static constexpr uint32_t AnchorIntervalMs = 1000;
+    static constexpr double AnchorDriftThreshold = 0.5;
+    OFS_PlaybackAnchor lastAnchor;
+    uint32_t lastAnchorTick = 0;
+
+    void updatePlaybackAnchor() noexcept;
 
     public:
+    // civetweb serves every websocket connection on its own worker thread
+    static constexpr int ServerThreads = 4;
+
     OFS_WebsocketApi() noexcept;
     OFS_WebsocketApi(const OFS_WebsocketApi&) = delete;
     OFS_WebsocketApi(OFS_WebsocketApi&&) = delete;
@@ -81,5 +179,13 @@ class OFS_WebsocketApi
     void ShowWindow(bool* open) noexcept;
     void Shutdown() noexcept;
 
+    // Sends the current state of a script to a client. An empty name means all scripts.
+    // clientId 0 sends it to every client.
+    void RequestSnapshot(uint32_t clientId, const std::string& name) noexcept;
+
     int ClientsConnected() const noexcept;
+
+    // Runs OFS_WebsocketLoadTest against a server of its own on a random local port.
+    // Doesn't need an OFS_WebsocketApi instance, the OFS_WebsocketLoadTest executable calls it headless.
+    static bool RunLoadTest(const WsLoadTestConfig& config, WsLoadTestResult& result) noexcept;
 };
\ No newline at end of file
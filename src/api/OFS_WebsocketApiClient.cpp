@@ -10,11 +10,27 @@
 #include "civetweb.h"
 #include "OpenFunscripter.h"
 
+#include "SDL_timer.h"
+
+#include <algorithm>
+
 WsCommandBuffer OFS_WebsocketClient::CommandBuffer = WsCommandBuffer();
+std::atomic<uint32_t> OFS_WebsocketClient::clientIdCounter = 0;
+std::atomic<int32_t> OFS_WebsocketClient::protocolClients[(int)WsProtocol::Count] = {};
+SDL_SpinLock OFS_WebsocketClient::registryLock = {0};
+std::vector<OFS_WebsocketClient*> OFS_WebsocketClient::registry;
 
-OFS_WebsocketClient::OFS_WebsocketClient() noexcept
+OFS_WebsocketClient::OFS_WebsocketClient(WsProtocol protocol, bool loadTest) noexcept
+    : id(++clientIdCounter), protocol(protocol), loadTest(loadTest)
 {
     LOG_DEBUG("Created new websocket client.");
+    protocolClients[(int)protocol].fetch_add(1, std::memory_order_relaxed);
+    queueMut = SDL_CreateMutex();
+    queueCond = SDL_CreateCond();
+
+    SDL_AtomicLock(&registryLock);
+    registry.push_back(this);
+    SDL_AtomicUnlock(&registryLock);
     std::vector<UnsubscribeFn> eventUnsubs;
     eventUnsubs.emplace_back(
         EV::MakeUnsubscibeFn(WsSerializedEvent::EventType, 
@@ -43,33 +59,290 @@ OFS_WebsocketClient::OFS_WebsocketClient() noexcept
 OFS_WebsocketClient::~OFS_WebsocketClient() noexcept
 {
     LOG_DEBUG("Destroying websocket client.");
+    SDL_AtomicLock(&registryLock);
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    SDL_AtomicUnlock(&registryLock);
+
     eventUnsub();   
+    protocolClients[(int)protocol].fetch_sub(1, std::memory_order_relaxed);
+
+    SDL_LockMutex(queueMut);
+    stopSending = true;
+    SDL_CondSignal(queueCond);
+    SDL_UnlockMutex(queueMut);
+    if(sendThread) SDL_WaitThread(sendThread, nullptr);
+    SDL_DestroyCond(queueCond);
+    SDL_DestroyMutex(queueMut);
+}
+
+bool OFS_WebsocketClient::wants(OFS_EventType type, const std::string& scriptName) noexcept
+{
+    // hello and clock_pong aren't subscribable
+    if(type == BaseEvent::InvalidType) return true;
+    SDL_AtomicLock(&subscriptionLock);
+    bool result = subscription.WantsEvent(type) && (scriptName.empty() || subscription.WantsScript(scriptName));
+    SDL_AtomicUnlock(&subscriptionLock);
+    return result;
+}
+
+bool OFS_WebsocketClient::AnyClientWants(OFS_EventType type, const std::string& scriptName) noexcept
+{
+    bool result = false;
+    ForEachClient([&](OFS_WebsocketClient& client) noexcept
+    {
+        result = result || client.wants(type, scriptName);
+    });
+    return result;
+}
+
+bool OFS_WebsocketClient::SetSubscription(uint32_t clientId, WsSubscription&& newSubscription) noexcept
+{
+    bool found = false;
+    ForEachClient([&](OFS_WebsocketClient& client) noexcept
+    {
+        if(client.id != clientId) return;
+        SDL_AtomicLock(&client.subscriptionLock);
+        client.subscription = std::move(newSubscription);
+        SDL_AtomicUnlock(&client.subscriptionLock);
+        found = true;
+    });
+    return found;
+}
+
+WsDropPolicy OFS_WebsocketClient::dropPolicy(OFS_EventType type) noexcept
+{
+    // Only the current value matters for these
+    if(type == WsTimeChange::EventType
+        || type == WsPlaybackAnchor::EventType
+        || type == WsPlayChange::EventType
+        || type == WsPlaybackSpeedChange::EventType
+        || type == WsDurationChange::EventType)
+    {
+        return WsDropPolicy::KeepLatest;
+    }
+    return WsDropPolicy::Never;
+}
+
+void OFS_WebsocketClient::enqueue(WsOutgoingMessage&& msg) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto size = msg.Size();
+    if(size == 0 || disconnect.load(std::memory_order_relaxed)) return;
+
+    auto updateStats = [this]() noexcept
+    {
+        stats.queuedMessages.store(sendQueue.size(), std::memory_order_relaxed);
+        stats.queuedBytes.store(queueBytes, std::memory_order_relaxed);
+        if(queueBytes > stats.peakBytes.load(std::memory_order_relaxed))
+            stats.peakBytes.store(queueBytes, std::memory_order_relaxed);
+    };
+
+    SDL_LockMutex(queueMut);
+    if(dropPolicy(msg.type) == WsDropPolicy::KeepLatest)
+    {
+        auto it = std::find_if(sendQueue.rbegin(), sendQueue.rend(),
+            [type = msg.type](auto& queued) noexcept { return queued.type == type; });
+        if(it != sendQueue.rend())
+        {
+            queueBytes = queueBytes - it->Size() + size;
+            *it = std::move(msg);
+            stats.coalescedMessages.fetch_add(1, std::memory_order_relaxed);
+            updateStats();
+            SDL_UnlockMutex(queueMut);
+            return;
+        }
+    }
+
+    if(sendQueue.size() >= MaxQueuedMessages || queueBytes + size > MaxQueuedBytes)
+    {
+        // A dropped funscript_delta shows up as a version gap on the client which then resyncs
+        stats.droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        auto now = SDL_GetTicks();
+        if(overBudgetSince == 0)
+        {
+            overBudgetSince = now;
+        }
+        else if(now - overBudgetSince >= OverBudgetTimeoutMs)
+        {
+            LOGF_WARN("Websocket client %u stayed over its send budget. Disconnecting.", id);
+            disconnect = true;
+            SDL_CondSignal(queueCond);
+        }
+        SDL_UnlockMutex(queueMut);
+        return;
+    }
+
+    overBudgetSince = 0;
+    queueBytes += size;
+    sendQueue.emplace_back(std::move(msg));
+    updateStats();
+    SDL_CondSignal(queueCond);
+    SDL_UnlockMutex(queueMut);
 }
 
-void OFS_WebsocketClient::sendMessage(const std::string& msg) noexcept
+void OFS_WebsocketClient::write(const WsOutgoingMessage& msg) noexcept
 {
     OFS_PROFILE(__FUNCTION__);
-    if(conn == nullptr) return;
-    if(mg_websocket_write(conn, MG_WEBSOCKET_OPCODE_TEXT, msg.data(), msg.size()) < 0)
+    int result = msg.text 
+        ? mg_websocket_write(conn, MG_WEBSOCKET_OPCODE_TEXT, msg.text->data(), msg.text->size())
+        : mg_websocket_write(conn, MG_WEBSOCKET_OPCODE_BINARY, (const char*)msg.binary->data(), msg.binary->size());
+    if(result <= 0)
     {
+        // closed or timed out, the send thread closes the connection
         LOG_ERROR("Failed to send websocket message.");
+        disconnect = true;
+    }
+    else
+    {
+        stats.sentMessages.fetch_add(1, std::memory_order_relaxed);
     }
 }
 
+void OFS_WebsocketClient::queueHeldTimeChange() noexcept
+{
+    lastTimeChangeCounter = SDL_GetPerformanceCounter();
+    auto msg = std::move(heldTimeChange);
+    heldTimeChange = WsOutgoingMessage();
+    queueBytes += msg.Size();
+    // replaces a queued time_change like enqueue does
+    auto it = std::find_if(sendQueue.rbegin(), sendQueue.rend(),
+        [](auto& queued) noexcept { return queued.type == WsTimeChange::EventType; });
+    if(it != sendQueue.rend())
+    {
+        queueBytes -= it->Size();
+        *it = std::move(msg);
+        stats.coalescedMessages.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        sendQueue.emplace_back(std::move(msg));
+    }
+    stats.queuedMessages.store(sendQueue.size(), std::memory_order_relaxed);
+    stats.queuedBytes.store(queueBytes, std::memory_order_relaxed);
+}
+
+int OFS_WebsocketClient::sendThreadMain(void* user) noexcept
+{
+    auto client = static_cast<OFS_WebsocketClient*>(user);
+    SDL_LockMutex(client->queueMut);
+    while(!client->stopSending)
+    {
+        if(client->disconnect)
+        {
+            client->sendQueue.clear();
+            client->queueBytes = 0;
+            client->stats.queuedMessages = 0;
+            client->stats.queuedBytes = 0;
+            SDL_UnlockMutex(client->queueMut);
+            // A client this far behind may never answer the close frame or send anything else,
+            // this ends the connection thread without waiting for inbound data.
+            // The connection stays valid until ws_close_handler destroyed this client.
+            mg_close_connection(client->conn);
+            // 1008 policy violation
+            const char closeData[] = { 0x03, (char)0xF0 };
+            mg_websocket_write(client->conn, MG_WEBSOCKET_OPCODE_CONNECTION_CLOSE, closeData, sizeof(closeData));
+            SDL_LockMutex(client->queueMut);
+            break;
+        }
+
+        if(client->heldTimeChange.Size() > 0)
+        {
+            auto now = SDL_GetPerformanceCounter();
+            if(now >= client->timeChangeDueCounter)
+            {
+                client->queueHeldTimeChange();
+            }
+            else if(client->sendQueue.empty())
+            {
+                auto waitMs = (client->timeChangeDueCounter - now) * 1000 / SDL_GetPerformanceFrequency();
+                SDL_CondWaitTimeout(client->queueCond, client->queueMut, std::max<uint32_t>((uint32_t)waitMs, 1));
+                continue;
+            }
+        }
+        if(client->sendQueue.empty())
+        {
+            SDL_CondWait(client->queueCond, client->queueMut);
+            continue;
+        }
+
+        auto msg = std::move(client->sendQueue.front());
+        client->sendQueue.pop_front();
+        client->queueBytes -= msg.Size();
+        client->stats.queuedMessages.store(client->sendQueue.size(), std::memory_order_relaxed);
+        client->stats.queuedBytes.store(client->queueBytes, std::memory_order_relaxed);
+
+        // The socket may block, nobody else waits on the queue during that
+        SDL_UnlockMutex(client->queueMut);
+        client->write(msg);
+        SDL_LockMutex(client->queueMut);
+    }
+    SDL_UnlockMutex(client->queueMut);
+    return 0;
+}
+
+void OFS_WebsocketClient::sendMessage(const nlohmann::json& json, OFS_EventType type) noexcept
+{
+    if(!wants(type, std::string())) return;
+    WsOutgoingMessage msg;
+    msg.type = type;
+    if(protocol == WsProtocol::Cbor)
+        msg.binary = std::make_shared<const std::vector<uint8_t>>(Util::SerializeCBOR(json));
+    else
+        msg.text = std::make_shared<const std::string>(Util::SerializeJson(json));
+    enqueue(std::move(msg));
+}
+
 void OFS_WebsocketClient::handleSerializedEvent(const WsSerializedEvent* ev) noexcept
 {
     // NOTE: this is not called by the main thread
     OFS_PROFILE(__FUNCTION__);
-    sendMessage(ev->serializedEvent);
+    if(ev->loadTest != loadTest) return;
+    if(ev->clientId != 0 && ev->clientId != id) return;
+    if(!wants(ev->sourceType, ev->scriptName)) return;
+
+    WsOutgoingMessage msg;
+    msg.type = ev->sourceType;
+    if(protocol == WsProtocol::Cbor)
+        msg.binary = ev->serializedCbor;
+    else
+        msg.text = ev->serializedEvent;
+
+    if(ev->sourceType == WsTimeChange::EventType)
+    {
+        SDL_AtomicLock(&subscriptionLock);
+        float maxTimeRate = subscription.maxTimeRate;
+        SDL_AtomicUnlock(&subscriptionLock);
+        auto now = SDL_GetPerformanceCounter();
+        SDL_LockMutex(queueMut);
+        if(maxTimeRate > 0.f && lastTimeChangeCounter != 0)
+        {
+            auto interval = (uint64_t)((double)SDL_GetPerformanceFrequency() / maxTimeRate);
+            if(now - lastTimeChangeCounter < interval)
+            {
+                // only the latest one is kept, it still goes out once the interval passed
+                // so the client doesn't stay on a stale position
+                heldTimeChange = std::move(msg);
+                timeChangeDueCounter = lastTimeChangeCounter + interval;
+                SDL_CondSignal(queueCond);
+                SDL_UnlockMutex(queueMut);
+                return;
+            }
+        }
+        heldTimeChange = WsOutgoingMessage();
+        lastTimeChangeCounter = now;
+        SDL_UnlockMutex(queueMut);
+    }
+    enqueue(std::move(msg));
 }
 
 void OFS_WebsocketClient::handleProjectChange(const WsProjectChange* ev) noexcept
 {
     // NOTE: this is called by the main thread
-    UpdateAll();
+    // the scripts get sent by OFS_WebsocketApi once for all clients
+    if(!loadTest) UpdateAll(false);
 }
 
-void OFS_WebsocketClient::UpdateAll() noexcept
+void OFS_WebsocketClient::UpdateAll(bool includeScripts) noexcept
 {
     // Update everything
     auto app = OpenFunscripter::ptr;
@@ -77,8 +350,7 @@ void OFS_WebsocketClient::UpdateAll() noexcept
     auto serializeSend = [this](auto&& event) noexcept
     {
         nlohmann::json json = event;
-        auto jsonText = Util::SerializeJson(json);
-        sendMessage(jsonText);
+        sendMessage(json, std::decay_t<decltype(event)>::EventType);
     };
 
     serializeSend(std::move(WsProjectChange()));
@@ -87,11 +359,17 @@ void OFS_WebsocketClient::UpdateAll() noexcept
     serializeSend(std::move(WsPlayChange(!app->player->IsPaused())));
     serializeSend(std::move(WsDurationChange(app->player->Duration())));
     serializeSend(std::move(WsTimeChange(app->player->CurrentPlayerTime())));
+    auto anchor = app->player->PlaybackAnchor();
+    serializeSend(std::move(WsPlaybackAnchor(anchor.time, WsServerTimeUs(anchor.counter), anchor.speed, anchor.paused)));
 
-    auto& projectState = app->LoadedProject->State();
-    for(auto& script : app->LoadedFunscripts())
+    if(includeScripts)
     {
-        serializeSend(std::move(WsFunscriptChange(script->Title(), script->Data(), projectState.metadata)));
+        // Snapshots have to go through the serialization thread
+        // since that is where script versions are tracked.
+        EV::Defer([clientId = id]() noexcept 
+        {
+            OpenFunscripter::ptr->webApi->RequestSnapshot(clientId, std::string());
+        });
     }
 }
 
@@ -99,24 +377,70 @@ void OFS_WebsocketClient::InitializeConnection(mg_connection* conn) noexcept
 {
     if(this->conn) return;
     this->conn = conn;
+    sendThread = SDL_CreateThread(sendThreadMain, "WebsocketClientSend", this);
     /* Send "hello" message. */
-	const char* hello = "{\"connected\":\"OFS " OFS_LATEST_GIT_TAG "@" OFS_LATEST_GIT_HASH "\"}";
-	mg_websocket_write(conn, MG_WEBSOCKET_OPCODE_TEXT, hello, strlen(hello));
-    UpdateAll();
+    nlohmann::json hello = { { "connected", "OFS " OFS_LATEST_GIT_TAG "@" OFS_LATEST_GIT_HASH } };
+    sendMessage(hello, 0);
+    if(!loadTest) UpdateAll(true);
 }
 
-void OFS_WebsocketClient::ReceiveText(char* data, size_t dataLen) noexcept
+void OFS_WebsocketClient::handleClockPing(const nlohmann::json& data, int64_t receivedUs) noexcept
 {
-    // NOTE: Assume this function isn't called on the main thread.
-    bool succ;
-    std::string_view dataView(data, dataLen);
-    auto json = nlohmann::json::parse(dataView, nullptr, false, true);
-    if(!json.is_discarded())
+    // Answered right away on the connection thread, going through
+    // the send queue or the main thread would skew the measurement.
+    auto t0 = data.is_object() && data.contains("t0") ? data["t0"] : nlohmann::json();
+    WsClockPong pong(std::move(t0), receivedUs, 0);
+    WsOutgoingMessage msg;
+    msg.type = WsClockPong::EventType;
+    nlohmann::json json;
+    pong.t2 = WsServerTimeUs();
+    pong.Serialize(json);
+    if(protocol == WsProtocol::Cbor)
+        msg.binary = std::make_shared<const std::vector<uint8_t>>(Util::SerializeCBOR(json));
+    else
+        msg.text = std::make_shared<const std::string>(Util::SerializeJson(json));
+    write(msg);
+}
+
+void OFS_WebsocketClient::receiveCommand(const nlohmann::json& json, int64_t receivedUs) noexcept
+{
+    if(!json.is_discarded() && json.is_object())
     {
+        auto name = json.find("name");
+        if(name != json.end() && *name == "clock_ping")
+        {
+            auto data = json.find("data");
+            handleClockPing(data != json.end() ? *data : nlohmann::json(), receivedUs);
+            return;
+        }
+
         // Valid json
-        if(CommandBuffer.AddCmd(json))
+        std::string error;
+        if(!CommandBuffer.AddCmd(json, id, error) && !error.empty())
         {
-            // Success
+            auto command = name != json.end() ? *name : nlohmann::json();
+            nlohmann::json answer = { { "type", "event" }, { "name", "command_error" },
+                { "data", { { "command", std::move(command) }, { "error", std::move(error) } } } };
+            sendMessage(answer, 0);
         }
     }
+}
+
+void OFS_WebsocketClient::ReceiveText(char* data, size_t dataLen) noexcept
+{
+    // NOTE: Assume this function isn't called on the main thread.
+    auto receivedUs = WsServerTimeUs();
+    std::string_view dataView(data, dataLen);
+    auto json = nlohmann::json::parse(dataView, nullptr, false, true);
+    receiveCommand(json, receivedUs);
+}
+
+void OFS_WebsocketClient::ReceiveBinary(char* data, size_t dataLen) noexcept
+{
+    // NOTE: Assume this function isn't called on the main thread.
+    auto receivedUs = WsServerTimeUs();
+    auto bytes = (const uint8_t*)data;
+    // typed arrays are tagged byte strings, store keeps the tag as the binary subtype
+    auto json = nlohmann::json::from_cbor(bytes, bytes + dataLen, true, false, nlohmann::json::cbor_tag_handler_t::store);
+    receiveCommand(json, receivedUs);
 }
\ No newline at end of file
@@ -4,35 +4,162 @@
 #include "OFS_WebsocketApiCommands.h"
 
 #include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
+#include "SDL_atomic.h"
+
+// Negotiated per client through the websocket subprotocol
+enum class WsProtocol : uint8_t
+{
+    Json, // ofs-api.json
+    Cbor, // ofs-api.cbor
+    Count
+};
 
 // This event is pushed to the internal websocket clients and not part of the API
 class WsSerializedEvent : public OFS_Event<WsSerializedEvent>
 {
     public:
-    std::string serializedEvent;
-    WsSerializedEvent(std::string&& json) noexcept
-        : serializedEvent(std::move(json)) {}
+    // each one is only set when a client with that protocol is connected
+    // they are shared by the send queues of all clients
+    std::shared_ptr<const std::string> serializedEvent;
+    std::shared_ptr<const std::vector<uint8_t>> serializedCbor;
+    // type of the event which was serialized, used for subscriptions and the drop policy
+    OFS_EventType sourceType = 0;
+    // set for events about a single script
+    std::string scriptName;
+    // 0 means every client
+    uint32_t clientId = 0;
+    // serialized for the load test, only its own clients get it
+    bool loadTest = false;
+    WsSerializedEvent(std::string&& json, std::vector<uint8_t>&& cbor, OFS_EventType sourceType, const std::string& scriptName, uint32_t clientId, bool loadTest) noexcept
+        : sourceType(sourceType), scriptName(scriptName), clientId(clientId), loadTest(loadTest)
+    {
+        if(!json.empty()) serializedEvent = std::make_shared<const std::string>(std::move(json));
+        if(!cbor.empty()) serializedCbor = std::make_shared<const std::vector<uint8_t>>(std::move(cbor));
+    }
+};
+
+enum class WsDropPolicy : uint8_t
+{
+    Never,
+    // only the most recent message of this type is kept in the queue
+    KeepLatest,
+};
+
+struct WsOutgoingMessage
+{
+    std::shared_ptr<const std::string> text;
+    std::shared_ptr<const std::vector<uint8_t>> binary;
+    OFS_EventType type = 0;
+
+    inline size_t Size() const noexcept { return text ? text->size() : binary ? binary->size() : 0; }
+};
+
+// Read by the UI without locking
+struct WsClientQueueStats
+{
+    std::atomic<uint32_t> queuedMessages = 0;
+    std::atomic<size_t> queuedBytes = 0;
+    std::atomic<size_t> peakBytes = 0;
+    std::atomic<uint32_t> sentMessages = 0;
+    std::atomic<uint32_t> droppedMessages = 0;
+    std::atomic<uint32_t> coalescedMessages = 0;
 };
 
 class OFS_WebsocketClient
 {
+    public:
+    static constexpr size_t MaxQueuedMessages = 1024;
+    static constexpr size_t MaxQueuedBytes = 32 * 1024 * 1024;
+    // a client which stays over budget this long gets disconnected
+    static constexpr uint32_t OverBudgetTimeoutMs = 5000;
+
     private:
+    static std::atomic<uint32_t> clientIdCounter;
+    static std::atomic<int32_t> protocolClients[(int)WsProtocol::Count];
+    static SDL_SpinLock registryLock;
+    static std::vector<OFS_WebsocketClient*> registry;
     UnsubscribeFn eventUnsub;
 	struct mg_connection* conn = nullptr;
+    uint32_t id = 0;
+    WsProtocol protocol = WsProtocol::Json;
+    // connected to the load test server, never sees the real events
+    bool loadTest = false;
+
+    // Messages are written to the socket by a thread per client
+    // so that neither the main thread nor the serialization thread
+    // ever wait on a slow client.
+    SDL_Thread* sendThread = nullptr;
+    SDL_mutex* queueMut = nullptr;
+    SDL_cond* queueCond = nullptr;
+    std::deque<WsOutgoingMessage> sendQueue;
+    size_t queueBytes = 0;
+    uint32_t overBudgetSince = 0;
+    bool stopSending = false;
+    std::atomic<bool> disconnect = false;
+    WsClientQueueStats stats;
+
+    // written on the main thread, read by the serialization thread
+    SDL_SpinLock subscriptionLock = {0};
+    WsSubscription subscription;
+    // guarded by queueMut, a time_change over the maxTimeRate is held back
+    // and queued by the send thread once timeChangeDueCounter passed
+    uint64_t lastTimeChangeCounter = 0;
+    uint64_t timeChangeDueCounter = 0;
+    WsOutgoingMessage heldTimeChange;
+
+    bool wants(OFS_EventType type, const std::string& scriptName) noexcept;
+
+    static int sendThreadMain(void* user) noexcept;
+    static WsDropPolicy dropPolicy(OFS_EventType type) noexcept;
+    void enqueue(WsOutgoingMessage&& msg) noexcept;
+    // queueMut has to be locked
+    void queueHeldTimeChange() noexcept;
+    void write(const WsOutgoingMessage& msg) noexcept;
 
     void handleSerializedEvent(const WsSerializedEvent* ev) noexcept;
     void handleProjectChange(const WsProjectChange* ev) noexcept;
-    void sendMessage(const std::string& msg) noexcept;
+    void sendMessage(const nlohmann::json& json, OFS_EventType type) noexcept;
+    void receiveCommand(const nlohmann::json& json, int64_t receivedUs) noexcept;
+    void handleClockPing(const nlohmann::json& data, int64_t receivedUs) noexcept;
     
     public:
     static WsCommandBuffer CommandBuffer;
 
-    OFS_WebsocketClient() noexcept;
+    inline static int32_t ClientCount(WsProtocol protocol) noexcept { return protocolClients[(int)protocol].load(std::memory_order_relaxed); }
+    // Lets the serialization thread skip events nobody subscribed to
+    static bool AnyClientWants(OFS_EventType type, const std::string& scriptName) noexcept;
+    static bool SetSubscription(uint32_t clientId, WsSubscription&& subscription) noexcept;
+
+    // The registry lock is held while fn runs, clients can't go away in between
+    template<typename Fn>
+    inline static void ForEachClient(Fn&& fn) noexcept
+    {
+        SDL_AtomicLock(&registryLock);
+        for(auto client : registry) fn(*client);
+        SDL_AtomicUnlock(&registryLock);
+    }
+
+    OFS_WebsocketClient(WsProtocol protocol, bool loadTest) noexcept;
     OFS_WebsocketClient(const OFS_WebsocketClient&) = delete;
     OFS_WebsocketClient(OFS_WebsocketClient&&) = delete;
     ~OFS_WebsocketClient() noexcept;
 
+    inline uint32_t Id() const noexcept { return id; }
+    inline WsProtocol Protocol() const noexcept { return protocol; }
+    inline bool IsLoadTest() const noexcept { return loadTest; }
+    inline const WsClientQueueStats& QueueStats() const noexcept { return stats; }
+    // set once the client went over its send budget, the connection gets closed
+    inline bool ShouldDisconnect() const noexcept { return disconnect.load(std::memory_order_relaxed); }
+
     void InitializeConnection(struct mg_connection* conn) noexcept;
-    void UpdateAll() noexcept;
+    void UpdateAll(bool includeScripts) noexcept;
     void ReceiveText(char* data, size_t dateLen) noexcept;
-};
\ No newline at end of file
+    void ReceiveBinary(char* data, size_t dataLen) noexcept;
+};
@@ -1,4 +1,7 @@
 #include "OFS_WebsocketApiCommands.h"
+#include "OFS_WebsocketApiEvents.h"
+#include "OFS_WebsocketApiClient.h"
+#include "OFS_EventSystem.h"
 #include <optional>
 
 WsCommandBuffer::WsCommandBuffer() noexcept
@@ -6,7 +9,7 @@ WsCommandBuffer::WsCommandBuffer() noexcept
 
 }
 
-inline static std::unique_ptr<WsCmd> CreateCommand(const std::string& name, const nlohmann::json& data) noexcept
+inline static std::unique_ptr<WsCmd> CreateCommand(const std::string& name, const nlohmann::json& data, uint32_t clientId, std::string& error) noexcept
 {
     if(name == "change_time" && data["time"].is_number())
     {
@@ -23,10 +26,75 @@ inline static std::unique_ptr<WsCmd> CreateCommand(const std::string& name, cons
         float speed = data["speed"].get<float>();
         return std::make_unique<WsPlaybackSpeedChangeCmd>(speed);
     }
+    else if(name == "funscript_resync" && data.is_object())
+    {
+        auto it = data.find("name");
+        std::string scriptName = it != data.end() && it->is_string() ? it->get<std::string>() : std::string();
+        return std::make_unique<WsFunscriptResyncCmd>(clientId, scriptName);
+    }
+    else if((name == "funscript_insert" || name == "funscript_replace_range" || name == "funscript_remove_range")
+        && data.is_object() && data.contains("name") && data["name"].is_string())
+    {
+        auto mode = WsFunscriptEditCmd::Mode::Insert;
+        if(name == "funscript_replace_range") mode = WsFunscriptEditCmd::Mode::ReplaceRange;
+        else if(name == "funscript_remove_range") mode = WsFunscriptEditCmd::Mode::RemoveRange;
+
+        float fromTime = 0.f;
+        float toTime = 0.f;
+        if(mode != WsFunscriptEditCmd::Mode::Insert)
+        {
+            // Ranges are inclusive and in milliseconds like the actions
+            if(!data.contains("from") || !data.contains("to") 
+                || !data["from"].is_number() || !data["to"].is_number()) return {};
+            fromTime = data["from"].get<float>() / 1000.f;
+            toTime = data["to"].get<float>() / 1000.f;
+            if(fromTime > toTime) return {};
+        }
+
+        FunscriptArray actions;
+        if(mode != WsFunscriptEditCmd::Mode::RemoveRange 
+            && (!data.contains("actions") || !WsUnpackActions(data["actions"], actions)))
+        {
+            LOG_WARN("Invalid actions in websocket funscript edit.");
+            error = "Invalid actions. Timestamps and positions have to be 32 bit integers, typed arrays need their tag.";
+            return {};
+        }
+        return std::make_unique<WsFunscriptEditCmd>(mode, data["name"].get<std::string>(), fromTime, toTime, std::move(actions));
+    }
+    else if(name == "subscribe" && data.is_object())
+    {
+        // Fields which are left out mean everything, maxTimeRate falls back to its default
+        WsSubscription subscription;
+        auto events = data.find("events");
+        if(events != data.end() && events->is_array())
+        {
+            for(auto& eventName : *events)
+            {
+                if(!eventName.is_string()) continue;
+                auto type = WsEventTypeFromName(eventName.get_ref<const std::string&>());
+                if(type != BaseEvent::InvalidType) subscription.events.push_back(type);
+                else LOGF_WARN("Unknown websocket event \"%s\" in subscription.", eventName.get_ref<const std::string&>().c_str());
+            }
+        }
+        auto scripts = data.find("scripts");
+        if(scripts != data.end() && scripts->is_array())
+        {
+            for(auto& scriptName : *scripts)
+            {
+                if(scriptName.is_string()) subscription.scripts.push_back(scriptName.get<std::string>());
+            }
+        }
+        auto maxTimeRate = data.find("maxTimeRate");
+        if(maxTimeRate != data.end() && maxTimeRate->is_number())
+        {
+            subscription.maxTimeRate = std::max(0.f, maxTimeRate->get<float>());
+        }
+        return std::make_unique<WsSubscribeCmd>(clientId, std::move(subscription));
+    }
     return {};
 }
 
-bool WsCommandBuffer::AddCmd(const nlohmann::json& jsonCmd) noexcept
+bool WsCommandBuffer::AddCmd(const nlohmann::json& jsonCmd, uint32_t clientId, std::string& error) noexcept
 {
     auto& type = jsonCmd["type"];
     if(!type.is_string() || type != "command") return false;
@@ -35,31 +103,23 @@ bool WsCommandBuffer::AddCmd(const nlohmann::json& jsonCmd) noexcept
     if(!name.is_string()) return false;
 
     auto& data = jsonCmd["data"];
-    if(data.is_null()) return false;
+    if(data.is_null())
+    {
+        error = "Missing data.";
+        return false;
+    }
 
-    auto cmd = CreateCommand(name.get_ref<const std::string&>(), data);
+    auto cmd = CreateCommand(name.get_ref<const std::string&>(), data, clientId, error);
     if(cmd)
     {
-        SDL_AtomicLock(&commandLock);
-        commands.emplace_back(std::move(cmd));
-        SDL_AtomicUnlock(&commandLock);
+        // Commands arrive on civetweb worker threads and run on the main thread.
+        EV::Defer([cmd = std::shared_ptr<WsCmd>(std::move(cmd))]() noexcept { cmd->Run(); });
         return true;
     }
+    if(error.empty()) error = "Unknown command or invalid data.";
     return false;
 }
 
-void WsCommandBuffer::ProcessCommands() noexcept
-{
-    if(commands.empty()) return;
-    SDL_AtomicLock(&commandLock);
-    for(auto& cmd : commands)
-    {
-        cmd->Run();
-    }
-    commands.clear();
-    SDL_AtomicUnlock(&commandLock);
-}
-
 
 #include "OpenFunscripter.h"
 
@@ -79,4 +139,53 @@ void WsTimeChangeCmd::Run() noexcept
 {
     auto app = OpenFunscripter::ptr;
     app->player->SetPositionExact(time);
-}
\ No newline at end of file
+}
+
+void WsFunscriptResyncCmd::Run() noexcept
+{
+    auto app = OpenFunscripter::ptr;
+    app->webApi->RequestSnapshot(clientId, name);
+}
+
+void WsFunscriptEditCmd::Run() noexcept
+{
+    auto app = OpenFunscripter::ptr;
+    auto& scripts = app->LoadedFunscripts();
+    auto it = std::find_if(scripts.begin(), scripts.end(),
+        [this](auto& script) noexcept { return script->Title() == name; });
+    if(it == scripts.end())
+    {
+        LOGF_WARN("Websocket edit for unknown script \"%s\".", name.c_str());
+        return;
+    }
+
+    auto& script = *it;
+    app->undoSystem->Snapshot(StateType::WEBSOCKET_API, script);
+    switch(mode)
+    {
+        case Mode::Insert:
+            script->MergeActions(actions);
+            break;
+        case Mode::ReplaceRange:
+            script->ReplaceActionsInInterval(fromTime, toTime, actions);
+            break;
+        case Mode::RemoveRange:
+            script->RemoveActionsInInterval(fromTime, toTime);
+            break;
+    }
+}
+
+void WsSubscribeCmd::Run() noexcept
+{
+    bool wantsScripts = subscription.WantsEvent(WsFunscriptChange::EventType) 
+        || subscription.WantsEvent(WsFunscriptDelta::EventType);
+    if(!OFS_WebsocketClient::SetSubscription(clientId, std::move(subscription))) return;
+
+    // Versions of scripts nobody was subscribed to weren't tracked,
+    // a fresh snapshot brings the client up to date.
+    if(wantsScripts)
+    {
+        auto app = OpenFunscripter::ptr;
+        app->webApi->RequestSnapshot(clientId, std::string());
+    }
+}
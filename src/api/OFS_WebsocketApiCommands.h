@@ -3,9 +3,12 @@
 #include <vector>
 #include <variant>
 #include <memory>
+#include <string>
+#include <algorithm>
 
-#include "SDL_atomic.h"
 #include "OFS_Util.h"
+#include "OFS_Event.h"
+#include "FunscriptAction.h"
 
 class WsCmd 
 {
@@ -43,14 +46,77 @@ class WsTimeChangeCmd : public WsCmd
     void Run() noexcept override;
 };
 
-class WsCommandBuffer
+// Requests a full funscript_change, sent after a client missed a funscript_delta
+class WsFunscriptResyncCmd : public WsCmd
+{
+    public:
+    uint32_t clientId = 0;
+    // empty means all scripts
+    std::string name;
+    WsFunscriptResyncCmd(uint32_t clientId, const std::string& name) noexcept
+        : clientId(clientId), name(name) {}
+
+    void Run() noexcept override;
+};
+
+// Edits a whole batch of actions at once, every command is a single undo step
+class WsFunscriptEditCmd : public WsCmd
+{
+    public:
+    enum class Mode
+    {
+        Insert,
+        ReplaceRange,
+        RemoveRange
+    };
+    Mode mode = Mode::Insert;
+    std::string name;
+    float fromTime = 0.f;
+    float toTime = 0.f;
+    FunscriptArray actions;
+    WsFunscriptEditCmd(Mode mode, const std::string& name, float fromTime, float toTime, FunscriptArray&& actions) noexcept
+        : mode(mode), name(name), fromTime(fromTime), toTime(toTime), actions(std::move(actions)) {}
+
+    void Run() noexcept override;
+};
+
+// What a client wants to receive, set through the subscribe command
+struct WsSubscription
+{
+    // empty means every event
+    std::vector<OFS_EventType> events;
+    // empty means every script
+    std::vector<std::string> scripts;
+    static constexpr float DefaultMaxTimeRate = 4.f;
+    // time_change messages per second, 0 means unlimited
+    float maxTimeRate = DefaultMaxTimeRate;
+
+    inline bool WantsEvent(OFS_EventType type) const noexcept
+    {
+        return events.empty() || std::find(events.begin(), events.end(), type) != events.end();
+    }
+
+    inline bool WantsScript(const std::string& name) const noexcept
+    {
+        return scripts.empty() || std::find(scripts.begin(), scripts.end(), name) != scripts.end();
+    }
+};
+
+class WsSubscribeCmd : public WsCmd
 {
-    private:
-    std::vector<std::unique_ptr<WsCmd>> commands;
-    SDL_SpinLock commandLock = {0};
     public:
+    uint32_t clientId = 0;
+    WsSubscription subscription;
+    WsSubscribeCmd(uint32_t clientId, WsSubscription&& subscription) noexcept
+        : clientId(clientId), subscription(std::move(subscription)) {}
 
+    void Run() noexcept override;
+};
+
+class WsCommandBuffer
+{
+    public:
     WsCommandBuffer() noexcept;
-    bool AddCmd(const nlohmann::json& jsonCmd) noexcept;
-    void ProcessCommands() noexcept;
+    // error is only set for commands which got rejected
+    bool AddCmd(const nlohmann::json& jsonCmd, uint32_t clientId, std::string& error) noexcept;
 };
@@ -1,4 +1,12 @@
 #include "OFS_WebsocketApiEvents.h"
+#include "OFS_Profiling.h"
+#include "OFS_Util.h"
+
+#include "SDL_timer.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
 
 inline static void initializeEvent(nlohmann::json& j, const char* eventName)
 {
@@ -46,11 +54,318 @@ void to_json(nlohmann::json& j, const WsFunscriptChange& p)
     initializeEvent(j, "funscript_change");
     nlohmann::json funscript;
     Funscript::Serialize(funscript, p.funscriptData, p.funscriptMetadata, true);
-    j["data"] = { { "name", p.name }, { "funscript",  std::move(funscript) } };
+    j["data"] = { { "name", p.name }, { "version", p.version }, { "funscript",  std::move(funscript) } };
+}
+
+void to_json_packed(nlohmann::json& j, const WsFunscriptChange& p) 
+{
+    initializeEvent(j, "funscript_change");
+    nlohmann::json funscript;
+    Funscript::Serialize(funscript, Funscript::FunscriptData(), p.funscriptMetadata, true);
+    funscript["actions"] = WsPackActions(WsNormalizeActions(p.funscriptData.Actions));
+    j["data"] = { { "name", p.name }, { "version", p.version }, { "funscript",  std::move(funscript) } };
 }
 
 void to_json(nlohmann::json& j, const WsFunscriptRemove& p)
 {
     initializeEvent(j, "funscript_remove");
     j["data"] = { {"name", p.name } };
-}
\ No newline at end of file
+}
+
+void to_json(nlohmann::json& j, const WsAction& p)
+{
+    j = { { "at", p.at }, { "pos", p.pos } };
+}
+
+WsActionArray WsNormalizeActions(const FunscriptArray& actions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    WsActionArray normalized;
+    normalized.reserve(actions.size());
+    int64_t lastTimestamp = -1;
+    for(auto action : actions)
+    {
+        if(action.atS < 0.f) continue;
+        int64_t ts = (int64_t)std::round(action.atS * 1000.0);
+        if(ts != lastTimestamp)
+        {
+            normalized.push_back({ (int32_t)ts, Util::Clamp<int32_t>(action.pos, 0, 100) });
+            lastTimestamp = ts;
+        }
+    }
+    return normalized;
+}
+
+bool WsFunscriptDelta::Diff(const WsActionArray& base, const WsActionArray& actions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    actionCount = actions.size();
+
+    auto addRemoved = [this](uint32_t index) noexcept
+    {
+        if(!removed.empty() && removed.back().index + removed.back().count == index)
+            removed.back().count += 1;
+        else
+            removed.push_back({ index, 1 });
+    };
+    auto addAction = [](std::vector<ActionRange>& ranges, uint32_t index, WsAction action) noexcept
+    {
+        if(!ranges.empty() && ranges.back().index + ranges.back().actions.size() == index)
+            ranges.back().actions.push_back(action);
+        else
+            ranges.push_back({ index, { action } });
+    };
+
+    // Both arrays are sorted by timestamp with unique timestamps
+    size_t i = 0, j = 0;
+    while(i < base.size() || j < actions.size())
+    {
+        if(j >= actions.size() || (i < base.size() && base[i].at < actions[j].at))
+        {
+            addRemoved(i);
+            i += 1;
+        }
+        else if(i >= base.size() || actions[j].at < base[i].at)
+        {
+            addAction(inserted, j, actions[j]);
+            j += 1;
+        }
+        else
+        {
+            if(base[i].pos != actions[j].pos) addAction(modified, j, actions[j]);
+            i += 1;
+            j += 1;
+        }
+    }
+    return !Empty();
+}
+
+nlohmann::json WsPackActions(const WsActionArray& actions) noexcept
+{
+    nlohmann::json::binary_t at;
+    nlohmann::json::binary_t pos;
+    at.resize(actions.size() * sizeof(int32_t));
+    pos.resize(actions.size());
+    for(size_t i = 0, size = actions.size(); i < size; i += 1)
+    {
+        auto ts = (uint32_t)actions[i].at;
+        at[i * 4 + 0] = ts & 0xFF;
+        at[i * 4 + 1] = (ts >> 8) & 0xFF;
+        at[i * 4 + 2] = (ts >> 16) & 0xFF;
+        at[i * 4 + 3] = (ts >> 24) & 0xFF;
+        pos[i] = (uint8_t)actions[i].pos;
+    }
+    at.set_subtype((uint8_t)WsTypedArrayTag::Sint32LE);
+    pos.set_subtype((uint8_t)WsTypedArrayTag::Uint8);
+    return { { "at", std::move(at) }, { "pos", std::move(pos) } };
+}
+
+// Fails for floats and values which don't fit instead of truncating them
+static bool getInt32(const nlohmann::json& json, int32_t& value) noexcept
+{
+    if(json.is_number_unsigned())
+    {
+        auto number = json.get<uint64_t>();
+        if(number > (uint64_t)std::numeric_limits<int32_t>::max()) return false;
+        value = (int32_t)number;
+        return true;
+    }
+    else if(json.is_number_integer())
+    {
+        auto number = json.get<int64_t>();
+        if(number < std::numeric_limits<int32_t>::min() || number > std::numeric_limits<int32_t>::max()) return false;
+        value = (int32_t)number;
+        return true;
+    }
+    return false;
+}
+
+static bool unpackTypedArray(const nlohmann::json& json, WsTypedArrayTag tag, std::vector<int32_t>& values) noexcept
+{
+    if(json.is_array())
+    {
+        values.reserve(json.size());
+        for(auto& value : json)
+        {
+            int32_t number;
+            if(!getInt32(value, number)) return false;
+            values.push_back(number);
+        }
+        return true;
+    }
+    else if(json.is_binary())
+    {
+        auto& bytes = json.get_binary();
+        // other element types would be reinterpreted
+        if(!bytes.has_subtype() || bytes.subtype() != (uint8_t)tag) return false;
+        switch(tag)
+        {
+            case WsTypedArrayTag::Sint32LE:
+                if(bytes.size() % 4 != 0) return false;
+                values.reserve(bytes.size() / 4);
+                for(size_t i = 0; i < bytes.size(); i += 4)
+                {
+                    uint32_t value = bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16) | ((uint32_t)bytes[i + 3] << 24);
+                    values.push_back((int32_t)value);
+                }
+                return true;
+            case WsTypedArrayTag::Uint8:
+                values.assign(bytes.begin(), bytes.end());
+                return true;
+        }
+    }
+    return false;
+}
+
+bool WsUnpackActions(const nlohmann::json& json, FunscriptArray& actions) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    actions.clear();
+    auto addAction = [&actions](int32_t at, int32_t pos) noexcept
+    {
+        if(at < 0) return;
+        actions.emplace_back_unsorted(FunscriptAction(at / 1000.f, Util::Clamp<int32_t>(pos, 0, 100)));
+    };
+
+    if(json.is_array())
+    {
+        actions.reserve(json.size());
+        for(auto& action : json)
+        {
+            if(!action.is_object()) return false;
+            auto at = action.find("at");
+            auto pos = action.find("pos");
+            int32_t atValue, posValue;
+            if(at == action.end() || pos == action.end() || !getInt32(*at, atValue) || !getInt32(*pos, posValue)) return false;
+            addAction(atValue, posValue);
+        }
+    }
+    else if(json.is_object())
+    {
+        auto at = json.find("at");
+        auto pos = json.find("pos");
+        if(at == json.end() || pos == json.end()) return false;
+        std::vector<int32_t> atValues;
+        std::vector<int32_t> posValues;
+        if(!unpackTypedArray(*at, WsTypedArrayTag::Sint32LE, atValues)
+            || !unpackTypedArray(*pos, WsTypedArrayTag::Uint8, posValues)
+            || atValues.size() != posValues.size())
+        {
+            return false;
+        }
+        actions.reserve(atValues.size());
+        for(size_t i = 0; i < atValues.size(); i += 1)
+        {
+            addAction(atValues[i], posValues[i]);
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    // the first one wins for duplicate timestamps
+    std::stable_sort(actions.begin(), actions.end());
+    actions.erase(std::unique(actions.begin(), actions.end(), 
+        [](auto a, auto b) noexcept { return a.atS == b.atS; }), actions.end());
+    return true;
+}
+
+static void serializeDelta(nlohmann::json& j, const WsFunscriptDelta& p, bool packed) noexcept
+{
+    initializeEvent(j, "funscript_delta");
+    auto removed = nlohmann::json::array();
+    for(auto& range : p.removed)
+    {
+        removed.push_back({ { "index", range.index }, { "count", range.count } });
+    }
+    auto actionRanges = [packed](const std::vector<WsFunscriptDelta::ActionRange>& ranges) noexcept
+    {
+        auto json = nlohmann::json::array();
+        for(auto& range : ranges)
+        {
+            nlohmann::json actions = packed ? WsPackActions(range.actions) : nlohmann::json(range.actions);
+            json.push_back({ { "index", range.index }, { "actions", std::move(actions) } });
+        }
+        return json;
+    };
+    j["data"] = {
+        { "name", p.name },
+        { "version", p.version },
+        { "baseVersion", p.version - 1 },
+        { "actionCount", p.actionCount },
+        { "removed", std::move(removed) },
+        { "inserted", actionRanges(p.inserted) },
+        { "modified", actionRanges(p.modified) }
+    };
+    if(!p.metadata.is_null()) j["data"]["metadata"] = p.metadata;
+}
+
+void to_json(nlohmann::json& j, const WsFunscriptDelta& p)
+{
+    serializeDelta(j, p, false);
+}
+
+void to_json_packed(nlohmann::json& j, const WsFunscriptDelta& p)
+{
+    serializeDelta(j, p, true);
+}
+
+int64_t WsServerTimeUs(uint64_t counter) noexcept
+{
+    static const uint64_t startCounter = SDL_GetPerformanceCounter();
+    static const double frequency = (double)SDL_GetPerformanceFrequency();
+    return (int64_t)(((double)(int64_t)(counter - startCounter) / frequency) * 1000000.0);
+}
+
+int64_t WsServerTimeUs() noexcept
+{
+    return WsServerTimeUs(SDL_GetPerformanceCounter());
+}
+
+void to_json(nlohmann::json& j, const WsPlaybackAnchor& p)
+{
+    initializeEvent(j, "playback_anchor");
+    j["data"] = { 
+        { "time", p.time },
+        { "serverTime", p.serverTimeUs },
+        { "speed", p.speed },
+        { "paused", p.paused }
+    };
+}
+
+void to_json(nlohmann::json& j, const WsClockPong& p)
+{
+    initializeEvent(j, "clock_pong");
+    j["data"] = { { "t0", p.t0 }, { "t1", p.t1 }, { "t2", p.t2 } };
+}
+
+OFS_EventType WsEventTypeFromName(const std::string& name) noexcept
+{
+    if(name == "play_change") return WsPlayChange::EventType;
+    else if(name == "time_change") return WsTimeChange::EventType;
+    else if(name == "duration_change") return WsDurationChange::EventType;
+    else if(name == "media_change") return WsMediaChange::EventType;
+    else if(name == "playbackspeed_change") return WsPlaybackSpeedChange::EventType;
+    else if(name == "project_change") return WsProjectChange::EventType;
+    else if(name == "funscript_change") return WsFunscriptChange::EventType;
+    else if(name == "funscript_delta") return WsFunscriptDelta::EventType;
+    else if(name == "funscript_remove") return WsFunscriptRemove::EventType;
+    else if(name == "playback_anchor") return WsPlaybackAnchor::EventType;
+    return BaseEvent::InvalidType;
+}
+
+const char* WsEventName(OFS_EventType type) noexcept
+{
+    if(type == WsPlayChange::EventType) return "play_change";
+    else if(type == WsTimeChange::EventType) return "time_change";
+    else if(type == WsDurationChange::EventType) return "duration_change";
+    else if(type == WsMediaChange::EventType) return "media_change";
+    else if(type == WsPlaybackSpeedChange::EventType) return "playbackspeed_change";
+    else if(type == WsProjectChange::EventType) return "project_change";
+    else if(type == WsFunscriptChange::EventType) return "funscript_change";
+    else if(type == WsFunscriptDelta::EventType) return "funscript_delta";
+    else if(type == WsFunscriptRemove::EventType) return "funscript_remove";
+    else if(type == WsPlaybackAnchor::EventType) return "playback_anchor";
+    return nullptr;
+}
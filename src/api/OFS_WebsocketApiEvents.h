@@ -6,10 +6,13 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 struct ToJsonInterface
 {
     virtual void Serialize(nlohmann::json& json) noexcept = 0;
+    // Used for the ofs-api.cbor subprotocol, only differs for events containing actions
+    virtual void SerializePacked(nlohmann::json& json) noexcept { Serialize(json); }
 };
 
 void to_json(nlohmann::json& j, const class WsProjectChange& p);
@@ -20,6 +23,55 @@ void to_json(nlohmann::json& j, const class WsMediaChange& p);
 void to_json(nlohmann::json& j, const class WsPlaybackSpeedChange& p);
 void to_json(nlohmann::json& j, const class WsFunscriptChange& p);
 void to_json(nlohmann::json& j, const class WsFunscriptRemove& p);
+void to_json(nlohmann::json& j, const class WsFunscriptDelta& p);
+void to_json(nlohmann::json& j, const class WsPlaybackAnchor& p);
+void to_json(nlohmann::json& j, const class WsClockPong& p);
+void to_json_packed(nlohmann::json& j, const class WsFunscriptChange& p);
+void to_json_packed(nlohmann::json& j, const class WsFunscriptDelta& p);
+
+// Maps the name used in the API to the event type, returns BaseEvent::InvalidType for unknown names
+OFS_EventType WsEventTypeFromName(const std::string& name) noexcept;
+// The reverse of WsEventTypeFromName, returns nullptr for types which aren't part of the API
+const char* WsEventName(OFS_EventType type) noexcept;
+
+// Monotonic server clock in microseconds used by clock_pong and playback_anchor.
+// counter is a SDL_GetPerformanceCounter() value.
+int64_t WsServerTimeUs(uint64_t counter) noexcept;
+int64_t WsServerTimeUs() noexcept;
+
+// Action how it is sent to clients, the timestamp is in milliseconds.
+struct WsAction
+{
+    int32_t at;
+    int32_t pos;
+
+    inline bool operator==(const WsAction& b) const noexcept { return at == b.at && pos == b.pos; }
+};
+using WsActionArray = std::vector<WsAction>;
+
+void to_json(nlohmann::json& j, const WsAction& p);
+
+// Applies the same rules as Funscript::Serialize so that indices
+// in a funscript_delta line up with the actions of a funscript_change.
+WsActionArray WsNormalizeActions(const FunscriptArray& actions) noexcept;
+
+// RFC 8746 typed array tags
+enum class WsTypedArrayTag : uint8_t
+{
+    Uint8 = 64,
+    Sint32LE = 78,
+};
+
+// Packs actions into { "at": sint32 little endian typed array, "pos": uint8 typed array }
+// which the CBOR encoder writes as tagged byte strings.
+nlohmann::json WsPackActions(const WsActionArray& actions) noexcept;
+
+// Reads actions sent by a client, timestamps are in milliseconds.
+// Accepts an array of { "at", "pos" } objects or { "at": [...], "pos": [...] }
+// where both may also be typed arrays with the tags WsPackActions writes.
+// Fails for other tags and for numbers which aren't integers fitting into 32 bits.
+// The result is sorted and free of duplicate timestamps.
+bool WsUnpackActions(const nlohmann::json& json, FunscriptArray& actions) noexcept;
 
 class WsMediaChange : public OFS_Event<WsMediaChange>, public ToJsonInterface
 {
@@ -79,11 +131,13 @@ class WsFunscriptChange : public OFS_Event<WsFunscriptChange>, public ToJsonInte
     std::string name;
     Funscript::FunscriptData funscriptData;
     Funscript::Metadata funscriptMetadata;
+    uint32_t version = 0;
 
-    WsFunscriptChange(const std::string& name, Funscript::FunscriptData funscriptData, Funscript::Metadata metadata) noexcept
-        : name(name), funscriptData(std::move(funscriptData)), funscriptMetadata(std::move(metadata)) {}
+    WsFunscriptChange(const std::string& name, Funscript::FunscriptData funscriptData, Funscript::Metadata metadata, uint32_t version) noexcept
+        : name(name), funscriptData(std::move(funscriptData)), funscriptMetadata(std::move(metadata)), version(version) {}
 
     void Serialize(nlohmann::json& json) noexcept override { to_json(json, *this); }
+    void SerializePacked(nlohmann::json& json) noexcept override { to_json_packed(json, *this); }
 };
 
 class WsProjectChange : public OFS_Event<WsProjectChange>, public ToJsonInterface
@@ -104,3 +158,73 @@ class WsFunscriptRemove : public OFS_Event<WsFunscriptRemove>, public ToJsonInte
     void Serialize(nlohmann::json& json) noexcept override { to_json(json, *this); }
 };
 
+// Changes since baseVersion of a script.
+// Clients apply removed (indices into the base version) first
+// then inserted and modified (indices into the new version) in ascending order.
+// A client which doesn't have baseVersion has to send a funscript_resync command.
+class WsFunscriptDelta : public OFS_Event<WsFunscriptDelta>, public ToJsonInterface
+{
+    public:
+    struct Range
+    {
+        uint32_t index;
+        uint32_t count;
+    };
+
+    struct ActionRange
+    {
+        uint32_t index;
+        WsActionArray actions;
+    };
+
+    std::string name;
+    uint32_t version = 0;
+    uint32_t actionCount = 0;
+    std::vector<Range> removed;
+    std::vector<ActionRange> inserted;
+    std::vector<ActionRange> modified;
+    // only set when the metadata changed
+    nlohmann::json metadata;
+
+    WsFunscriptDelta(const std::string& name, uint32_t version) noexcept
+        : name(name), version(version) {}
+
+    // Returns false when there are no differences.
+    bool Diff(const WsActionArray& base, const WsActionArray& actions) noexcept;
+    inline bool Empty() const noexcept { return removed.empty() && inserted.empty() && modified.empty() && metadata.is_null(); }
+
+    void Serialize(nlohmann::json& json) noexcept override { to_json(json, *this); }
+    void SerializePacked(nlohmann::json& json) noexcept override { to_json_packed(json, *this); }
+};
+
+// The playback position at serverTime. While not paused clients extrapolate
+// position = time + (clientNow - serverTime - offset) * speed
+// with the clock offset estimated through clock_ping/clock_pong.
+class WsPlaybackAnchor : public OFS_Event<WsPlaybackAnchor>, public ToJsonInterface
+{
+    public:
+    double time = 0.0;
+    int64_t serverTimeUs = 0;
+    float speed = 1.f;
+    bool paused = true;
+
+    WsPlaybackAnchor(double time, int64_t serverTimeUs, float speed, bool paused) noexcept
+        : time(time), serverTimeUs(serverTimeUs), speed(speed), paused(paused) {}
+
+    void Serialize(nlohmann::json& json) noexcept override { to_json(json, *this); }
+};
+
+// Reply to a clock_ping command, NTP style.
+// t0 is the client send time echoed back, t1 and t2 are the server receive and send times.
+class WsClockPong : public OFS_Event<WsClockPong>, public ToJsonInterface
+{
+    public:
+    nlohmann::json t0;
+    int64_t t1 = 0;
+    int64_t t2 = 0;
+
+    WsClockPong(nlohmann::json t0, int64_t t1, int64_t t2) noexcept
+        : t0(std::move(t0)), t1(t1), t2(t2) {}
+
+    void Serialize(nlohmann::json& json) noexcept override { to_json(json, *this); }
+};
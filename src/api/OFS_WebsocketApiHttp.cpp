@@ -0,0 +1,415 @@
+#include "OFS_WebsocketApiHttp.h"
+#include "OFS_WebsocketApi.h"
+#include "OFS_WebsocketApiClient.h"
+#include "OFS_WebsocketApiEvents.h"
+#include "OFS_EventSystem.h"
+#include "OFS_Profiling.h"
+
+#include "OpenFunscripter.h"
+
+#include "civetweb.h"
+#include "sdefl.h"
+
+#include "SDL_timer.h"
+
+#include <array>
+#include <cstring>
+#include <memory>
+
+static constexpr const char ScriptsUrl[] = "/scripts/";
+static constexpr const char ScriptExtension[] = ".funscript";
+
+static uint32_t crc32(const void* data, size_t size) noexcept
+{
+    static const auto table = []() noexcept
+    {
+        std::array<uint32_t, 256> table;
+        for(uint32_t i = 0; i < 256; i += 1)
+        {
+            uint32_t c = i;
+            for(int k = 0; k < 8; k += 1)
+            {
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xFFFFFFFF;
+    for(size_t i = 0; i < size; i += 1)
+    {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+// sdefl only writes raw deflate, gzip wraps it with a header and a crc32 trailer
+static std::string gzipCompress(const std::string& data) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    static constexpr uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+    auto writeLE32 = [](char* out, uint32_t value) noexcept
+    {
+        for(int i = 0; i < 4; i += 1) out[i] = (char)((value >> (i * 8)) & 0xFF);
+    };
+
+    // sdefl is too big for the stack of a civetweb thread
+    auto ctx = std::make_unique<sdefl>();
+    std::string out(sizeof(header) + sdefl_bound((int)data.size()) + 8, '\0');
+    std::memcpy(out.data(), header, sizeof(header));
+    int compressedSize = sdeflate(ctx.get(), out.data() + sizeof(header), data.data(), (int)data.size(), SDEFL_LVL_DEF);
+
+    char* trailer = out.data() + sizeof(header) + compressedSize;
+    writeLE32(trailer, crc32(data.data(), data.size()));
+    writeLE32(trailer + 4, (uint32_t)data.size());
+    out.resize(sizeof(header) + compressedSize + 8);
+    return out;
+}
+
+static int sendResponse(mg_connection* conn, int status, const char* contentType, const std::string& headers, const void* body, size_t size) noexcept
+{
+    mg_printf(conn,
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "%s"
+        "\r\n",
+        status, mg_get_response_code_text(conn, status), contentType, size, headers.c_str());
+    if(size > 0) mg_write(conn, body, size);
+    return status;
+}
+
+inline static int sendText(mg_connection* conn, int status, const char* contentType, const std::string& text) noexcept
+{
+    return sendResponse(conn, status, contentType, std::string(), text.data(), text.size());
+}
+
+inline static int sendStatus(mg_connection* conn, int status) noexcept
+{
+    return sendResponse(conn, status, "text/plain", std::string(), nullptr, 0);
+}
+
+inline static bool isGet(mg_connection* conn) noexcept
+{
+    return std::strcmp(mg_get_request_info(conn)->request_method, "GET") == 0;
+}
+
+// Script names can contain anything a file name can, civetweb decodes local_uri again.
+static std::string percentEncode(const std::string& str) noexcept
+{
+    static constexpr char hex[] = "0123456789ABCDEF";
+    std::string encoded;
+    encoded.reserve(str.size());
+    for(unsigned char c : str)
+    {
+        // unreserved characters of RFC 3986
+        if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+            || c == '-' || c == '_' || c == '.' || c == '~')
+        {
+            encoded += (char)c;
+        }
+        else
+        {
+            encoded += '%';
+            encoded += hex[c >> 4];
+            encoded += hex[c & 0xF];
+        }
+    }
+    return encoded;
+}
+
+// If-None-Match is either "*" or a comma separated list of entity tags.
+// It uses the weak comparison, a W/ prefix is ignored.
+static bool ifNoneMatches(const char* header, const std::string& etag) noexcept
+{
+    const char* it = header;
+    for(;;)
+    {
+        while(*it == ' ' || *it == '\t' || *it == ',') it += 1;
+        if(*it == '\0') return false;
+        if(*it == '*') return true;
+        if(std::strncmp(it, "W/", 2) == 0) it += 2;
+        if(*it != '"') return false;
+
+        const char* end = std::strchr(it + 1, '"');
+        if(!end) return false;
+        size_t length = end - it + 1;
+        if(length == etag.size() && std::strncmp(it, etag.data(), length) == 0) return true;
+        it = end + 1;
+    }
+}
+
+WsHttpApi::WsHttpApi() noexcept
+{
+    lock = SDL_CreateMutex();
+}
+
+WsHttpApi::~WsHttpApi() noexcept
+{
+    SDL_DestroyMutex(lock);
+}
+
+void WsHttpApi::Register(mg_context* web) noexcept
+{
+    mg_set_request_handler(web, "/scripts",
+        [](mg_connection* conn, void* user) noexcept { return static_cast<WsHttpApi*>(user)->HandleScript(conn); }, this);
+    mg_set_request_handler(web, "/state",
+        [](mg_connection* conn, void* user) noexcept { return static_cast<WsHttpApi*>(user)->HandleState(conn); }, this);
+    mg_set_request_handler(web, "/metrics",
+        [](mg_connection* conn, void* user) noexcept { return static_cast<WsHttpApi*>(user)->HandleMetrics(conn); }, this);
+}
+
+std::string WsHttpApi::ScriptETag(const Funscript& script) const noexcept
+{
+    char etag[32];
+    stbsp_snprintf(etag, sizeof(etag), "\"%u-%u\"", script.EditVersion(), metadataVersion);
+    return etag;
+}
+
+void WsHttpApi::PublishScript(std::shared_ptr<const WsFunscriptUpdate> update) noexcept
+{
+    // the cached json stays until a request sees that the etag changed
+    SDL_LockMutex(lock);
+    scripts[update->name] = std::move(update);
+    SDL_UnlockMutex(lock);
+}
+
+void WsHttpApi::RemoveScript(const std::string& name) noexcept
+{
+    SDL_LockMutex(lock);
+    scripts.erase(name);
+    scriptCache.erase(name);
+    SDL_UnlockMutex(lock);
+}
+
+void WsHttpApi::ClearScripts() noexcept
+{
+    SDL_LockMutex(lock);
+    scripts.clear();
+    scriptCache.clear();
+    SDL_UnlockMutex(lock);
+}
+
+void WsHttpApi::Update(float deltaTime) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    auto app = OpenFunscripter::ptr;
+    auto now = SDL_GetTicks();
+
+    float frameTimeMs = deltaTime * 1000.f;
+    if(now - frameTimeMaxTick >= FrameTimeMaxWindowMs)
+    {
+        frameTimeMax = 0.f;
+        frameTimeMaxTick = now;
+    }
+    frameTimeMax = std::max(frameTimeMax, frameTimeMs);
+
+    auto anchor = app->player->PlaybackAnchor();
+    auto videoPath = app->player->VideoPath();
+    auto& scripts = app->LoadedFunscripts();
+
+    SDL_LockMutex(lock);
+    state.mediaPath = videoPath ? videoPath : "";
+    state.time = anchor.time;
+    state.serverTime = WsServerTimeUs(anchor.counter);
+    state.duration = app->player->Duration();
+    state.speed = anchor.speed;
+    state.paused = anchor.paused;
+
+    // the ETags come from the published scripts
+    state.scripts.resize(scripts.size());
+    for(size_t i = 0; i < scripts.size(); i += 1)
+    {
+        state.scripts[i].name = scripts[i]->Title();
+    }
+
+    state.frameTimeMs = frameTimeMs;
+    state.frameTimeAvgMs += (frameTimeMs - state.frameTimeAvgMs) * 0.05f;
+    state.frameTimeMaxMs = frameTimeMax;
+    state.eventQueueDepth = EV::IngestSize();
+    state.eventQueueFallbacks = EV::IngestFallbacks();
+    state.deviceConnected = app->etcode->is_connected();
+    state.deviceIoMs = app->etcode->io_time_ms();
+    SDL_UnlockMutex(lock);
+}
+
+std::shared_ptr<const WsHttpApi::CachedScript> WsHttpApi::getScript(const std::string& name) noexcept
+{
+    SDL_LockMutex(lock);
+    auto it = scripts.find(name);
+    if(it == scripts.end())
+    {
+        SDL_UnlockMutex(lock);
+        return {};
+    }
+    auto update = it->second;
+    auto cacheIt = scriptCache.find(name);
+    if(cacheIt != scriptCache.end() && cacheIt->second->etag == update->etag)
+    {
+        auto cached = cacheIt->second;
+        SDL_UnlockMutex(lock);
+        return cached;
+    }
+    SDL_UnlockMutex(lock);
+
+    // The update is immutable once published, serializing and compressing happens on this thread.
+    // The chapters get serialized like in serializeFunscriptUpdate.
+    nlohmann::json json;
+    Funscript::FunscriptData data;
+    data.Actions = update->actions;
+    Funscript::Serialize(json, data, update->metadata, true);
+
+    auto script = std::make_shared<CachedScript>();
+    script->etag = update->etag;
+    script->json = Util::SerializeJson(json, false);
+    script->gzip = gzipCompress(script->json);
+
+    SDL_LockMutex(lock);
+    // a newer update may have been published in the meantime, that one needs its own cache entry
+    it = scripts.find(name);
+    if(it != scripts.end() && it->second->etag == script->etag) scriptCache[name] = script;
+    SDL_UnlockMutex(lock);
+    return script;
+}
+
+int WsHttpApi::HandleScript(mg_connection* conn) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    if(!isGet(conn)) return sendStatus(conn, 405);
+
+    const char* uri = mg_get_request_info(conn)->local_uri;
+    size_t uriLength = std::strlen(uri);
+    size_t prefixLength = sizeof(ScriptsUrl) - 1;
+    size_t extensionLength = sizeof(ScriptExtension) - 1;
+    if(uriLength <= prefixLength + extensionLength
+        || std::strncmp(uri, ScriptsUrl, prefixLength) != 0
+        || std::strcmp(uri + uriLength - extensionLength, ScriptExtension) != 0)
+    {
+        return sendStatus(conn, 404);
+    }
+    std::string name(uri + prefixLength, uriLength - prefixLength - extensionLength);
+
+    std::string etag;
+    SDL_LockMutex(lock);
+    auto it = scripts.find(name);
+    if(it != scripts.end()) etag = it->second->etag;
+    SDL_UnlockMutex(lock);
+    if(etag.empty()) return sendStatus(conn, 404);
+
+    const char* ifNoneMatch = mg_get_header(conn, "If-None-Match");
+    if(ifNoneMatch && ifNoneMatches(ifNoneMatch, etag))
+    {
+        return sendResponse(conn, 304, "application/json", "ETag: " + etag + "\r\n", nullptr, 0);
+    }
+
+    // removed in the meantime
+    auto script = getScript(name);
+    if(!script) return sendStatus(conn, 404);
+
+    std::string headers = "ETag: " + script->etag + "\r\nVary: Accept-Encoding\r\n";
+    const char* acceptEncoding = mg_get_header(conn, "Accept-Encoding");
+    if(acceptEncoding && std::strstr(acceptEncoding, "gzip"))
+    {
+        headers += "Content-Encoding: gzip\r\n";
+        return sendResponse(conn, 200, "application/json", headers, script->gzip.data(), script->gzip.size());
+    }
+    return sendResponse(conn, 200, "application/json", headers, script->json.data(), script->json.size());
+}
+
+int WsHttpApi::HandleState(mg_connection* conn) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    if(!isGet(conn)) return sendStatus(conn, 405);
+
+    nlohmann::json json;
+    SDL_LockMutex(lock);
+    json = {
+        { "media", state.mediaPath },
+        { "time", state.time },
+        { "serverTime", state.serverTime },
+        { "duration", state.duration },
+        { "speed", state.speed },
+        { "playing", !state.paused },
+        { "scripts", nlohmann::json::array() }
+    };
+    auto& jsonScripts = json["scripts"];
+    for(auto& script : state.scripts)
+    {
+        // not published by the serialization thread yet
+        auto it = scripts.find(script.name);
+        if(it == scripts.end()) continue;
+        jsonScripts.push_back({
+            { "name", script.name },
+            { "etag", it->second->etag },
+            { "url", ScriptsUrl + percentEncode(script.name) + ScriptExtension }
+        });
+    }
+    SDL_UnlockMutex(lock);
+
+    return sendText(conn, 200, "application/json", Util::SerializeJson(json, false));
+}
+
+int WsHttpApi::HandleMetrics(mg_connection* conn) noexcept
+{
+    OFS_PROFILE(__FUNCTION__);
+    if(!isGet(conn)) return sendStatus(conn, 405);
+
+    // Prometheus text format
+    std::string text;
+    char line[256];
+    auto metric = [&text, &line](const char* name, const char* type, const char* help) noexcept
+    {
+        stbsp_snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+        text += line;
+    };
+    auto value = [&text, &line](const char* name, double value) noexcept
+    {
+        stbsp_snprintf(line, sizeof(line), "%s %g\n", name, value);
+        text += line;
+    };
+    auto clientValue = [&text, &line](const char* name, uint32_t clientId, double value) noexcept
+    {
+        stbsp_snprintf(line, sizeof(line), "%s{client=\"%u\"} %g\n", name, clientId, value);
+        text += line;
+    };
+
+    SDL_LockMutex(lock);
+    auto published = state;
+    SDL_UnlockMutex(lock);
+
+    metric("ofs_frame_time_seconds", "gauge", "Duration of the last frame.");
+    value("ofs_frame_time_seconds", published.frameTimeMs / 1000.0);
+    metric("ofs_frame_time_avg_seconds", "gauge", "Smoothed frame duration.");
+    value("ofs_frame_time_avg_seconds", published.frameTimeAvgMs / 1000.0);
+    metric("ofs_frame_time_max_seconds", "gauge", "Longest frame within the last second.");
+    value("ofs_frame_time_max_seconds", published.frameTimeMaxMs / 1000.0);
+
+    metric("ofs_event_queue_depth", "gauge", "Events posted by worker threads which weren't dispatched yet.");
+    value("ofs_event_queue_depth", (double)published.eventQueueDepth);
+    metric("ofs_event_queue_fallbacks_total", "counter", "Events which didn't fit into the lock-free queue.");
+    value("ofs_event_queue_fallbacks_total", published.eventQueueFallbacks);
+
+    metric("ofs_device_connected", "gauge", "Whether an eTCode device is connected.");
+    value("ofs_device_connected", published.deviceConnected ? 1.0 : 0.0);
+    metric("ofs_device_io_seconds", "gauge", "Smoothed time spent on device I/O per frame.");
+    value("ofs_device_io_seconds", published.deviceIoMs / 1000.0);
+
+    metric("ofs_websocket_queued_messages", "gauge", "Messages waiting in the send queue of a client.");
+    OFS_WebsocketClient::ForEachClient([&](OFS_WebsocketClient& client) noexcept
+        { clientValue("ofs_websocket_queued_messages", client.Id(), client.QueueStats().queuedMessages.load(std::memory_order_relaxed)); });
+    metric("ofs_websocket_queued_bytes", "gauge", "Bytes waiting in the send queue of a client.");
+    OFS_WebsocketClient::ForEachClient([&](OFS_WebsocketClient& client) noexcept
+        { clientValue("ofs_websocket_queued_bytes", client.Id(), (double)client.QueueStats().queuedBytes.load(std::memory_order_relaxed)); });
+    metric("ofs_websocket_sent_total", "counter", "Messages sent to a client.");
+    OFS_WebsocketClient::ForEachClient([&](OFS_WebsocketClient& client) noexcept
+        { clientValue("ofs_websocket_sent_total", client.Id(), client.QueueStats().sentMessages.load(std::memory_order_relaxed)); });
+    metric("ofs_websocket_dropped_total", "counter", "Messages dropped because a client fell behind.");
+    OFS_WebsocketClient::ForEachClient([&](OFS_WebsocketClient& client) noexcept
+        { clientValue("ofs_websocket_dropped_total", client.Id(), client.QueueStats().droppedMessages.load(std::memory_order_relaxed)); });
+
+    return sendText(conn, 200, "text/plain; version=0.0.4", text);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+#include "SDL_mutex.h"
+
+class Funscript;
+class WsFunscriptUpdate;
+struct mg_context;
+struct mg_connection;
+
+// Plain HTTP endpoints served by the same civetweb instance as the websocket API.
+//   GET /scripts/<name>.funscript - the script like it would be saved, supports ETag and gzip
+//   GET /state                    - playback state and the loaded scripts with their ETags
+//   GET /metrics                  - frame time, queue depths and device I/O time
+// Handlers run on civetweb worker threads, they only read what the main thread and
+// the serialization thread published. Scripts are served from the last update the serialization thread got.
+class WsHttpApi
+{
+    public:
+    struct ScriptInfo
+    {
+        std::string name;
+        std::string etag;
+    };
+
+    struct State
+    {
+        std::string mediaPath;
+        // playback position at serverTime, see playback_anchor
+        double time = 0.0;
+        int64_t serverTime = 0;
+        double duration = 0.0;
+        float speed = 1.f;
+        bool paused = true;
+        std::vector<ScriptInfo> scripts;
+
+        float frameTimeMs = 0.f;
+        float frameTimeAvgMs = 0.f;
+        float frameTimeMaxMs = 0.f;
+        size_t eventQueueDepth = 0;
+        uint32_t eventQueueFallbacks = 0;
+        bool deviceConnected = false;
+        double deviceIoMs = 0.0;
+    };
+
+    private:
+    struct CachedScript
+    {
+        std::string etag;
+        std::string json;
+        std::string gzip;
+    };
+
+    SDL_mutex* lock = nullptr;
+    // all guarded by lock
+    State state;
+    std::unordered_map<std::string, std::shared_ptr<const WsFunscriptUpdate>> scripts;
+    std::unordered_map<std::string, std::shared_ptr<const CachedScript>> scriptCache;
+
+    // only accessed by the main thread
+    uint32_t metadataVersion = 1;
+    float frameTimeMax = 0.f;
+    uint32_t frameTimeMaxTick = 0;
+
+    std::shared_ptr<const CachedScript> getScript(const std::string& name) noexcept;
+
+    public:
+    static constexpr uint32_t FrameTimeMaxWindowMs = 1000;
+
+    WsHttpApi() noexcept;
+    ~WsHttpApi() noexcept;
+    WsHttpApi(const WsHttpApi&) = delete;
+    WsHttpApi(WsHttpApi&&) = delete;
+
+    void Register(mg_context* web) noexcept;
+
+    // Publishes the state for the handlers, called every frame
+    void Update(float deltaTime) noexcept;
+    // Metadata and chapters are part of every script, this invalidates all ETags
+    inline void MetadataChanged() noexcept { metadataVersion += 1; }
+
+    // Called by the serialization thread
+    void PublishScript(std::shared_ptr<const WsFunscriptUpdate> update) noexcept;
+    void RemoveScript(const std::string& name) noexcept;
+    void ClearScripts() noexcept;
+
+    std::string ScriptETag(const Funscript& script) const noexcept;
+
+    int HandleScript(mg_connection* conn) noexcept;
+    int HandleState(mg_connection* conn) noexcept;
+    int HandleMetrics(mg_connection* conn) noexcept;
+};
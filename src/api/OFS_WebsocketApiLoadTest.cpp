@@ -0,0 +1,214 @@
+#include "OFS_WebsocketApiLoadTest.h"
+#include "OFS_WebsocketApi.h"
+#include "OFS_WebsocketApiClient.h"
+#include "OFS_WebsocketApiEvents.h"
+#include "OFS_FileLogging.h"
+
+#include "civetweb.h"
+
+#include "SDL_mutex.h"
+#include "SDL_timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+
+static constexpr const char LoadTestScript[] = "__ofs_load_test";
+
+struct LoadTestShared
+{
+    SDL_mutex* lock = nullptr;
+    // guarded by lock
+    std::vector<float> anchorLatencyMs;
+    std::vector<float> scriptLatencyMs;
+    // server time at which each version of the test script was pushed, version 1 is at index 0
+    std::vector<int64_t> updateTimes;
+
+    std::atomic<uint64_t> messages = 0;
+    std::atomic<uint64_t> bytes = 0;
+    std::atomic<uint32_t> protocolMismatches = 0;
+
+    LoadTestShared() noexcept { lock = SDL_CreateMutex(); }
+    ~LoadTestShared() noexcept { SDL_DestroyMutex(lock); }
+};
+
+struct LoadTestClient
+{
+    LoadTestShared* shared = nullptr;
+    WsProtocol protocol = WsProtocol::Json;
+};
+
+static int loadTestDataHandler(mg_connection* conn, int bits, char* data, size_t size, void* user) noexcept
+{
+    auto client = static_cast<LoadTestClient*>(user);
+    auto shared = client->shared;
+    auto receivedUs = WsServerTimeUs();
+    shared->messages.fetch_add(1, std::memory_order_relaxed);
+    shared->bytes.fetch_add(size, std::memory_order_relaxed);
+
+    // Everything the server sends a client uses the negotiated subprotocol, hello included
+    nlohmann::json json;
+    int opcode = bits & 0xF;
+    if(opcode == MG_WEBSOCKET_OPCODE_TEXT && client->protocol == WsProtocol::Json)
+    {
+        json = nlohmann::json::parse(data, data + size, nullptr, false);
+    }
+    else if(opcode == MG_WEBSOCKET_OPCODE_BINARY && client->protocol == WsProtocol::Cbor)
+    {
+        auto bytes = (const uint8_t*)data;
+        json = nlohmann::json::from_cbor(bytes, bytes + size, true, false, nlohmann::json::cbor_tag_handler_t::store);
+    }
+    else
+    {
+        if(opcode == MG_WEBSOCKET_OPCODE_TEXT || opcode == MG_WEBSOCKET_OPCODE_BINARY)
+            shared->protocolMismatches.fetch_add(1, std::memory_order_relaxed);
+        return 1;
+    }
+
+    if(json.is_discarded() || !json.is_object() || json["type"] != "event") return 1;
+    auto& name = json["name"];
+    auto& eventData = json["data"];
+    if(!name.is_string() || !eventData.is_object()) return 1;
+
+    if(name == "playback_anchor" && eventData["serverTime"].is_number())
+    {
+        float latencyMs = (receivedUs - eventData["serverTime"].get<int64_t>()) / 1000.f;
+        SDL_LockMutex(shared->lock);
+        shared->anchorLatencyMs.push_back(latencyMs);
+        SDL_UnlockMutex(shared->lock);
+    }
+    else if((name == "funscript_change" || name == "funscript_delta")
+        && eventData["name"] == LoadTestScript && eventData["version"].is_number())
+    {
+        auto version = eventData["version"].get<uint32_t>();
+        SDL_LockMutex(shared->lock);
+        if(version > 0 && version <= shared->updateTimes.size())
+        {
+            shared->scriptLatencyMs.push_back((receivedUs - shared->updateTimes[version - 1]) / 1000.f);
+        }
+        SDL_UnlockMutex(shared->lock);
+    }
+    return 1;
+}
+
+static WsLoadTestResult::Latency percentiles(const char* name, std::vector<float>& samples) noexcept
+{
+    WsLoadTestResult::Latency latency;
+    latency.name = name;
+    latency.samples = samples.size();
+    if(samples.empty()) return latency;
+
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](float q) noexcept { return samples[(size_t)(q * (samples.size() - 1) + 0.5f)]; };
+    latency.p50Ms = at(0.5f);
+    latency.p90Ms = at(0.9f);
+    latency.p99Ms = at(0.99f);
+    latency.maxMs = samples.back();
+    return latency;
+}
+
+bool OFS_WebsocketLoadTest::Run(EventSerializationContext* ctx, int port, const WsLoadTestConfig& config, WsLoadTestResult& result) noexcept
+{
+    LoadTestShared shared;
+    std::vector<LoadTestClient> clients(config.clients);
+    std::vector<mg_connection*> connections;
+    char errorBuffer[256] = {0};
+
+    // The server has a worker thread for every client, see OFS_WebsocketApi::RunLoadTest.
+    // Clients alternate between the json and the cbor subprotocol.
+    // civetweb's websocket client has no parameter for the subprotocol,
+    // the header gets appended to the Origin line of the handshake.
+    static constexpr const char* Origins[] = {
+        "http://127.0.0.1\r\nSec-WebSocket-Protocol: ofs-api.json",
+        "http://127.0.0.1\r\nSec-WebSocket-Protocol: ofs-api.cbor"
+    };
+    for(int i = 0; i < config.clients; i += 1)
+    {
+        auto& client = clients[i];
+        client.shared = &shared;
+        client.protocol = i % 2 == 0 ? WsProtocol::Json : WsProtocol::Cbor;
+        auto conn = mg_connect_websocket_client("127.0.0.1", port, 0, errorBuffer, sizeof(errorBuffer), "/ofs",
+            Origins[(int)client.protocol], loadTestDataHandler, nullptr, &client);
+        if(!conn)
+        {
+            LOGF_ERROR("Websocket load test: failed to connect. %s", errorBuffer);
+            break;
+        }
+        connections.push_back(conn);
+        if(client.protocol == WsProtocol::Cbor) result.cborClients += 1;
+    }
+    if(connections.empty()) return false;
+
+    std::mt19937 random(1337);
+    FunscriptArray actions;
+    actions.reserve(config.scriptActions);
+    for(int i = 0; i < config.scriptActions; i += 1)
+    {
+        actions.emplace_back_unsorted(FunscriptAction(i * 0.1f, (int32_t)(random() % 101)));
+    }
+
+    ctx->Stats(true);
+    const int64_t anchorIntervalUs = config.anchorsPerSecond > 0 ? 1000000 / config.anchorsPerSecond : INT64_MAX;
+    const int64_t editIntervalUs = config.editsPerSecond > 0 ? 1000000 / config.editsPerSecond : INT64_MAX;
+    const int64_t startUs = WsServerTimeUs();
+    const int64_t endUs = startUs + (int64_t)(config.seconds * 1000000.f);
+    int64_t nextAnchorUs = startUs;
+    int64_t nextEditUs = startUs;
+
+    for(int64_t nowUs = startUs; nowUs < endUs; nowUs = WsServerTimeUs())
+    {
+        if(nowUs >= nextAnchorUs)
+        {
+            ctx->Push<WsPlaybackAnchor>((nowUs - startUs) / 1000000.0, WsServerTimeUs(), 1.f, false);
+            nextAnchorUs += anchorIntervalUs;
+        }
+        if(nowUs >= nextEditUs && !actions.empty())
+        {
+            for(int i = 0; i < config.actionsPerEdit; i += 1)
+            {
+                auto& action = actions[random() % actions.size()];
+                action.pos = (action.pos + 37) % 101;
+            }
+            SDL_LockMutex(shared.lock);
+            shared.updateTimes.push_back(WsServerTimeUs());
+            SDL_UnlockMutex(shared.lock);
+            ctx->Push<WsFunscriptUpdate>(LoadTestScript, actions, Funscript::Metadata(), false, false, 0);
+            nextEditUs += editIntervalUs;
+        }
+        ctx->StartProcessing();
+        SDL_Delay(1);
+    }
+
+    // Give the clients time to receive what is still queued
+    SDL_Delay(1000);
+    result.seconds = (WsServerTimeUs() - startUs) / 1000000.0;
+    ctx->Push<WsFunscriptRemove>(LoadTestScript);
+    ctx->StartProcessing();
+
+    for(auto conn : connections)
+    {
+        mg_close_connection(conn);
+    }
+
+    result.clients = (int)connections.size();
+    result.messages = shared.messages.load();
+    result.bytes = shared.bytes.load();
+    result.protocolMismatches = shared.protocolMismatches.load();
+    SDL_LockMutex(shared.lock);
+    result.latencies.emplace_back(percentiles("playback_anchor", shared.anchorLatencyMs));
+    result.latencies.emplace_back(percentiles("funscript", shared.scriptLatencyMs));
+    SDL_UnlockMutex(shared.lock);
+
+    auto frequency = (double)SDL_GetPerformanceFrequency();
+    for(auto& stats : ctx->Stats(false))
+    {
+        WsLoadTestResult::Serialization serialization;
+        serialization.name = stats.type == WsFunscriptUpdate::EventType ? "funscript_update" : WsEventName(stats.type);
+        if(!serialization.name) serialization.name = "internal";
+        serialization.count = stats.count;
+        serialization.ms = stats.ticks * 1000.0 / frequency;
+        result.serialization.push_back(serialization);
+    }
+    return result.protocolMismatches == 0;
+}
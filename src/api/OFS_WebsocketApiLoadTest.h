@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct EventSerializationContext;
+
+struct WsLoadTestConfig
+{
+    int clients = 3;
+    float seconds = 5.f;
+    int scriptActions = 10000;
+    int editsPerSecond = 20;
+    int actionsPerEdit = 50;
+    int anchorsPerSecond = 120;
+};
+
+struct WsLoadTestResult
+{
+    struct Latency
+    {
+        const char* name = "";
+        size_t samples = 0;
+        float p50Ms = 0.f;
+        float p90Ms = 0.f;
+        float p99Ms = 0.f;
+        float maxMs = 0.f;
+    };
+
+    struct Serialization
+    {
+        const char* name = "";
+        uint32_t count = 0;
+        double ms = 0.0;
+    };
+
+    int clients = 0;
+    // every second client negotiates ofs-api.cbor, the others ofs-api.json
+    int cborClients = 0;
+    // messages which didn't arrive in the subprotocol the client negotiated
+    uint32_t protocolMismatches = 0;
+    double seconds = 0.0;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    std::vector<Latency> latencies;
+    std::vector<Serialization> serialization;
+
+    inline double MessagesPerSecond() const noexcept { return seconds > 0.0 ? messages / seconds : 0.0; }
+    inline double BytesPerSecond() const noexcept { return seconds > 0.0 ? bytes / seconds : 0.0; }
+};
+
+// Connects local clients to the load test websocket server and drives synthetic
+// script edits and playback anchors through its serialization thread.
+// The server needs a worker thread for each of the clients.
+// Latency is measured from pushing the event until a client parsed the message.
+// Fails if no client connected or a message didn't use the negotiated subprotocol.
+class OFS_WebsocketLoadTest
+{
+    public:
+    static bool Run(EventSerializationContext* ctx, int port, const WsLoadTestConfig& config, WsLoadTestResult& result) noexcept;
+};
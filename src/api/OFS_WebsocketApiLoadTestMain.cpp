@@ -0,0 +1,82 @@
+#include "OFS_WebsocketApi.h"
+#include "OFS_WebsocketApiLoadTest.h"
+#include "OFS_EventSystem.h"
+#include "OFS_FileLogging.h"
+#include "OFS_Util.h"
+
+#include "SDL_main.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Headless websocket load test, doesn't open a window so it can run in CI.
+// Exits with 1 if the test failed or a client didn't receive any anchors or script updates.
+// usage: OFS_WebsocketLoadTest [--clients N] [--seconds S] [--actions N]
+//        [--edits N] [--actions-per-edit N] [--anchors N]
+int main(int argc, char* argv[])
+{
+    WsLoadTestConfig config;
+    for(int i = 1; i < argc; i += 1)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(!value)
+        {
+            std::fprintf(stderr, "Missing value for %s\n", arg);
+            return 1;
+        }
+
+        if(std::strcmp(arg, "--clients") == 0) config.clients = std::atoi(value);
+        else if(std::strcmp(arg, "--seconds") == 0) config.seconds = (float)std::atof(value);
+        else if(std::strcmp(arg, "--actions") == 0) config.scriptActions = std::atoi(value);
+        else if(std::strcmp(arg, "--edits") == 0) config.editsPerSecond = std::atoi(value);
+        else if(std::strcmp(arg, "--actions-per-edit") == 0) config.actionsPerEdit = std::atoi(value);
+        else if(std::strcmp(arg, "--anchors") == 0) config.anchorsPerSecond = std::atoi(value);
+        else
+        {
+            std::fprintf(stderr, "Unknown argument %s\n", arg);
+            return 1;
+        }
+        i += 1;
+    }
+    if(config.clients < 1 || config.seconds <= 0.f)
+    {
+        std::fprintf(stderr, "Needs at least one client and a positive duration\n");
+        return 1;
+    }
+
+    OFS_FileLogger::Init();
+    // The websocket clients subscribe to the event queue
+    EV::Init();
+
+    std::printf("Websocket load test: %d clients, %.1f s, %d actions, %d edits/s of %d actions, %d anchors/s\n",
+        config.clients, config.seconds, config.scriptActions, config.editsPerSecond, config.actionsPerEdit, config.anchorsPerSecond);
+    WsLoadTestResult result;
+    bool success = OFS_WebsocketApi::RunLoadTest(config, result);
+
+    // FormatBytes returns a shared buffer
+    std::string bytes = Util::FormatBytes(result.bytes);
+    std::string bytesPerSecond = Util::FormatBytes((size_t)result.BytesPerSecond());
+    std::printf("%d clients (%d cbor) received %llu messages (%.0f/s) %s (%s/s)\n", result.clients, result.cborClients,
+        (unsigned long long)result.messages, result.MessagesPerSecond(), bytes.c_str(), bytesPerSecond.c_str());
+    for(auto& latency : result.latencies)
+    {
+        std::printf("%-20s %8zu samples p50 %7.2f ms p90 %7.2f ms p99 %7.2f ms max %7.2f ms\n", latency.name,
+            latency.samples, latency.p50Ms, latency.p90Ms, latency.p99Ms, latency.maxMs);
+        if(latency.samples == 0) success = false;
+    }
+    for(auto& serialization : result.serialization)
+    {
+        std::printf("%-20s %8u events %8.2f ms serialization %7.3f ms/event\n", serialization.name,
+            serialization.count, serialization.ms, serialization.count > 0 ? serialization.ms / serialization.count : 0.0);
+    }
+    if(result.protocolMismatches > 0)
+    {
+        std::printf("%u messages didn't use the negotiated subprotocol\n", result.protocolMismatches);
+    }
+
+    OFS_FileLogger::Shutdown();
+    return success ? 0 : 1;
+}
@@ -4,5 +4,8 @@ extern "C" {
 	#include "lua.h"
 	#include "lauxlib.h"
 	#include "lualib.h"
+#ifdef OFS_LUAJIT
+	#include "luajit.h"
+#endif
 }
 #include "sol/sol.hpp"
\ No newline at end of file
@@ -2,8 +2,165 @@
 #include "OFS_LuaExtensions.h"
 #include "OFS_Util.h"
 #include "OpenFunscripter.h"
+#include "OFS_Profiling.h"
+#include "OFS_JobSystem.h"
+
+#include "SDL_timer.h"
 
 #include <string>
+#include <cstdlib>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+static std::unordered_map<std::string, std::unique_ptr<OFS_LuaMemoryStats>> LuaMemoryStats;
+
+static void* luaAllocator(void* ud, void* ptr, size_t osize, size_t nsize) noexcept
+{
+	auto stats = static_cast<OFS_LuaMemoryStats*>(ud);
+	// when ptr is NULL osize encodes the type of object being allocated
+	size_t oldSize = ptr ? osize : 0;
+	if (nsize == 0) {
+		free(ptr);
+		stats->Allocated -= oldSize;
+		return nullptr;
+	}
+
+	// lua expects shrinking to never fail
+	if (stats->Limit > 0 && nsize > oldSize && stats->Allocated - oldSize + nsize > stats->Limit) {
+		stats->LimitExceeded = true;
+		// the extension gets shut down at the end of the frame
+		if (stats->ProtectedCalls > 0) return nullptr;
+	}
+
+	void* newPtr = realloc(ptr, nsize);
+	if (newPtr) {
+		stats->Allocated = stats->Allocated - oldSize + nsize;
+		stats->Peak = std::max(stats->Peak, stats->Allocated);
+	}
+	return newPtr;
+}
+
+size_t OFS_LuaExtension::TotalMemoryUsage() noexcept
+{
+	size_t bytes = 0;
+	for (auto& [name, stats] : LuaMemoryStats) {
+		if (stats) bytes += stats->Allocated;
+	}
+	return bytes;
+}
+
+void OFS_LuaTiming::Add(float ms) noexcept
+{
+	uint32_t bucket = 0;
+	while (bucket < BucketCount - 1 && ms > BucketLimitMs(bucket)) bucket += 1;
+	Buckets[bucket] += 1;
+	Count += 1;
+	TotalMs += ms;
+	MaxMs = std::max(MaxMs, ms);
+}
+
+float OFS_LuaTiming::Percentile(float p) const noexcept
+{
+	if (Count == 0) return 0.f;
+	uint64_t target = (uint64_t)std::ceil(p * Count);
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < BucketCount - 1; i += 1) {
+		seen += Buckets[i];
+		if (seen >= target) return std::min(BucketLimitMs(i), MaxMs);
+	}
+	return MaxMs;
+}
+
+const char* OFS_LuaTiming::TypeName(Type type) noexcept
+{
+	switch (type) {
+		case Update: return "update";
+		case Gui: return "gui";
+		case ScriptChange: return "scriptChange";
+		case Execute: return "binding";
+		case Tasks: return "tasks";
+		default: return "";
+	}
+}
+
+// Adds the time until it goes out of scope to the extension
+class OFS_LuaTimingScope
+{
+	private:
+		OFS_LuaExtension* ext;
+		OFS_LuaTiming::Type type;
+		uint64_t start;
+	public:
+		inline OFS_LuaTimingScope(OFS_LuaExtension* ext, OFS_LuaTiming::Type type) noexcept
+			: ext(ext), type(type), start(SDL_GetPerformanceCounter()) {}
+		inline ~OFS_LuaTimingScope() noexcept { ext->addTiming(type, start); }
+};
+
+void OFS_LuaExtension::addTiming(OFS_LuaTiming::Type type, uint64_t startTicks) noexcept
+{
+	float ms = (float)((SDL_GetPerformanceCounter() - startTicks) * 1000.0 / SDL_GetPerformanceFrequency());
+	timings[type].Add(ms);
+	frameMs += ms;
+}
+
+void OFS_LuaExtension::ResetStats() noexcept
+{
+	timings = {};
+	framesOverBudget = 0;
+	if (memory) {
+		memory->Peak = memory->Allocated;
+		memory->LimitExceeded = false;
+	}
+}
+
+bool OFS_LuaExtension::EndFrame(float frameBudgetMs, uint32_t maxFramesOverBudget, bool autoDisable) noexcept
+{
+	lastFrameMs = frameMs;
+	frameMs = 0.f;
+	if (!Active) return true;
+
+	// allocations past the limit went through outside of protected calls, the extension can't keep running
+	if (memory && memory->LimitExceeded) {
+		Shutdown();
+		AddError(Util::Format("%s was disabled because it exceeded its memory limit of %d MB.", Name.c_str(), MemoryLimitMB));
+		return false;
+	}
+
+	framesOverBudget = lastFrameMs > frameBudgetMs ? framesOverBudget + 1 : 0;
+	if (!autoDisable) return true;
+
+	if (framesOverBudget >= maxFramesOverBudget) {
+		Shutdown();
+		AddError(Util::Format("%s was disabled because it took longer than %.1f ms for %u frames in a row.",
+			Name.c_str(), frameBudgetMs, framesOverBudget));
+		return false;
+	}
+	return true;
+}
+
+void OFS_LuaExtension::SetMemoryLimit(int limitMB) noexcept
+{
+	MemoryLimitMB = std::max(limitMB, 0);
+	if (memory) {
+		memory->Limit = (size_t)MemoryLimitMB * 1024 * 1024;
+		memory->LimitExceeded = false;
+	}
+}
+
+sol::state OFS_LuaExtension::createState() noexcept
+{
+	auto& stats = LuaMemoryStats[NameId];
+	if (!stats) {
+		stats = std::make_unique<OFS_LuaMemoryStats>();
+	}
+	memory = stats.get();
+	// only used for inactive extensions
+	memory->Limit = 0;
+	memory->LimitExceeded = false;
+	return sol::state(sol::default_at_panic, luaAllocator, memory);
+}
 
 void OFS_LuaExtension::Toggle() noexcept
 {
@@ -17,7 +174,7 @@ void OFS_LuaExtension::Toggle() noexcept
 
 void OFS_LuaExtension::ShowWindow() noexcept
 {
-	if(!WindowOpen || !Active) return;
+	if(!WindowOpen || !Active || !ensureLoaded()) return;
 	ImGui::Begin(NameId.c_str(), &WindowOpen, ImGuiWindowFlags_None);
 	if(!Error.empty())
 	{
@@ -38,8 +195,9 @@ void OFS_LuaExtension::ShowWindow() noexcept
 		ImGui::Separator();
 	}
 
+	OFS_LuaTimingScope timing(this, OFS_LuaTiming::Gui);
 	auto gui = L.get<sol::protected_function>(OFS_LuaExtensions::RenderGui);
-	auto res = gui();
+	auto res = OFS_LuaProtectedCall(L.lua_state(), [&]() { return gui(); });
 	if(res.status() != sol::call_status::ok) {
 		auto err = sol::stack::get_traceback_or_errors(L.lua_state());
 		AddError(err.what());
@@ -52,9 +210,14 @@ void OFS_LuaExtension::ShowWindow() noexcept
 
 void OFS_LuaExtension::Update() noexcept
 {
-	if(!Active) return;
+	if(!Active || !IsLoaded()) return;
+	OFS_LuaTimingScope timing(this, OFS_LuaTiming::Update);
+	// output and exit callbacks of processes
+	if(!api->procAPI->Dispatch()) {
+		AddError(api->procAPI->Error().c_str());
+	}
 	auto update = L.get<sol::protected_function>(OFS_LuaExtensions::UpdateFunction);
-	auto res = update(ImGui::GetIO().DeltaTime);
+	auto res = OFS_LuaProtectedCall(L.lua_state(), [&]() { return update(ImGui::GetIO().DeltaTime); });
 	if(res.status() != sol::call_status::ok)
 	{
 		auto err = sol::stack::get_traceback_or_errors(L.lua_state());
@@ -62,31 +225,27 @@ void OFS_LuaExtension::Update() noexcept
 	}
 }
 
-bool OFS_LuaExtension::Load() noexcept
+// Only touches the prepared state, this runs on worker threads
+bool OFS_LuaExtension::prepareState(const std::string& extensionDir, int memoryLimitMB, OFS_LuaPreparedState& prepared) noexcept
 {
-    auto directory = Util::PathFromString(this->Directory);
-    auto mainFile = directory / OFS_LuaExtension::MainFile;
-
-	NameId = directory.filename().u8string();
-	NameId = Util::Format("%s##_%s_", Name.c_str(), Name.c_str());
-	ClearError();
+	OFS_PROFILE(__FUNCTION__);
+	auto directory = Util::PathFromString(extensionDir);
+	auto mainFile = directory / OFS_LuaExtension::MainFile;
 
 	std::string extensionText;
 	{
 		std::vector<uint8_t> dataBuf;
 		if (!Util::ReadFile(mainFile.u8string().c_str(), dataBuf)) {
-			FUN_ASSERT(false, "no file");
+			prepared.Error = Util::Format("Failed to read \"%s\".", mainFile.u8string().c_str());
 			return false;
 		}
 		extensionText = std::string((char*)dataBuf.data(), dataBuf.size());
 	}
 
-	//UpdateTime = 0.f;
-	//MaxUpdateTime = 0.f;
-	//MaxGuiTime = 0.f;
-	//Bindables.clear();
-
-	L = sol::state();
+	prepared.Stats = std::make_unique<OFS_LuaMemoryStats>();
+	prepared.Stats->Limit = (size_t)std::max(memoryLimitMB, 0) * 1024 * 1024;
+	prepared.L = sol::state(sol::default_at_panic, luaAllocator, prepared.Stats.get());
+	auto& L = prepared.L;
 	L.open_libraries(
 		sol::lib::base,
 		sol::lib::package,
@@ -98,6 +257,9 @@ bool OFS_LuaExtension::Load() noexcept
 		sol::lib::utf8,
 		sol::lib::io
 	);
+#ifdef OFS_LUAJIT
+	L.open_libraries(sol::lib::bit32, sol::lib::ffi, sol::lib::jit);
+#endif
 
 	{
 		auto addToLuaPath = [](lua_State* L, const char* path) noexcept
@@ -112,10 +274,68 @@ bool OFS_LuaExtension::Load() noexcept
 			lua_setfield(L, -2, "path"); // set the field "path" in table at -2 with value at top of stack
 			lua_pop(L, 1); // get rid of package table from top of stack
 		};
-		auto dirPath = Util::PathFromString(Directory);
-		addToLuaPath(L.lua_state(), (dirPath / "?.lua").u8string().c_str());
-		addToLuaPath(L.lua_state(), (dirPath / "lib" / "?.lua").u8string().c_str());
+		addToLuaPath(L.lua_state(), (directory / "?.lua").u8string().c_str());
+		addToLuaPath(L.lua_state(), (directory / "lib" / "?.lua").u8string().c_str());
+	}
+
+	// Only compiles main.lua, running it may already call into OFS
+	auto chunkName = "@" + mainFile.u8string();
+	auto chunk = OFS_LuaProtectedCall(L.lua_state(), [&]() { return L.load(extensionText, chunkName); });
+	if (!chunk.valid()) {
+		sol::error err = chunk;
+		prepared.Error = err.what();
+		return false;
 	}
+	prepared.Chunk = chunk;
+	return true;
+}
+
+// An empty function only has the line of its "end" as active line.
+// One-liners can't be told apart and count as not empty.
+static bool isEmptyFunction(const sol::protected_function& func) noexcept
+{
+	if (!func.valid()) return true;
+	auto L = func.lua_state();
+	func.push();
+	lua_Debug ar;
+	lua_getinfo(L, ">SL", &ar);
+	if (!lua_istable(L, -1) || ar.linedefined == ar.lastlinedefined) {
+		lua_pop(L, 1);
+		return false;
+	}
+	int activeLines = 0;
+	lua_pushnil(L);
+	while (lua_next(L, -2) != 0) {
+		lua_pop(L, 1);
+		activeLines += 1;
+	}
+	lua_pop(L, 1);
+	return activeLines <= 1;
+}
+
+bool OFS_LuaExtension::finishLoad(OFS_LuaPreparedState& prepared) noexcept
+{
+	OFS_PROFILE(__FUNCTION__);
+	NameId = Util::Format("%s##_%s_", Name.c_str(), Name.c_str());
+	ClearError();
+	deferred = false;
+	// dropped if the load fails
+	auto bindings = std::move(pendingBindings);
+	pendingBindings.clear();
+	if (!prepared.Error.empty()) {
+		AddError(prepared.Error.c_str());
+		return false;
+	}
+
+	// the tasks and the api refer to the old state
+	clearTasks();
+	framesOverBudget = 0;
+	releaseApi();
+	L = std::move(prepared.L);
+	// the old state is gone, so are all allocations which were counted by the old stats
+	auto& stats = LuaMemoryStats[NameId];
+	stats = std::move(prepared.Stats);
+	memory = stats.get();
 
 	auto ofs = L.new_usertype<OFS_ExtensionAPI>("ofs");
 	ofs["Version"] = []() noexcept { return OFS_ExtensionAPI::VersionAPI; };
@@ -133,6 +353,8 @@ bool OFS_LuaExtension::Load() noexcept
 
 	// FIXME: if the extension gets relocated this breaks horribly
 	ofs["ExtensionDir"] = [this]() noexcept { return this->Directory.c_str(); };
+	ofs["Task"] = [this](sol::function func) noexcept { this->AddTask(func); };
+	ofs["TaskBudgetExceeded"] = []() noexcept { return OFS_LuaExtensions::TaskBudgetExceeded(); };
 	L[OFS_LuaExtensions::GlobalExtensionPtr] = this;
 
 #ifndef NDEBUG
@@ -151,11 +373,16 @@ bool OFS_LuaExtension::Load() noexcept
 
 	try
 	{
-		auto res = L.safe_script(extensionText);
-		FUN_ASSERT(res.valid(), "what");
+		auto chunk = std::move(prepared.Chunk);
+		auto res = OFS_LuaProtectedCall(L.lua_state(), [&]() { return chunk(); });
+		if(!res.valid()) {
+			sol::error err = res;
+			AddError(err.what());
+			return false;
+		}
 
 		auto init = L.get<sol::protected_function>(OFS_LuaExtensions::InitFunction);
-		res = init();
+		res = OFS_LuaProtectedCall(L.lua_state(), [&]() { return init(); });
 		if(res.status() != sol::call_status::ok) {
 			auto err = sol::stack::get_traceback_or_errors(L.lua_state());
 			AddError(err.what());
@@ -168,6 +395,7 @@ bool OFS_LuaExtension::Load() noexcept
 		return false;
 	}
 
+	LazyBindings.clear();
 	sol::table btable = L[OFS_LuaExtension::BindingTable];
 	if(btable.valid()) {
 		auto app = OpenFunscripter::ptr;
@@ -177,34 +405,248 @@ bool OFS_LuaExtension::Load() noexcept
 			std::string name = keyStr;
 			std::string globalName = Util::Format("%s::%s", Name.c_str(), keyStr);
 			app->extensions->AddBinding(NameId, globalName, name);
+			LazyBindings.emplace_back(std::move(name));
 		}
 	}
 
+	// Extensions which only provide bindings don't get loaded on the next start until they are used
+	sol::protected_function change = L[OFS_LuaExtension::ScriptChangeFunction];
+	Lazy = !LazyBindings.empty() && !change.valid()
+		&& isEmptyFunction(L.get<sol::protected_function>(OFS_LuaExtensions::UpdateFunction));
+
+	for(auto& func : bindings) {
+		Execute(func);
+	}
 	return true;
 }
 
+bool OFS_LuaExtension::Load() noexcept
+{
+	// invalidates loads which are still running
+	loadGeneration += 1;
+	loading = false;
+	OFS_LuaPreparedState prepared;
+	prepareState(Directory, MemoryLimitMB, prepared);
+	return finishLoad(prepared);
+}
+
+void OFS_LuaExtension::LoadAsync() noexcept
+{
+	auto generation = ++loadGeneration;
+	loading = true;
+	auto prepared = std::make_shared<OFS_LuaPreparedState>();
+	auto name = Name;
+	OFS_JobSystem::ptr->Submit(FMT("%s: %s", TR(LOADING_EXTENSION), Name.c_str()),
+		[prepared, directory = Directory, memoryLimitMB = MemoryLimitMB](OFS_JobContext& ctx) noexcept {
+			return prepareState(directory, memoryLimitMB, *prepared);
+		},
+		[prepared, name, generation](const OFS_Job& job) noexcept {
+			// the extension may have been moved or removed in the meantime
+			auto app = OpenFunscripter::ptr;
+			if(!app || !app->extensions) return;
+			for(auto& ext : app->extensions->Extensions) {
+				if(ext.Name != name) continue;
+				if(ext.loadGeneration == generation && ext.loading && ext.Active) {
+					ext.loading = false;
+					// a job cancelled before it ran never prepared the state
+					if(!job.Succeeded() && prepared->Error.empty()) {
+						ext.pendingBindings.clear();
+						ext.AddError(TR(EXTENSION_LOAD_CANCELLED));
+						break;
+					}
+					ext.finishLoad(*prepared);
+				}
+				break;
+			}
+		});
+}
+
+bool OFS_LuaExtension::LoadDeferred() noexcept
+{
+	if(!Lazy || WindowOpen || LazyBindings.empty()) return false;
+	NameId = Util::Format("%s##_%s_", Name.c_str(), Name.c_str());
+	ClearError();
+	auto app = OpenFunscripter::ptr;
+	for(auto& name : LazyBindings) {
+		app->extensions->AddBinding(NameId, Util::Format("%s::%s", Name.c_str(), name.c_str()), name);
+	}
+	deferred = true;
+	return true;
+}
+
+bool OFS_LuaExtension::ensureLoaded() noexcept
+{
+	if(loading) return false;
+	if(deferred) {
+		LOGF_INFO("Loading deferred extension \"%s\".", Name.c_str());
+		return Load();
+	}
+	return true;
+}
+
+#ifndef OFS_LUAJIT
+// Tasks which never call checkpoint() still give up the rest of the frame.
+// Inside of calls from C into lua the task can't yield and keeps running.
+static void taskHook(lua_State* L, lua_Debug* ar) noexcept
+{
+	if(ar->event == LUA_HOOKCOUNT && lua_isyieldable(L) && OFS_LuaExtensions::TaskBudgetExceeded()) {
+		lua_yield(L, 0);
+	}
+}
+#endif
+
+OFS_LuaTask OFS_LuaExtension::createTask(const sol::function& func, bool scriptChange) noexcept
+{
+	OFS_LuaTask task;
+	task.Thread = sol::thread::create(L.lua_state());
+	auto thread = task.Thread.thread_state();
+#ifndef OFS_LUAJIT
+	// LuaJIT doesn't run hooks in compiled code
+	lua_sethook(thread, taskHook, LUA_MASKCOUNT, TaskHookInstructions);
+#endif
+	func.push(thread);
+	task.Coroutine = sol::coroutine(thread, -1);
+	lua_pop(thread, 1);
+	task.ScriptChange = scriptChange;
+	return task;
+}
+
+template<typename... Args>
+bool OFS_LuaExtension::resumeTask(OFS_LuaTask& task, Args&&... args) noexcept
+{
+	auto res = OFS_LuaProtectedCall(L.lua_state(), [&]() { return task.Coroutine(std::forward<Args>(args)...); });
+	if(res.status() == sol::call_status::yielded) {
+		return true;
+	}
+	if(!res.valid()) {
+		// the dead coroutine keeps its stack, the traceback shows where it failed
+		auto err = sol::stack::get_traceback_or_errors(task.Thread.thread_state());
+		AddError(err.what());
+	}
+	if(!api->guiAPI->Validate()) {
+		AddError(api->guiAPI->Error().c_str());
+	}
+	return false;
+}
+
+bool OFS_LuaExtension::scriptChangeRunning() const noexcept
+{
+	auto isScriptChange = [](auto& task) noexcept { return task.ScriptChange; };
+	return std::any_of(tasks.begin(), tasks.end(), isScriptChange)
+		|| std::any_of(newTasks.begin(), newTasks.end(), isScriptChange);
+}
+
+bool OFS_LuaExtension::HasPendingWork() const noexcept
+{
+	if(!Active || !IsLoaded()) return false;
+	return TaskCount() > 0 || !pendingScriptChanges.empty() || (api && api->procAPI->IsWatching());
+}
+
+void OFS_LuaExtension::clearTasks() noexcept
+{
+	tasks.clear();
+	newTasks.clear();
+	pendingScriptChanges.clear();
+}
+
+void OFS_LuaExtension::releaseApi() noexcept
+{
+	// the process callbacks reference the state, the processes themselves would keep running
+	if (api) {
+		api->procAPI->Shutdown();
+	}
+	api.reset();
+}
+
+void OFS_LuaExtension::AddTask(const sol::function& func) noexcept
+{
+	if(func.valid()) {
+		newTasks.emplace_back(createTask(func, false));
+	}
+}
+
+void OFS_LuaExtension::UpdateTasks() noexcept
+{
+	if(!Active || !IsLoaded()) return;
+	for(auto& task : newTasks) {
+		tasks.emplace_back(std::move(task));
+	}
+	newTasks.clear();
+
+	for(auto it = tasks.begin(); it != tasks.end() && !OFS_LuaExtensions::TaskBudgetExceeded();) {
+		bool running;
+		{
+			OFS_LuaTimingScope timing(this, it->ScriptChange ? OFS_LuaTiming::ScriptChange : OFS_LuaTiming::Tasks);
+			running = resumeTask(*it);
+		}
+		if(running) {
+			++it;
+		}
+		else {
+			it = tasks.erase(it);
+		}
+	}
+
+	if(!pendingScriptChanges.empty() && !scriptChangeRunning()) {
+		auto change = pendingScriptChanges.front();
+		pendingScriptChanges.erase(pendingScriptChanges.begin());
+		startScriptChange(change.scriptIdx, change.fromTime, change.toTime);
+	}
+}
+
 void OFS_LuaExtension::Execute(const std::string& func) noexcept
 {
-	sol::protected_function bind = L[OFS_LuaExtension::BindingTable][func];
+	if(loading) {
+		// finishLoad runs it
+		LOGF_INFO("Extension \"%s\" is still loading, \"%s\" runs once it's done.", Name.c_str(), func.c_str());
+		pendingBindings.emplace_back(func);
+		return;
+	}
+	if(!ensureLoaded()) return;
+	// Runs until the first yield right away, see ofs.Task for the rest
+	sol::function bind = L[OFS_LuaExtension::BindingTable][func];
 	if(bind.valid()) {
-		auto res = bind();
-		if(res.status() != sol::call_status::ok) {
-			auto err = sol::stack::get_traceback_or_errors(L.lua_state());
-			AddError(err.what());
+		OFS_LuaTimingScope timing(this, OFS_LuaTiming::Execute);
+		auto task = createTask(bind, false);
+		OFS_LuaExtensions::BeginTaskBudget();
+		if(resumeTask(task)) {
+			newTasks.emplace_back(std::move(task));
 		}
 	}
 }
 
-void OFS_LuaExtension::ScriptChanged(uint32_t scriptIdx) noexcept
+void OFS_LuaExtension::startScriptChange(uint32_t scriptIdx, float fromTime, float toTime) noexcept
 {
-	sol::protected_function change = L[OFS_LuaExtension::ScriptChangeFunction];
+	sol::function change = L[OFS_LuaExtension::ScriptChangeFunction];
 	if(change.valid()) {
-		auto res = change(scriptIdx + 1);
-		if(res.status() != sol::call_status::ok) {
-			auto err = sol::stack::get_traceback_or_errors(L.lua_state());
-			AddError(err.what());
+		OFS_LuaTimingScope timing(this, OFS_LuaTiming::ScriptChange);
+		auto task = createTask(change, true);
+		// the whole script changed when toTime is FLT_MAX
+		double to = toTime == std::numeric_limits<float>::max() ? HUGE_VAL : (double)toTime;
+		if(resumeTask(task, scriptIdx + 1, (double)fromTime, to)) {
+			newTasks.emplace_back(std::move(task));
+		}
+	}
+}
+
+void OFS_LuaExtension::ScriptChanged(uint32_t scriptIdx, float fromTime, float toTime) noexcept
+{
+	// deferred extensions don't have a scriptChange function
+	if(!IsLoaded()) return;
+	if(scriptChangeRunning()) {
+		auto it = std::find_if(pendingScriptChanges.begin(), pendingScriptChanges.end(),
+			[scriptIdx](auto& change) noexcept { return change.scriptIdx == scriptIdx; });
+		if(it != pendingScriptChanges.end()) {
+			it->fromTime = std::min(it->fromTime, fromTime);
+			it->toTime = std::max(it->toTime, toTime);
 		}
+		else {
+			pendingScriptChanges.push_back({ scriptIdx, fromTime, toTime });
+		}
+		return;
 	}
+	OFS_LuaExtensions::BeginTaskBudget();
+	startScriptChange(scriptIdx, fromTime, toTime);
 }
 
 void OFS_LuaExtension::Shutdown() noexcept
@@ -213,6 +655,13 @@ void OFS_LuaExtension::Shutdown() noexcept
 	// MaxUpdateTime = 0.f;
 	// MaxGuiTime = 0.f;
 	// Bindables.clear();
-	L = sol::state();
+	clearTasks();
+	// drops loads which are still running
+	loadGeneration += 1;
+	loading = false;
+	deferred = false;
+	pendingBindings.clear();
+	releaseApi();
+	L = createState();
 	Active = false;
 }
\ No newline at end of file
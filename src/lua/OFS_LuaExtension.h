@@ -4,17 +4,150 @@
 #include "OFS_LuaExtensionAPI.h"
 #include "OFS_Util.h"
 
+#include <array>
 #include <memory>
+#include <vector>
+
+// Allocations made by a lua state.
+// These are kept in a registry so the pointer handed to the lua allocator
+// stays valid while the extension gets moved around or reloaded.
+struct OFS_LuaMemoryStats
+{
+	size_t Allocated = 0;
+	size_t Peak = 0;
+	// 0 means unlimited, allocations which would exceed it fail with a lua memory error
+	// inside of protected calls, anywhere else they go through and only set LimitExceeded
+	size_t Limit = 0;
+	bool LimitExceeded = false;
+	uint32_t ProtectedCalls = 0;
+};
+
+// Marks a protected call into a lua state, only numbers may be pushed while it exists.
+// Outside of protected calls a failed allocation ends up in the panic handler and aborts.
+class OFS_LuaProtectedScope
+{
+	private:
+		OFS_LuaMemoryStats* stats;
+	public:
+		inline explicit OFS_LuaProtectedScope(lua_State* L) noexcept
+		{
+			void* ud = nullptr;
+			lua_getallocf(L, &ud);
+			stats = static_cast<OFS_LuaMemoryStats*>(ud);
+			stats->ProtectedCalls += 1;
+		}
+		inline ~OFS_LuaProtectedScope() noexcept { stats->ProtectedCalls -= 1; }
+};
+
+// Runs call() in a OFS_LuaProtectedScope, handling its result has to happen outside of it.
+template<typename Fn>
+inline auto OFS_LuaProtectedCall(lua_State* L, Fn&& call) noexcept
+{
+	OFS_LuaProtectedScope protect(L);
+	return call();
+}
+
+// Durations of the calls into one extension entry point.
+// Bucket i counts calls up to FirstBucketMs * 2^i, the last one everything above.
+struct OFS_LuaTiming
+{
+	enum Type : uint8_t
+	{
+		Update,
+		Gui,
+		ScriptChange,
+		Execute,
+		Tasks,
+		TypeCount
+	};
+	static constexpr uint32_t BucketCount = 12;
+	static constexpr float FirstBucketMs = 1.f / 64.f;
+
+	uint32_t Buckets[BucketCount] = {};
+	uint64_t Count = 0;
+	double TotalMs = 0.0;
+	float MaxMs = 0.f;
+
+	void Add(float ms) noexcept;
+	// upper bound of the bucket containing the percentile
+	float Percentile(float p) const noexcept;
+	inline float AverageMs() const noexcept { return Count > 0 ? (float)(TotalMs / Count) : 0.f; }
+	static inline float BucketLimitMs(uint32_t bucket) noexcept { return FirstBucketMs * (float)(1u << bucket); }
+	static const char* TypeName(Type type) noexcept;
+};
+
+// A coroutine started by ofs.Task, a binding or scriptChange.
+// It gets resumed every frame until it returns, all tasks share OFS_LuaExtensions::TaskBudgetMs.
+struct OFS_LuaTask
+{
+	sol::thread Thread;
+	sol::coroutine Coroutine;
+	bool ScriptChange = false;
+};
+
+// Created by OFS_LuaExtension::prepareState, which can run on a worker thread.
+struct OFS_LuaPreparedState
+{
+	std::unique_ptr<OFS_LuaMemoryStats> Stats;
+	sol::state L;
+	// the compiled main.lua
+	sol::protected_function Chunk;
+	std::string Error;
+};
 
 class OFS_LuaExtension
 {
 	private:
 		sol::state L;
 		std::unique_ptr<OFS_ExtensionAPI> api = nullptr;
+		OFS_LuaMemoryStats* memory = nullptr;
+
+		std::vector<OFS_LuaTask> tasks;
+		// tasks started while other tasks are being resumed
+		std::vector<OFS_LuaTask> newTasks;
+		// scriptChange isn't started again while it's still running, the changes get queued
+		struct PendingScriptChange
+		{
+			uint32_t scriptIdx;
+			float fromTime;
+			float toTime;
+		};
+		std::vector<PendingScriptChange> pendingScriptChanges;
+
+		// a newer load makes running ones obsolete
+		uint32_t loadGeneration = 0;
+		bool loading = false;
+		// only the bindings are registered, see LoadDeferred
+		bool deferred = false;
+		// bindings used while loading, they run once the load succeeded
+		std::vector<std::string> pendingBindings;
+
+		sol::state createState() noexcept;
+		static bool prepareState(const std::string& extensionDir, int memoryLimitMB, OFS_LuaPreparedState& prepared) noexcept;
+		bool finishLoad(OFS_LuaPreparedState& prepared) noexcept;
+		bool ensureLoaded() noexcept;
+		OFS_LuaTask createTask(const sol::function& func, bool scriptChange) noexcept;
+		template<typename... Args>
+		bool resumeTask(OFS_LuaTask& task, Args&&... args) noexcept;
+		bool scriptChangeRunning() const noexcept;
+		void startScriptChange(uint32_t scriptIdx, float fromTime, float toTime) noexcept;
+		void clearTasks() noexcept;
+		// stops the processes started by the extension, has to run before L gets replaced
+		void releaseApi() noexcept;
+
+		std::array<OFS_LuaTiming, OFS_LuaTiming::TypeCount> timings;
+		// time spent in this extension since the last EndFrame
+		float frameMs = 0.f;
+		float lastFrameMs = 0.f;
+		uint32_t framesOverBudget = 0;
+		void addTiming(OFS_LuaTiming::Type type, uint64_t startTicks) noexcept;
+		friend class OFS_LuaTimingScope;
     public:
 		static constexpr const char* MainFile = "main.lua";
 		static constexpr const char* BindingTable = "binding";
 		static constexpr const char* ScriptChangeFunction = "scriptChange";
+		// Tasks check the budget every this many instructions, even if they never call checkpoint()
+		static constexpr int TaskHookInstructions = 10000;
 
 		std::string Name;
 		std::string NameId;
@@ -22,9 +155,21 @@ class OFS_LuaExtension
 		std::string Error;
 		bool Active = false;
 		bool WindowOpen = false;
+		// 0 means unlimited
+		int MemoryLimitMB = 0;
+		// Set when the extension only provided bindings the last time it was loaded
+		bool Lazy = false;
+		std::vector<std::string> LazyBindings;
 
 		inline bool HasError() const noexcept { return !Error.empty(); }
+		inline bool IsLoaded() const noexcept { return !loading && !deferred; }
+		inline bool IsLoading() const noexcept { return loading; }
+		inline bool IsDeferred() const noexcept { return deferred; }
 		bool Load() noexcept;
+		// Prepares the state and compiles main.lua on a worker thread, the rest happens on the main thread
+		void LoadAsync() noexcept;
+		// Only registers the bindings remembered from the last load, the extension gets loaded on first use
+		bool LoadDeferred() noexcept;
 		
 		void AddError(const char* str) noexcept {
 			LOG_ERROR(str);
@@ -37,9 +182,26 @@ class OFS_LuaExtension
 		void Update() noexcept;
 		void Shutdown() noexcept;
 		void Toggle() noexcept;
-		void ScriptChanged(uint32_t scriptIdx) noexcept;
+		void ScriptChanged(uint32_t scriptIdx, float fromTime, float toTime) noexcept;
+
+		void AddTask(const sol::function& func) noexcept;
+		void UpdateTasks() noexcept;
+		inline size_t TaskCount() const noexcept { return tasks.size() + newTasks.size(); }
+		// Tasks or process callbacks which only make progress in frames that get drawn
+		bool HasPendingWork() const noexcept;
 
 		void Execute(const std::string& function) noexcept;
+
+		inline size_t MemoryUsage() const noexcept { return memory ? memory->Allocated : 0; }
+		inline size_t PeakMemoryUsage() const noexcept { return memory ? memory->Peak : 0; }
+		static size_t TotalMemoryUsage() noexcept;
+		void SetMemoryLimit(int limitMB) noexcept;
+
+		inline const OFS_LuaTiming& Timing(OFS_LuaTiming::Type type) const noexcept { return timings[type]; }
+		inline float LastFrameMs() const noexcept { return lastFrameMs; }
+		void ResetStats() noexcept;
+		// Checks the budgets of the frame which just ended, returns false if the extension got disabled
+		bool EndFrame(float frameBudgetMs, uint32_t maxFramesOverBudget, bool autoDisable) noexcept;
 };
 
 REFL_TYPE(OFS_LuaExtension)
@@ -48,4 +210,7 @@ REFL_TYPE(OFS_LuaExtension)
 	REFL_FIELD(Directory)
 	REFL_FIELD(Active)
 	REFL_FIELD(WindowOpen)
+	REFL_FIELD(MemoryLimitMB)
+	REFL_FIELD(Lazy)
+	REFL_FIELD(LazyBindings)
 REFL_END
\ No newline at end of file
@@ -9,7 +9,58 @@ binding = {}
 function clamp(val, min, max)
 	return math.min(max, math.max(val, min))
 end
+function checkpoint()
+	if coroutine.isyieldable() and ofs.TaskBudgetExceeded() then
+		coroutine.yield()
+	end
+end
+)";
+
+#ifdef OFS_LUAJIT
+// LuaJIT implements Lua 5.1, ipairs and pairs don't respect metamethods on userdata.
+// The FFI views give direct access to the actions without going through sol.
+constexpr const char* LuaJITFunctions = R"(
+local ffi = require("ffi")
+ffi.cdef[[
+typedef struct { float at; int16_t pos; uint8_t flags; uint8_t tag; bool selected; } ofs_script_action;
+]]
+
+local rawIpairs = ipairs
+local rawPairs = pairs
+local function userdataIter(t)
+	local i = 0
+	return function()
+		i = i + 1
+		local v = t[i]
+		if v ~= nil then return i, v end
+	end
+end
+function ipairs(t)
+	if type(t) == "userdata" then return userdataIter(t) end
+	return rawIpairs(t)
+end
+function pairs(t)
+	if type(t) == "userdata" then return userdataIter(t) end
+	return rawPairs(t)
+end
+
+if not coroutine.isyieldable then
+	function coroutine.isyieldable()
+		local _, isMain = coroutine.running()
+		return coroutine.running() ~= nil and not isMain
+	end
+end
+
+-- The pointer doesn't keep the script alive, the script is kept as long as the pointer is.
+local viewOwners = setmetatable({}, { __mode = "k" })
+function actionView(script)
+	local ptr, count = script:actionBuffer()
+	local view = ffi.cast("ofs_script_action*", ptr)
+	viewOwners[view] = script
+	return view, count
+end
 )";
+#endif
 
 static int LuaPrint(sol::variadic_args va) noexcept
 {
@@ -46,6 +97,10 @@ OFS_ExtensionAPI::OFS_ExtensionAPI(sol::usertype<class OFS_ExtensionAPI>& ofs) n
 
     int status = luaL_dostring(L, LuaDefaultFunctions);
 	FUN_ASSERT(status == 0, "defaults failed");
+#ifdef OFS_LUAJIT
+	status = luaL_dostring(L, LuaJITFunctions);
+	FUN_ASSERT(status == 0, "LuaJIT defaults failed");
+#endif
 }
 
 OFS_ExtensionAPI::~OFS_ExtensionAPI() noexcept
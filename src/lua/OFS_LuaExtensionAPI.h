@@ -13,7 +13,8 @@ class OFS_ExtensionAPI
     public: 
     static constexpr const char* DefaultNamespace = "ofs";
     static constexpr const char* PlayerNamespace = "player";
-    static constexpr uint32_t VersionAPI = 1;
+    // see the API changes in LuaDox/intro.md
+    static constexpr uint32_t VersionAPI = 2;
 
     std::unique_ptr<OFS_ImGuiAPI> guiAPI;
     std::unique_ptr<OFS_ProcessAPI> procAPI;
@@ -4,8 +4,20 @@
 #include "OFS_Profiling.h"
 #include "OFS_LuaCoreExtension.h"
 
+#include "SDL_timer.h"
+
+#include <cfloat>
+#include <string>
+#include <algorithm>
+
 bool OFS_LuaExtensions::DevMode = false;
 bool OFS_LuaExtensions::ShowLogs = false;
+float OFS_LuaExtensions::TaskBudgetMs = 4.f;
+uint64_t OFS_LuaExtensions::taskDeadline = 0;
+bool OFS_LuaExtensions::ShowStats = false;
+bool OFS_LuaExtensions::AutoDisable = false;
+float OFS_LuaExtensions::FrameBudgetMs = 50.f;
+int OFS_LuaExtensions::MaxFramesOverBudget = 30;
 
 OFS::AppLog OFS_LuaExtensions::ExtensionLogBuffer;
 
@@ -34,8 +46,11 @@ OFS_LuaExtensions::~OFS_LuaExtensions() noexcept
 
 bool OFS_LuaExtensions::Init() noexcept
 {
+	// every extension has its own state, they get compiled in parallel
 	for (auto& ext : Extensions) {
-		if (ext.Active) ext.Load();
+		if (ext.Active && !ext.LoadDeferred()) {
+			ext.LoadAsync();
+		}
 	}
 	return true;
 }
@@ -52,14 +67,20 @@ void OFS_LuaExtensions::load(const std::string& path) noexcept
 	}
 }
 
-void OFS_LuaExtensions::ScriptChanged(uint32_t scriptIdx) noexcept
+void OFS_LuaExtensions::ScriptChanged(uint32_t scriptIdx, float fromTime, float toTime) noexcept
 {
 	for(auto& ext : Extensions)	{
 		if(!ext.Active) continue;
-		ext.ScriptChanged(scriptIdx);
+		ext.ScriptChanged(scriptIdx, fromTime, toTime);
 	}
 }
 
+bool OFS_LuaExtensions::HasPendingWork() const noexcept
+{
+	return std::any_of(Extensions.begin(), Extensions.end(),
+		[](auto& ext) noexcept { return ext.HasPendingWork(); });
+}
+
 void OFS_LuaExtensions::save() noexcept
 {
 	nlohmann::json json;
@@ -105,25 +126,133 @@ void OFS_LuaExtensions::UpdateExtensionList() noexcept
 
 void OFS_LuaExtensions::Update(float delta) noexcept
 {
+	// the gui and script changes of the last frame ran after the last update
+	uint32_t maxFrames = (uint32_t)std::max(MaxFramesOverBudget, 1);
+	for(auto& ext : Extensions) {
+		if(!ext.EndFrame(FrameBudgetMs, maxFrames, AutoDisable)) {
+			Util::MessageBoxAlert(TR(EXTENSION_DISABLED), ext.Error);
+		}
+	}
+
 	for(auto& ext : Extensions) {
 		ext.Update();
 	}
+
+	OFS_PROFILE("OFS_LuaExtensions::UpdateTasks");
+	BeginTaskBudget();
+	size_t count = Extensions.size();
+	for(size_t i = 0; i < count && !TaskBudgetExceeded(); i += 1) {
+		Extensions[(nextTaskExtension + i) % count].UpdateTasks();
+	}
+	nextTaskExtension = count > 0 ? (nextTaskExtension + 1) % count : 0;
+}
+
+void OFS_LuaExtensions::BeginTaskBudget() noexcept
+{
+	float budgetMs = Util::Clamp(TaskBudgetMs, 1.f, 100.f);
+	taskDeadline = SDL_GetPerformanceCounter() + (uint64_t)(budgetMs / 1000.f * SDL_GetPerformanceFrequency());
+}
+
+bool OFS_LuaExtensions::TaskBudgetExceeded() noexcept
+{
+	return SDL_GetPerformanceCounter() >= taskDeadline;
 }
 
 void OFS_LuaExtensions::ShowExtensions() noexcept
 {
     OFS_PROFILE(__FUNCTION__);
 	ShowExtensionLogWindow(&OFS_LuaExtensions::ShowLogs);
+	showStatsWindow(&OFS_LuaExtensions::ShowStats);
 	for(auto& ext : Extensions) {
 		ext.ShowWindow();
 	}
 }
 
+void OFS_LuaExtensions::showStatsWindow(bool* open) noexcept
+{
+	if(!*open) return;
+	ImGui::Begin(TR_ID("EXTENSION_STATS", Tr::EXTENSION_STATS), open, ImGuiWindowFlags_None);
+
+	ImGui::Checkbox(TR(EXTENSION_AUTO_DISABLE), &AutoDisable);
+	OFS::Tooltip(TR(EXTENSION_AUTO_DISABLE_TOOLTIP));
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 8.f);
+	ImGui::SliderFloat(TR(EXTENSION_FRAME_BUDGET), &FrameBudgetMs, 1.f, 500.f, "%.0f ms", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+	ImGui::SetNextItemWidth(ImGui::GetFontSize() * 8.f);
+	ImGui::SliderInt(TR(EXTENSION_FRAMES_OVER_BUDGET), &MaxFramesOverBudget, 1, 300, "%d", ImGuiSliderFlags_AlwaysClamp);
+	ImGui::Separator();
+
+	for(auto& ext : Extensions) {
+		if(!ext.Active && ext.Timing(OFS_LuaTiming::Update).Count == 0) continue;
+		ImGui::PushID(ext.NameId.c_str());
+		// FormatBytes returns a shared buffer
+		std::string current = Util::FormatBytes(ext.MemoryUsage());
+		if(ImGui::CollapsingHeader(Util::Format("%s - %.2f ms %s###header", ext.Name.c_str(), ext.LastFrameMs(), current.c_str()))) {
+			if(!ext.Active) {
+				ImGui::TextDisabled("%s", TR(EXTENSION_INACTIVE));
+			}
+			if(ext.HasError()) {
+				ImGui::TextWrapped("%s", ext.Error.c_str());
+			}
+			ImGui::Text("%s: %s / %s %s", TR(MEMORY_USAGE), current.c_str(), TR(MEMORY_PEAK), Util::FormatBytes(ext.PeakMemoryUsage()));
+			int limitMB = ext.MemoryLimitMB;
+			ImGui::SetNextItemWidth(ImGui::GetFontSize() * 8.f);
+			if(ImGui::InputInt(TR(EXTENSION_MEMORY_LIMIT), &limitMB, 16, 128)) {
+				ext.SetMemoryLimit(limitMB);
+			}
+			OFS::Tooltip(TR(EXTENSION_MEMORY_LIMIT_TOOLTIP));
+
+			if(ImGui::BeginTable("##timings", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+				ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthStretch);
+				ImGui::TableSetupColumn(TR(EXTENSION_CALLS));
+				ImGui::TableSetupColumn("avg");
+				ImGui::TableSetupColumn("p50");
+				ImGui::TableSetupColumn("p99");
+				ImGui::TableSetupColumn("max");
+				ImGui::TableHeadersRow();
+				for(uint8_t i = 0; i < OFS_LuaTiming::TypeCount; i += 1) {
+					auto type = (OFS_LuaTiming::Type)i;
+					auto& timing = ext.Timing(type);
+					if(timing.Count == 0) continue;
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(OFS_LuaTiming::TypeName(type));
+					if(ImGui::IsItemHovered()) {
+						// call count per bucket
+						ImGui::BeginTooltip();
+						ImGui::PlotHistogram("##histogram",
+							[](void* data, int idx) noexcept { return (float)((const OFS_LuaTiming*)data)->Buckets[idx]; },
+							(void*)&timing, OFS_LuaTiming::BucketCount, 0,
+							Util::Format("%.3f ms - %.0f ms", OFS_LuaTiming::FirstBucketMs, OFS_LuaTiming::BucketLimitMs(OFS_LuaTiming::BucketCount - 2)),
+							0.f, FLT_MAX, ImVec2(ImGui::GetFontSize() * 15.f, ImGui::GetFontSize() * 4.f));
+						ImGui::EndTooltip();
+					}
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu", (unsigned long long)timing.Count);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", timing.AverageMs());
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", timing.Percentile(.5f));
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", timing.Percentile(.99f));
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", timing.MaxMs);
+				}
+				ImGui::EndTable();
+			}
+			if(ImGui::Button(TR(RESET), ImVec2(-1.f, 0.f))) {
+				ext.ResetStats();
+			}
+		}
+		ImGui::PopID();
+	}
+	ImGui::End();
+}
+
 void OFS_LuaExtensions::ReloadEnabledExtensions() noexcept
 {
     for(auto& ext : Extensions) {
 		if(ext.Active) {
-			ext.Load();
+			ext.LoadAsync();
 		}
 	}
 }
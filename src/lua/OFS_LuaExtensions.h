@@ -24,11 +24,23 @@ class OFS_LuaExtensions
         void save() noexcept;
         void removeNonExisting() noexcept;
         std::unordered_map<std::string, OFS_LuaBinding> Bindings;
+        // extension which gets to resume its tasks first, rotates every frame
+        size_t nextTaskExtension = 0;
+        static uint64_t taskDeadline;
+        void showStatsWindow(bool* open) noexcept;
     public:
         static constexpr const char* ExtensionDir = "extensions";
         static constexpr const char* DynamicBindingHandler = "OFS_LuaExtensions";
         static bool DevMode;
         static bool ShowLogs;
+        // Time all extension tasks get per frame
+        static float TaskBudgetMs;
+        static bool ShowStats;
+        // Extensions which spend more than FrameBudgetMs in MaxFramesOverBudget frames in a row
+        // or exceed their memory limit get disabled
+        static bool AutoDisable;
+        static float FrameBudgetMs;
+        static int MaxFramesOverBudget;
         static OFS::AppLog ExtensionLogBuffer;
         std::vector<OFS_LuaExtension> Extensions;
 
@@ -53,8 +65,12 @@ class OFS_LuaExtensions
         void Update(float delta) noexcept;
         void ShowExtensions() noexcept;
         void ReloadEnabledExtensions() noexcept;
-        void ScriptChanged(uint32_t scriptIdx) noexcept;
+        void ScriptChanged(uint32_t scriptIdx, float fromTime, float toTime) noexcept;
+        bool HasPendingWork() const noexcept;
         
+        static void BeginTaskBudget() noexcept;
+        static bool TaskBudgetExceeded() noexcept;
+
         void AddBinding(const std::string& extId, const std::string& uniqueId, const std::string& name) noexcept;
 };
 
@@ -62,4 +78,9 @@ REFL_TYPE(OFS_LuaExtensions)
     REFL_FIELD(Extensions)
     REFL_FIELD(DevMode)
     REFL_FIELD(ShowLogs)
+    REFL_FIELD(TaskBudgetMs)
+    REFL_FIELD(ShowStats)
+    REFL_FIELD(AutoDisable)
+    REFL_FIELD(FrameBudgetMs)
+    REFL_FIELD(MaxFramesOverBudget)
 REFL_END
\ No newline at end of file
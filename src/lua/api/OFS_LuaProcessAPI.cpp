@@ -1,23 +1,272 @@
 #include "OFS_LuaProcessAPI.h"
 #include "OFS_LuaExtensionAPI.h"
+#include "OFS_LuaExtension.h"
+
+#include "SDL_timer.h"
+
+#include <algorithm>
 
 OFS_ProcessAPI::~OFS_ProcessAPI() noexcept
 {
-
+    Shutdown();
 }
 
 OFS_ProcessAPI::OFS_ProcessAPI(sol::usertype<OFS_ExtensionAPI>& ofs) noexcept
 {
     sol::state_view Lua(ofs.lua_state());
-    auto process = Lua.new_usertype<OFS_LuaProcess>("Process", 
+    auto process = Lua.new_usertype<OFS_LuaProcess>("Process",
         sol::factories<>(OFS_LuaProcess::CreateProcess));
     process["alive"] = &OFS_LuaProcess::IsAlive;
     process["join"] = &OFS_LuaProcess::Join;
     process["detach"] = &OFS_LuaProcess::Detach;
     process["kill"] = &OFS_LuaProcess::Shutdown;
+    process["start"] = [this](const char* program, sol::optional<sol::table> args, sol::optional<sol::table> callbacks) noexcept {
+        auto proc = OFS_LuaProcess::StartProcess(program, args, callbacks);
+        if(proc) watched.emplace_back(proc);
+        return proc;
+    };
+    process["onExit"] = [this](std::shared_ptr<OFS_LuaProcess> proc, sol::protected_function callback) noexcept {
+        proc->SetExitCallback(std::move(callback));
+        if(std::find(watched.begin(), watched.end(), proc) == watched.end()) {
+            watched.emplace_back(std::move(proc));
+        }
+    };
+}
+
+bool OFS_ProcessAPI::Dispatch() noexcept
+{
+    bool valid = true;
+    // callbacks may start new processes
+    for(size_t i = 0; i < watched.size();) {
+        auto proc = watched[i];
+        std::string error;
+        bool finished = proc->Dispatch(error);
+        if(!error.empty()) {
+            ErrorStr = std::move(error);
+            valid = false;
+        }
+        if(finished) {
+            auto it = std::find(watched.begin(), watched.end(), proc);
+            if(it != watched.end()) watched.erase(it);
+        }
+        else {
+            i += 1;
+        }
+    }
+    return valid;
+}
+
+void OFS_ProcessAPI::Shutdown() noexcept
+{
+    for(auto& proc : watched) {
+        proc->Shutdown();
+        proc->JoinReaders(ShutdownReaderTimeoutMs);
+        proc->Detach();
+    }
+    watched.clear();
+}
+
+std::string OFS_LuaProcessPipe::Take(bool* finished) noexcept
+{
+    // done has to be read first, anything read before it got set is in pending
+    *finished = done.load(std::memory_order_acquire);
+    std::string chunk;
+    SDL_LockMutex(lock);
+    chunk.swap(pending);
+    SDL_UnlockMutex(lock);
+    return chunk;
+}
+
+struct ReaderThreadData
+{
+    std::shared_ptr<OFS_LuaProcessState> state;
+    bool stderrPipe;
+};
+
+int OFS_LuaProcess::readerThread(void* data) noexcept
+{
+    auto reader = static_cast<ReaderThreadData*>(data);
+    auto& state = *reader->state;
+    auto& pipe = reader->stderrPipe ? state.stderrPipe : state.stdoutPipe;
+    char buffer[4096];
+    for(;;) {
+        // blocks until there's output, 0 means the pipe was closed
+        unsigned bytes = reader->stderrPipe
+            ? subprocess_read_stderr(&state.proc, buffer, sizeof(buffer))
+            : subprocess_read_stdout(&state.proc, buffer, sizeof(buffer));
+        if(bytes == 0) break;
+        SDL_LockMutex(pipe.lock);
+        pipe.pending.append(buffer, bytes);
+        SDL_UnlockMutex(pipe.lock);
+    }
+    pipe.done.store(true, std::memory_order_release);
+    delete reader;
+    return 0;
+}
+
+OFS_LuaProcess::OFS_LuaProcess(const subprocess_s& p, bool streaming) noexcept
+    : state(std::make_shared<OFS_LuaProcessState>()), active(true), streaming(streaming)
+{
+    state->proc = p;
+    auto& proc = state->proc;
+    if(!streaming) {
+        if(proc.stdout_file)
+        {
+            fclose(proc.stdout_file);
+            proc.stdout_file = nullptr;
+        }
+        if(proc.stderr_file)
+        {
+            fclose(proc.stderr_file);
+            proc.stderr_file = nullptr;
+        }
+        return;
+    }
+
+    auto startReader = [this](bool stderrPipe) noexcept {
+        auto& pipe = stderrPipe ? state->stderrPipe : state->stdoutPipe;
+        pipe.done = false;
+        auto data = new ReaderThreadData{ state, stderrPipe };
+        auto thread = SDL_CreateThread(readerThread, stderrPipe ? "LuaProcessStderr" : "LuaProcessStdout", data);
+        if(thread) {
+            readers[stderrPipe ? 1 : 0] = thread;
+        }
+        else {
+            pipe.done = true;
+            delete data;
+        }
+    };
+    startReader(false);
+    startReader(true);
+}
+
+OFS_LuaProcess::~OFS_LuaProcess() noexcept
+{
+    Shutdown();
+    JoinReaders(0);
+}
+
+void OFS_LuaProcess::JoinReaders(uint32_t timeoutMs) noexcept
+{
+    OFS_LuaProcessPipe* pipes[2] = { &state->stdoutPipe, &state->stderrPipe };
+    auto start = SDL_GetTicks();
+    for(;;) {
+        bool pending = false;
+        for(int i = 0; i < 2; i += 1) {
+            if(readers[i] && !pipes[i]->done.load(std::memory_order_acquire)) pending = true;
+        }
+        if(!pending || SDL_GetTicks() - start >= timeoutMs) break;
+        SDL_Delay(1);
+    }
+    for(int i = 0; i < 2; i += 1) {
+        if(!readers[i]) continue;
+        // a reader blocked on a pipe held open by a child of the process only touches the shared state
+        if(pipes[i]->done.load(std::memory_order_acquire)) {
+            SDL_WaitThread(readers[i], nullptr);
+        }
+        else {
+            SDL_DetachThread(readers[i]);
+        }
+        readers[i] = nullptr;
+    }
 }
 
-std::unique_ptr<OFS_LuaProcess> OFS_LuaProcess::CreateProcess(const char* prog, sol::variadic_args va) noexcept
+void OFS_LuaProcess::Shutdown() noexcept
+{
+    // the state gets destroyed after the readers are done
+    if(active && subprocess_alive(&state->proc)) {
+        subprocess_terminate(&state->proc);
+    }
+}
+
+bool OFS_LuaProcess::IsAlive() noexcept
+{
+    if(active) {
+        return subprocess_alive(&state->proc) > 0;
+    }
+    return false;
+}
+
+lua_Integer OFS_LuaProcess::Join() noexcept
+{
+    int code = -1;
+    if(active) {
+        if(subprocess_join(&state->proc, &code) != 0) {
+            return code;
+        }
+    }
+    return code;
+}
+
+void OFS_LuaProcess::Detach() noexcept
+{
+    // the readers keep draining the pipes until the process closes them
+    active = false;
+    stdoutOutput.callback = sol::lua_nil;
+    stderrOutput.callback = sol::lua_nil;
+    exitCallback = sol::lua_nil;
+}
+
+bool OFS_LuaProcess::deliver(OFS_LuaProcessPipe& pipe, Output& output, std::string& error) noexcept
+{
+    bool finished;
+    auto chunk = pipe.Take(&finished);
+    if(!output.callback.valid()) return finished;
+
+    auto call = [&](const std::string& text) noexcept {
+        // strings allocate when pushed, that has to happen outside of the protected scope
+        auto arg = sol::make_object(output.callback.lua_state(), text);
+        auto res = OFS_LuaProtectedCall(output.callback.lua_state(), [&]() { return output.callback(arg); });
+        if(!res.valid() && error.empty()) {
+            sol::error err = res;
+            error = err.what();
+        }
+    };
+
+    if(!lines) {
+        if(!chunk.empty()) call(chunk);
+        return finished;
+    }
+
+    output.partialLine += chunk;
+    size_t start = 0;
+    for(size_t end = output.partialLine.find('\n'); end != std::string::npos; end = output.partialLine.find('\n', start)) {
+        size_t length = end - start;
+        if(length > 0 && output.partialLine[end - 1] == '\r') length -= 1;
+        call(output.partialLine.substr(start, length));
+        start = end + 1;
+    }
+    output.partialLine.erase(0, start);
+    if(finished && !output.partialLine.empty()) {
+        call(output.partialLine);
+        output.partialLine.clear();
+    }
+    return finished;
+}
+
+bool OFS_LuaProcess::Dispatch(std::string& error) noexcept
+{
+    if(!active) return true;
+    bool finished = true;
+    if(streaming) {
+        finished = deliver(state->stdoutPipe, stdoutOutput, error) && finished;
+        finished = deliver(state->stderrPipe, stderrOutput, error) && finished;
+    }
+    if(!finished || IsAlive()) return false;
+
+    if(exitCallback.valid()) {
+        auto callback = std::move(exitCallback);
+        auto exitCode = Join();
+        auto res = OFS_LuaProtectedCall(callback.lua_state(), [&]() { return callback(exitCode); });
+        if(!res.valid() && error.empty()) {
+            sol::error err = res;
+            error = err.what();
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<OFS_LuaProcess> OFS_LuaProcess::CreateProcess(const char* prog, sol::variadic_args va) noexcept
 {
     const char** args = (const char**)alloca(sizeof(const char*) * (va.size() + 2));
     args[0] = prog;
@@ -34,8 +283,42 @@ std::unique_ptr<OFS_LuaProcess> OFS_LuaProcess::CreateProcess(const char* prog,
     struct subprocess_s p{0};
     bool succ = subprocess_create(args, subprocess_option_inherit_environment | subprocess_option_no_window, &p) == 0;
     if(succ) {
-        auto process = std::make_unique<OFS_LuaProcess>(p);
-        return std::move(process);
+        return std::make_shared<OFS_LuaProcess>(p, false);
     }
     return nullptr;
-}
\ No newline at end of file
+}
+
+std::shared_ptr<OFS_LuaProcess> OFS_LuaProcess::StartProcess(const char* prog, sol::optional<sol::table> args, sol::optional<sol::table> callbacks) noexcept
+{
+    std::vector<std::string> argStrings;
+    if(args) {
+        for(size_t i = 1, size = args->size(); i <= size; i += 1) {
+            sol::optional<std::string> arg = (*args)[i];
+            if(!arg) {
+                luaL_error(args->lua_state(), "Provided argument can't be turned into a string.");
+                return nullptr;
+            }
+            argStrings.emplace_back(std::move(*arg));
+        }
+    }
+    std::vector<const char*> argv;
+    argv.reserve(argStrings.size() + 2);
+    argv.emplace_back(prog);
+    for(auto& arg : argStrings) argv.emplace_back(arg.c_str());
+    argv.emplace_back(nullptr);
+
+    // async is required to read while the process is running
+    struct subprocess_s p{0};
+    bool succ = subprocess_create(argv.data(), subprocess_option_inherit_environment | subprocess_option_no_window | subprocess_option_enable_async, &p) == 0;
+    if(!succ) return nullptr;
+
+    auto process = std::make_shared<OFS_LuaProcess>(p, true);
+    if(callbacks) {
+        auto& table = *callbacks;
+        process->stdoutOutput.callback = table.get_or<sol::protected_function>("stdout", sol::lua_nil);
+        process->stderrOutput.callback = table.get_or<sol::protected_function>("stderr", sol::lua_nil);
+        process->exitCallback = table.get_or<sol::protected_function>("exit", sol::lua_nil);
+        process->lines = table.get_or("lines", true);
+    }
+    return process;
+}
@@ -1,79 +1,101 @@
 #pragma once
 #include "OFS_Lua.h"
 #include "subprocess.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
 #include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+
+// Output of one pipe, filled by a reader thread.
+struct OFS_LuaProcessPipe
+{
+	SDL_mutex* lock = nullptr;
+	// guarded by lock
+	std::string pending;
+	// set after the last read, everything is in pending at that point
+	std::atomic<bool> done = true;
+
+	OFS_LuaProcessPipe() noexcept { lock = SDL_CreateMutex(); }
+	~OFS_LuaProcessPipe() noexcept { SDL_DestroyMutex(lock); }
+
+	// returns everything read so far, the result is final if finished gets set
+	std::string Take(bool* finished) noexcept;
+};
+
+// Shared with the reader threads so a killed process whose pipes are
+// still held open by its children doesn't block the main thread.
+struct OFS_LuaProcessState
+{
+	struct subprocess_s proc = {0};
+	OFS_LuaProcessPipe stdoutPipe;
+	OFS_LuaProcessPipe stderrPipe;
+
+	~OFS_LuaProcessState() noexcept { subprocess_destroy(&proc); }
+};
 
 class OFS_LuaProcess
 {
     private:
-	struct subprocess_s proc = {0};
+	std::shared_ptr<OFS_LuaProcessState> state;
 	bool active = false;
+	bool streaming = false;
 
-	public:
-	
-	OFS_LuaProcess(subprocess_s p) noexcept
-		: proc(p), active(true) 
-	{
-        if(proc.stdout_file) 
-        {
-            fclose(proc.stdout_file);
-            proc.stdout_file = nullptr;
-        }
-        if(proc.stderr_file)
-        {
-            fclose(proc.stderr_file);
-            proc.stderr_file = nullptr;
-        }
-	}
-
-    ~OFS_LuaProcess() noexcept
-    {
-        Shutdown();
-    }
-
-	static std::unique_ptr<OFS_LuaProcess> CreateProcess(const char* program, sol::variadic_args va) noexcept;
-
-	inline void Shutdown() noexcept
+	// only used on the main thread
+	struct Output
 	{
-		if(active) {
-			if(subprocess_alive(&proc)) {
-				subprocess_terminate(&proc);
-			}
-			subprocess_destroy(&proc);
-		}
-	}
-
-	inline bool IsAlive() noexcept
-	{
-		if(active) {
-			return subprocess_alive(&proc) > 0;
-		}
-		return false;
-	}
+		sol::protected_function callback;
+		std::string partialLine;
+	};
+	Output stdoutOutput;
+	Output stderrOutput;
+	sol::protected_function exitCallback;
+	bool lines = true;
+	// joined on shutdown, detached if the pipes stay open
+	SDL_Thread* readers[2] = { nullptr, nullptr };
 
-	inline lua_Integer Join() noexcept
-	{
-		int code = -1;
-		if(active) {
-			if(subprocess_join(&proc, &code) != 0) {
-            	return code;
-        	}
-		}
-		return code;
-	}
-
-	inline void Detach() noexcept
-	{
-		if(active) {
-			subprocess_destroy(&proc);
-			active = false;
-		}
-	}
+	static int readerThread(void* data) noexcept;
+	bool deliver(OFS_LuaProcessPipe& pipe, Output& output, std::string& error) noexcept;
+
+	public:
+	OFS_LuaProcess(const subprocess_s& p, bool streaming) noexcept;
+    ~OFS_LuaProcess() noexcept;
+
+	static std::shared_ptr<OFS_LuaProcess> CreateProcess(const char* program, sol::variadic_args va) noexcept;
+	static std::shared_ptr<OFS_LuaProcess> StartProcess(const char* program, sol::optional<sol::table> args, sol::optional<sol::table> callbacks) noexcept;
+
+	void Shutdown() noexcept;
+	bool IsAlive() noexcept;
+	lua_Integer Join() noexcept;
+	void Detach() noexcept;
+	// Waits up to timeoutMs for the pipes to close, readers which didn't finish in time get detached.
+	void JoinReaders(uint32_t timeoutMs) noexcept;
+
+	inline void SetExitCallback(sol::protected_function callback) noexcept { exitCallback = std::move(callback); }
+	// Hands the output read since the last call to the callbacks and calls the exit callback.
+	// Returns true once the process exited and all callbacks ran.
+	bool Dispatch(std::string& error) noexcept;
 };
 
 class OFS_ProcessAPI
 {
+    private:
+    // processes with callbacks are kept alive until they exited and all callbacks ran
+    std::vector<std::shared_ptr<OFS_LuaProcess>> watched;
+    std::string ErrorStr;
+
     public:
+    static constexpr uint32_t ShutdownReaderTimeoutMs = 500;
+
     OFS_ProcessAPI(sol::usertype<class OFS_ExtensionAPI>& ofs) noexcept;
     ~OFS_ProcessAPI() noexcept;
-};
\ No newline at end of file
+
+    // Runs the process callbacks on the main thread, returns false if one of them failed
+    bool Dispatch() noexcept;
+    // Kills the watched processes and drops their callbacks,
+    // has to be called before the lua_State they reference is closed.
+    void Shutdown() noexcept;
+    const std::string& Error() const noexcept { return ErrorStr; }
+    inline bool IsWatching() const noexcept { return !watched.empty(); }
+};
@@ -4,6 +4,30 @@
 OFS_ScriptAPI::OFS_ScriptAPI(sol::usertype<class OFS_ExtensionAPI>& ofs) noexcept
 {
     auto L = sol::state_view(ofs.lua_state());
+    auto actions = L.new_usertype<LuaFunscriptActions>("FunscriptActions", sol::no_constructor);
+    actions["add"] = sol::overload(&LuaFunscriptActions::Add,
+        [](LuaFunscriptActions& self, const LuaFunscriptActionRef& action) noexcept { self.Add(action.Value()); });
+    actions["insert"] = sol::overload(&LuaFunscriptActions::Insert,
+        [](LuaFunscriptActions& self, lua_Integer idx, const LuaFunscriptActionRef& action, sol::this_state L) noexcept { self.Insert(idx, action.Value(), L); });
+    actions["erase"] = &LuaFunscriptActions::Erase;
+    actions["clear"] = &LuaFunscriptActions::Clear;
+    actions["empty"] = &LuaFunscriptActions::Empty;
+    actions["size"] = &LuaFunscriptActions::Size;
+    actions[sol::meta_function::index] = &LuaFunscriptActions::Index;
+    actions[sol::meta_function::new_index] = sol::overload(&LuaFunscriptActions::NewIndex,
+        [](LuaFunscriptActions& self, lua_Integer idx, const LuaFunscriptActionRef& action, sol::this_state L) noexcept { self.NewIndex(idx, action.Value(), L); });
+    actions[sol::meta_function::length] = &LuaFunscriptActions::Size;
+    actions[sol::meta_function::pairs] = [](LuaFunscriptActions& self, sol::this_state L) noexcept
+    {
+        auto next = [](LuaFunscriptActions& self, sol::object key, sol::this_state L) noexcept { return self.Next(key, L); };
+        return std::make_tuple(sol::make_object(L, next), sol::make_object(L, self.shared_from_this()), sol::lua_nil);
+    };
+
+    auto actionRef = L.new_usertype<LuaFunscriptActionRef>("ActionRef", sol::no_constructor);
+    actionRef["at"] = sol::property(&LuaFunscriptActionRef::at, &LuaFunscriptActionRef::set_at);
+    actionRef["pos"] = sol::property(&LuaFunscriptActionRef::pos, &LuaFunscriptActionRef::set_pos);
+    actionRef["selected"] = sol::property(&LuaFunscriptActionRef::selected, &LuaFunscriptActionRef::set_selected);
+
     auto script = L.new_usertype<LuaFunscript>("Funscript");
     script["hasSelection"] = &LuaFunscript::HasSelection;
     script["actions"] = sol::readonly_property(&LuaFunscript::Actions);
@@ -12,6 +36,12 @@ OFS_ScriptAPI::OFS_ScriptAPI(sol::usertype<class OFS_ExtensionAPI>& ofs) noexcep
     script["closestAction"] = &LuaFunscript::ClosestAction;
     script["closestActionAfter"] = &LuaFunscript::ClosestActionAfter;
     script["closestActionBefore"] = &LuaFunscript::ClosestActionBefore;
+    script["actionsInRange"] = &LuaFunscript::ActionsInRange;
+    script["selectedInRange"] = &LuaFunscript::SelectedInRange;
+    script["strokes"] = &LuaFunscript::Strokes;
+#ifdef OFS_LUAJIT
+    script["actionBuffer"] = [](LuaFunscript& self) noexcept { return self.Actions().Buffer(); };
+#endif
     script["selectedIndices"] = &LuaFunscript::SelectedIndices;
     script["markForRemoval"] = &LuaFunscript::MarkForRemoval;
     script["removeMarked"] = &LuaFunscript::RemoveMarked;
@@ -64,43 +94,335 @@ bool OFS_ScriptAPI::Undo() noexcept
     return undo;
 }
 
+size_t LuaFunscriptActions::Size() const noexcept
+{
+    if(copied) return copy.size();
+    auto ref = source.lock();
+    return ref ? ref->Actions().size() : 0;
+}
+
+FunscriptAction LuaFunscriptActions::Get(size_t idx) const noexcept
+{
+    if(copied) return idx < copy.size() ? copy[idx].o : FunscriptAction();
+    auto ref = source.lock();
+    if(ref && idx < ref->Actions().size()) {
+        return ref->Actions()[idx];
+    }
+    return FunscriptAction();
+}
+
+bool LuaFunscriptActions::IsSelected(size_t idx) const noexcept
+{
+    if(copied) return idx < copy.size() && copy[idx].selected;
+    auto ref = source.lock();
+    if(ref && idx < ref->Actions().size()) {
+        return ref->IsSelected(ref->Actions()[idx]);
+    }
+    return false;
+}
+
+bool LuaFunscriptActions::HasSelection() const noexcept
+{
+    if(copied) return std::any_of(copy.begin(), copy.end(), [](auto a) { return a.selected; });
+    auto ref = source.lock();
+    return ref && ref->HasSelection();
+}
+
+void LuaFunscriptActions::SelectedIndices(std::vector<lua_Integer>& outIndices) const noexcept
+{
+    if(copied) {
+        for(size_t i = 0, size = copy.size(); i < size; i += 1) {
+            if(copy[i].selected) outIndices.emplace_back(i + 1);
+        }
+        return;
+    }
+    auto ref = source.lock();
+    if(!ref) return;
+    // The selection is usually a lot smaller than the script
+    auto& actions = ref->Actions();
+    outIndices.reserve(ref->Selection().size());
+    for(auto selected : ref->Selection()) {
+        auto it = actions.find(selected);
+        if(it != actions.end()) {
+            outIndices.emplace_back(std::distance(actions.begin(), it) + 1);
+        }
+    }
+}
+
+size_t LuaFunscriptActions::LowerBound(lua_Number time) const noexcept
+{
+    if(copied) {
+        auto it = std::lower_bound(copy.begin(), copy.end(), time,
+            [](const LuaFunscriptAction& a, lua_Number time) noexcept { return a.o.atS < time; });
+        return std::distance(copy.begin(), it);
+    }
+    auto ref = source.lock();
+    if(!ref) return 0;
+    auto& actions = ref->Actions();
+    auto it = std::lower_bound(actions.begin(), actions.end(), time,
+        [](const FunscriptAction& a, lua_Number time) noexcept { return a.atS < time; });
+    return std::distance(actions.begin(), it);
+}
+
+size_t LuaFunscriptActions::UpperBound(lua_Number time) const noexcept
+{
+    if(copied) {
+        auto it = std::upper_bound(copy.begin(), copy.end(), time,
+            [](lua_Number time, const LuaFunscriptAction& a) noexcept { return time < a.o.atS; });
+        return std::distance(copy.begin(), it);
+    }
+    auto ref = source.lock();
+    if(!ref) return 0;
+    auto& actions = ref->Actions();
+    auto it = std::upper_bound(actions.begin(), actions.end(), time,
+        [](lua_Number time, const FunscriptAction& a) noexcept { return time < a.atS; });
+    return std::distance(actions.begin(), it);
+}
+
+void LuaFunscriptActions::checkOrder(size_t idx) noexcept
+{
+    if(!sorted || idx >= copy.size()) return;
+    if((idx > 0 && copy[idx - 1].o.atS > copy[idx].o.atS)
+        || (idx + 1 < copy.size() && copy[idx].o.atS > copy[idx + 1].o.atS)) {
+        sorted = false;
+    }
+}
+
+LuaFunscriptArray& LuaFunscriptActions::Mutable() noexcept
+{
+    if(copied) return copy;
+    OFS_PROFILE(__FUNCTION__);
+    copied = true;
+    auto ref = source.lock();
+    if(ref) {
+        sourceVersion = ref->EditVersion();
+        // Both arrays are sorted, walking them together avoids a lookup per action
+        auto& selection = ref->Selection();
+        auto selectionIt = selection.begin();
+        copy.reserve(ref->Actions().size());
+        for(auto action : ref->Actions()) {
+            while(selectionIt != selection.end() && selectionIt->atS < action.atS) ++selectionIt;
+            bool selected = selectionIt != selection.end() && *selectionIt == action;
+            copy.emplace_back(action, selected);
+        }
+    }
+    return copy;
+}
+
+#ifdef OFS_LUAJIT
+std::tuple<sol::lightuserdata_value, lua_Integer> LuaFunscriptActions::Buffer() noexcept
+{
+    auto& actions = Mutable();
+    // Writes through the pointer can't be tracked
+    sorted = false;
+    return std::make_tuple(sol::lightuserdata_value(actions.data()), (lua_Integer)actions.size());
+}
+#endif
+
+sol::object LuaFunscriptActions::Index(sol::stack_object key, sol::this_state L) noexcept
+{
+    auto idx = key.as<sol::optional<lua_Integer>>();
+    if(idx && *idx >= 1 && *idx <= (lua_Integer)Size()) {
+        return sol::make_object(L, LuaFunscriptActionRef(shared_from_this(), *idx - 1));
+    }
+    return sol::lua_nil;
+}
+
+void LuaFunscriptActions::NewIndex(lua_Integer idx, const LuaFunscriptAction& action, sol::this_state L) noexcept
+{
+    idx -= 1;
+    auto& actions = Mutable();
+    if(idx >= 0 && idx < actions.size()) {
+        actions[idx] = action;
+    }
+    else if(idx == actions.size()) {
+        actions.emplace_back(action);
+    }
+    else {
+        luaL_error(L.lua_state(), "Out of bounds index.");
+        return;
+    }
+    checkOrder(idx);
+}
+
+std::tuple<sol::object, sol::object> LuaFunscriptActions::Next(sol::object key, sol::this_state L) noexcept
+{
+    lua_Integer idx = key.is<lua_Integer>() ? key.as<lua_Integer>() : 0;
+    if(idx >= 0 && idx < (lua_Integer)Size()) {
+        return std::make_tuple(sol::make_object(L, idx + 1), sol::make_object(L, LuaFunscriptActionRef(shared_from_this(), idx)));
+    }
+    return std::make_tuple(sol::object(sol::lua_nil), sol::object(sol::lua_nil));
+}
+
+void LuaFunscriptActions::Add(const LuaFunscriptAction& action) noexcept
+{
+    auto& actions = Mutable();
+    actions.emplace_back(action);
+    checkOrder(actions.size() - 1);
+}
+
+void LuaFunscriptActions::Insert(lua_Integer idx, const LuaFunscriptAction& action, sol::this_state L) noexcept
+{
+    idx -= 1;
+    auto& actions = Mutable();
+    if(idx >= 0 && idx <= actions.size()) {
+        actions.insert(actions.begin() + idx, action);
+        checkOrder(idx);
+    }
+    else {
+        luaL_error(L.lua_state(), "Out of bounds index.");
+    }
+}
+
+void LuaFunscriptActions::Erase(lua_Integer idx, sol::this_state L) noexcept
+{
+    idx -= 1;
+    auto& actions = Mutable();
+    if(idx >= 0 && idx < actions.size()) {
+        actions.erase(actions.begin() + idx);
+    }
+    else {
+        luaL_error(L.lua_state(), "Out of bounds index.");
+    }
+}
+
+void LuaFunscriptActions::Clear() noexcept
+{
+    // Nothing to copy when everything gets thrown away
+    if(!copied) {
+        auto ref = source.lock();
+        if(ref) sourceVersion = ref->EditVersion();
+    }
+    copy.clear();
+    copied = true;
+}
+
+void LuaFunscriptActions::SetAt(size_t idx, lua_Number at) noexcept
+{
+    auto& actions = Mutable();
+    if(idx < actions.size()) {
+        actions[idx].set_at(at);
+        checkOrder(idx);
+    }
+}
+
+void LuaFunscriptActions::SetPos(size_t idx, lua_Integer pos) noexcept
+{
+    auto& actions = Mutable();
+    if(idx < actions.size()) actions[idx].set_pos(pos);
+}
+
+void LuaFunscriptActions::SetSelected(size_t idx, bool selected) noexcept
+{
+    auto& actions = Mutable();
+    if(idx < actions.size()) actions[idx].selected = selected;
+}
+
 LuaFunscript::LuaFunscript(int32_t scriptIdx, std::weak_ptr<Funscript> script) noexcept
     : script(script), scriptIdx(scriptIdx)
 {
     FUN_ASSERT(Util::InMainThread(), "Not in main thread.");
-    this->TakeSnapshot();
+    actions = std::make_shared<LuaFunscriptActions>(script);
 }
 
 LuaFunscript::LuaFunscript(const FunscriptArray& actions) noexcept
 {
+    LuaFunscriptArray copy;
+    copy.reserve(actions.size());
     for(auto a : actions) {
-        this->actions.emplace_back(a, false);
+        copy.emplace_back(a, false);
     }
+    this->actions = std::make_shared<LuaFunscriptActions>(std::move(copy));
 }
 
 void LuaFunscript::Commit(sol::this_state L) noexcept
 {
     FUN_ASSERT(Util::InMainThread(), "Not in main thread.");
+    // Nothing was changed
+    if(!actions->IsCopied()) return;
+
     auto app = OpenFunscripter::ptr;
     auto ref = script.lock();
-    if(ref) {
-        FunscriptArray commit;
-        FunscriptArray selection;
-        commit.reserve(actions.size());
-        for(auto action : actions) {
-            auto succ = commit.emplace(action.o);
-            if(!succ) {
-                luaL_error(L.lua_state(), "Tried adding multiple actions with the same timestamp.");
-                return;
-            }
-            if(action.selected) {
-                selection.emplace(action.o);
-            }
+    if(!ref) return;
+    OFS_PROFILE(__FUNCTION__);
+    // A task which yielded in between would undo whatever happened to the script in the meantime
+    if(ref->EditVersion() != actions->SourceVersion()) {
+        luaL_error(L.lua_state(), "The script was changed after its actions were copied.");
+        return;
+    }
+
+    auto& copy = actions->Mutable();
+    bool ordered = true;
+    for(size_t i = 0, size = copy.size(); i < size; i += 1) {
+        // The FFI view can write anything
+        copy[i].set_at(copy[i].o.atS);
+        copy[i].set_pos(copy[i].o.pos);
+        if(i > 0 && copy[i - 1].o.atS > copy[i].o.atS) ordered = false;
+    }
+    // The order of the Lua side copy is left alone
+    LuaFunscriptArray sortedCopy;
+    if(!ordered) {
+        sortedCopy = copy;
+        std::stable_sort(sortedCopy.begin(), sortedCopy.end(),
+            [](auto a1, auto a2) { return a1.o.atS < a2.o.atS; });
+    }
+    const auto& next = ordered ? copy : sortedCopy;
+    for(size_t i = 1, size = next.size(); i < size; i += 1) {
+        if(next[i - 1].o.atS == next[i].o.atS) {
+            luaL_error(L.lua_state(), "Tried adding multiple actions with the same timestamp.");
+            return;
         }
-        app->undoSystem->Snapshot(StateType::CUSTOM_LUA, script);
-        ref->SetActions(commit);
-        ref->SetSelection(selection);
     }
+
+    // Everything before prefix and after suffix is unchanged, only what's in between gets replaced
+    auto& current = ref->Actions();
+    auto& selection = ref->Selection();
+    auto sameAction = [](FunscriptAction a, const LuaFunscriptAction& b) noexcept {
+        return a == b.o && a.flags == b.o.flags && a.tag == b.o.tag;
+    };
+    size_t common = std::min(current.size(), next.size());
+    size_t prefix = 0;
+    for(auto selectionIt = selection.begin(); prefix < common; prefix += 1) {
+        auto action = current[prefix];
+        while(selectionIt != selection.end() && selectionIt->atS < action.atS) ++selectionIt;
+        bool selected = selectionIt != selection.end() && *selectionIt == action;
+        if(!sameAction(action, next[prefix]) || selected != next[prefix].selected) break;
+    }
+    size_t suffix = 0;
+    for(auto selectionIt = selection.rbegin(); suffix < common - prefix; suffix += 1) {
+        auto action = current[current.size() - 1 - suffix];
+        auto& nextAction = next[next.size() - 1 - suffix];
+        while(selectionIt != selection.rend() && selectionIt->atS > action.atS) ++selectionIt;
+        bool selected = selectionIt != selection.rend() && *selectionIt == action;
+        if(!sameAction(action, nextAction) || selected != nextAction.selected) break;
+    }
+    size_t currentEnd = current.size() - suffix;
+    size_t nextEnd = next.size() - suffix;
+    if(prefix == currentEnd && prefix == nextEnd) {
+        actions->SetSourceVersion(ref->EditVersion());
+        return;
+    }
+
+    float fromTime = std::numeric_limits<float>::max();
+    float toTime = std::numeric_limits<float>::lowest();
+    if(prefix < currentEnd) {
+        fromTime = std::min(fromTime, current[prefix].atS);
+        toTime = std::max(toTime, current[currentEnd - 1].atS);
+    }
+    Funscript::FunscriptData changed;
+    if(prefix < nextEnd) {
+        fromTime = std::min(fromTime, next[prefix].o.atS);
+        toTime = std::max(toTime, next[nextEnd - 1].o.atS);
+        changed.Actions.reserve(nextEnd - prefix);
+        for(size_t i = prefix; i < nextEnd; i += 1) {
+            changed.Actions.emplace_back_unsorted(next[i].o);
+            if(next[i].selected) changed.Selection.emplace_back_unsorted(next[i].o);
+        }
+    }
+
+    app->undoSystem->SnapshotInterval(StateType::CUSTOM_LUA, script, fromTime, toTime);
+    ref->SetDataInInterval(fromTime, toTime, changed);
+    actions->SetSourceVersion(ref->EditVersion());
 }
 
 std::string LuaFunscript::Path() const noexcept
@@ -131,70 +453,95 @@ const char* LuaFunscript::Name() const noexcept
 
 bool LuaFunscript::HasSelection() const noexcept
 {
-    return std::any_of(actions.begin(), actions.end(), [](auto a) { return a.selected; });
+    return actions->HasSelection();
 }
 
 sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>> LuaFunscript::ClosestAction(lua_Number time) noexcept
 {
+    if(actions->IsSorted()) {
+        size_t size = actions->Size();
+        if(size == 0) return sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>>();
+        // Either the first action at or after time or the one right before it
+        size_t idx = actions->LowerBound(time);
+        if(idx == size || (idx > 0 && (float)std::abs(actions->Get(idx - 1).atS - time) <= (float)std::abs(actions->Get(idx).atS - time))) {
+            idx -= 1;
+            // Like the linear search the first of multiple actions with the same timestamp wins
+            while(idx > 0 && actions->Get(idx - 1).atS == actions->Get(idx).atS) idx -= 1;
+        }
+        return sol::make_optional(std::make_tuple(actions->GetWithSelection(idx), (lua_Integer)idx + 1));
+    }
+
     float closestDelta = std::numeric_limits<float>::max();
     int closestIdx = -1;
-    LuaFunscriptAction closestAction(FunscriptAction(0, 0), false);
 
-    for(uint32_t i=0, size=actions.size(); i < size; i += 1) {
-        auto a = actions[i];
-        float delta = std::abs(a.at() - time);
+    for(uint32_t i=0, size=actions->Size(); i < size; i += 1) {
+        auto a = actions->Get(i);
+        float delta = std::abs(a.atS - time);
         if(delta < closestDelta) {
             closestDelta = delta;
             closestIdx = i;
-            closestAction = a;
         }
     }
     if(closestDelta != std::numeric_limits<float>::max()) {
-        return sol::make_optional(std::make_tuple(closestAction, closestIdx + 1));
+        return sol::make_optional(std::make_tuple(actions->GetWithSelection(closestIdx), closestIdx + 1));
     }
     return sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>>();
 }
 
 sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>> LuaFunscript::ClosestActionAfter(lua_Number time) noexcept
 {
+    if(actions->IsSorted()) {
+        size_t idx = actions->UpperBound(time);
+        if(idx < actions->Size()) {
+            return sol::make_optional(std::make_tuple(actions->GetWithSelection(idx), (lua_Integer)idx + 1));
+        }
+        return sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>>();
+    }
+
     float closestDelta = std::numeric_limits<float>::max();
     int closestIdx = -1;
-    LuaFunscriptAction closestAction(FunscriptAction(0, 0), false);
 
-    for(uint32_t i=0, size=actions.size(); i < size; i += 1) {
-        auto a = actions[i];
-        if(a.at() < time) continue;
-        float delta = std::abs(a.at() - time);
+    for(uint32_t i=0, size=actions->Size(); i < size; i += 1) {
+        auto a = actions->Get(i);
+        if(a.atS < time) continue;
+        float delta = std::abs(a.atS - time);
         if(delta < closestDelta && delta != 0.f) {
             closestDelta = delta;
             closestIdx = i;
-            closestAction = a;
         }
     }
     if(closestDelta != std::numeric_limits<float>::max()) {
-        return sol::make_optional(std::make_tuple(closestAction, closestIdx + 1));
+        return sol::make_optional(std::make_tuple(actions->GetWithSelection(closestIdx), closestIdx + 1));
     }
     return sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>>();
 }
 
 sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>> LuaFunscript::ClosestActionBefore(lua_Number time) noexcept
 {
+    if(actions->IsSorted()) {
+        size_t idx = actions->LowerBound(time);
+        if(idx > 0) {
+            idx -= 1;
+            while(idx > 0 && actions->Get(idx - 1).atS == actions->Get(idx).atS) idx -= 1;
+            return sol::make_optional(std::make_tuple(actions->GetWithSelection(idx), (lua_Integer)idx + 1));
+        }
+        return sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>>();
+    }
+
     float closestDelta = std::numeric_limits<float>::max();
     int closestIdx = -1;
-    LuaFunscriptAction closestAction(FunscriptAction(0, 0), false);
 
-    for(uint32_t i=0, size=actions.size(); i < size; i += 1) {
-        auto a = actions[i];
-        if(a.at() > time) continue;
-        float delta = std::abs(a.at() - time);
+    for(uint32_t i=0, size=actions->Size(); i < size; i += 1) {
+        auto a = actions->Get(i);
+        if(a.atS > time) continue;
+        float delta = std::abs(a.atS - time);
         if(delta < closestDelta && delta != 0.f) {
             closestDelta = delta;
             closestIdx = i;
-            closestAction = a;
         }
     }
     if(closestDelta != std::numeric_limits<float>::max()) {
-        return sol::make_optional(std::make_tuple(closestAction, closestIdx + 1));
+        return sol::make_optional(std::make_tuple(actions->GetWithSelection(closestIdx), closestIdx + 1));
     }
     return sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>>();
 }
@@ -202,18 +549,81 @@ sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>> LuaFunscript::Closest
 std::vector<lua_Integer> LuaFunscript::SelectedIndices() const noexcept
 {
     std::vector<lua_Integer> selectedIndices;
-    for(uint32_t i=0, size=actions.size(); i < size; i += 1) {
-        if(actions[i].selected) {
-            selectedIndices.emplace_back(i+1);
-        }
-    }
+    actions->SelectedIndices(selectedIndices);
     return selectedIndices;
 }
 
+// Yields (index, ActionRef) for every action with fromTime <= at <= toTime.
+// Only the range gets visited while the actions are sorted.
+static sol::object actionRangeIterator(std::shared_ptr<LuaFunscriptActions> actions, lua_Number fromTime, lua_Number toTime, bool selectedOnly, sol::this_state L) noexcept
+{
+    bool sorted = actions->IsSorted();
+    size_t idx = sorted ? actions->LowerBound(fromTime) : 0;
+    size_t end = sorted ? actions->UpperBound(toTime) : actions->Size();
+    auto next = [actions, idx, end, sorted, fromTime, toTime, selectedOnly](sol::this_state L) mutable noexcept
+        -> std::tuple<sol::object, sol::object>
+    {
+        // The loop body may have removed actions
+        end = std::min(end, actions->Size());
+        for(; idx < end; idx += 1) {
+            if(!sorted) {
+                auto at = actions->Get(idx).atS;
+                if(at < fromTime || at > toTime) continue;
+            }
+            if(selectedOnly && !actions->IsSelected(idx)) continue;
+            size_t current = idx++;
+            return std::make_tuple(sol::make_object(L, (lua_Integer)current + 1), sol::make_object(L, LuaFunscriptActionRef(actions, current)));
+        }
+        return std::make_tuple(sol::object(sol::lua_nil), sol::object(sol::lua_nil));
+    };
+    return sol::make_object(L, next);
+}
+
+sol::object LuaFunscript::ActionsInRange(lua_Number fromTime, lua_Number toTime, sol::this_state L) noexcept
+{
+    return actionRangeIterator(actions, fromTime, toTime, false, L);
+}
+
+sol::object LuaFunscript::SelectedInRange(lua_Number fromTime, lua_Number toTime, sol::this_state L) noexcept
+{
+    return actionRangeIterator(actions, fromTime, toTime, true, L);
+}
+
+sol::object LuaFunscript::Strokes(sol::this_state L) noexcept
+{
+    // Yields (startIdx, endIdx) of every run of actions moving in one direction.
+    // Consecutive strokes share the action where the direction changes.
+    auto next = [actions = actions, idx = size_t(0)](sol::this_state L) mutable noexcept
+        -> std::tuple<sol::object, sol::object>
+    {
+        size_t size = actions->Size();
+        while(idx + 1 < size) {
+            size_t start = idx;
+            int32_t startPos = actions->Get(start).pos;
+            int32_t nextPos = actions->Get(start + 1).pos;
+            if(startPos == nextPos) {
+                idx += 1;
+                continue;
+            }
+            bool up = nextPos > startPos;
+            size_t end = start + 1;
+            for(int32_t pos = nextPos; end + 1 < size; end += 1) {
+                int32_t followingPos = actions->Get(end + 1).pos;
+                if(up ? followingPos <= pos : followingPos >= pos) break;
+                pos = followingPos;
+            }
+            idx = end;
+            return std::make_tuple(sol::make_object(L, (lua_Integer)start + 1), sol::make_object(L, (lua_Integer)end + 1));
+        }
+        return std::make_tuple(sol::object(sol::lua_nil), sol::object(sol::lua_nil));
+    };
+    return sol::make_object(L, next);
+}
+
 void LuaFunscript::MarkForRemoval(lua_Integer idx, sol::this_state L) noexcept
 {
     idx -= 1;
-    if(idx >= 0 && idx < actions.size()) {
+    if(idx >= 0 && idx < actions->Size()) {
         markedIndices.insert(idx);
     }
     else {
@@ -223,14 +633,16 @@ void LuaFunscript::MarkForRemoval(lua_Integer idx, sol::this_state L) noexcept
 
 lua_Integer LuaFunscript::RemoveMarked() noexcept
 {
+    if(markedIndices.empty()) return 0;
+    auto& copy = actions->Mutable();
     LuaFunscriptArray filteredActions;
-    for(uint32_t i=0, size=actions.size(); i < size; i += 1) {
+    for(uint32_t i=0, size=copy.size(); i < size; i += 1) {
         if(markedIndices.find(i) == markedIndices.end()) {
-            filteredActions.emplace_back(actions[i]);
+            filteredActions.emplace_back(copy[i]);
         }
     }
-    auto removedCount = actions.size() - filteredActions.size();
-    actions = std::move(filteredActions);
+    auto removedCount = copy.size() - filteredActions.size();
+    copy = std::move(filteredActions);
     markedIndices.clear();
     return removedCount;
-}
\ No newline at end of file
+}
@@ -7,6 +7,7 @@
 #include <memory>
 #include <tuple>
 #include <set>
+#include <cstddef>
 
 struct LuaFunscriptAction
 {
@@ -50,41 +51,123 @@ struct LuaFunscriptAction
 
 using LuaFunscriptArray = std::vector<LuaFunscriptAction>;
 
+// The LuaJIT FFI declarations in OFS_LuaExtensionAPI.cpp depend on this layout
+static_assert(sizeof(FunscriptAction) == 8 && offsetof(FunscriptAction, pos) == 4, "ofs_script_action doesn't match FunscriptAction");
+static_assert(sizeof(LuaFunscriptAction) == 12 && offsetof(LuaFunscriptAction, selected) == 8, "ofs_script_action doesn't match LuaFunscriptAction");
+
+// Actions of a LuaFunscript.
+// Reads go straight to the Funscript, the actions only get copied
+// the first time an extension changes something.
+class LuaFunscriptActions : public std::enable_shared_from_this<LuaFunscriptActions>
+{
+    private:
+        std::weak_ptr<Funscript> source;
+        LuaFunscriptArray copy;
+        bool copied = false;
+        // Lookups fall back to linear searches while an extension has the actions out of order
+        bool sorted = true;
+        // EditVersion of the Funscript when the actions got copied
+        uint32_t sourceVersion = 0;
+
+        void checkOrder(size_t idx) noexcept;
+
+    public:
+        LuaFunscriptActions(std::weak_ptr<Funscript> source) noexcept
+            : source(source) {}
+        LuaFunscriptActions(LuaFunscriptArray&& actions) noexcept
+            : copy(std::move(actions)), copied(true) {}
+
+        inline bool IsCopied() const noexcept { return copied; }
+        inline bool IsSorted() const noexcept { return sorted; }
+        inline void MarkSorted() noexcept { sorted = true; }
+        inline uint32_t SourceVersion() const noexcept { return sourceVersion; }
+        inline void SetSourceVersion(uint32_t version) noexcept { sourceVersion = version; }
+
+        size_t Size() const noexcept;
+        FunscriptAction Get(size_t idx) const noexcept;
+        bool IsSelected(size_t idx) const noexcept;
+        inline LuaFunscriptAction GetWithSelection(size_t idx) const noexcept { return LuaFunscriptAction(Get(idx), IsSelected(idx)); }
+        bool HasSelection() const noexcept;
+        void SelectedIndices(std::vector<lua_Integer>& outIndices) const noexcept;
+
+        // First index with a timestamp >= time (LowerBound) or > time (UpperBound).
+        // Only meaningful while IsSorted().
+        size_t LowerBound(lua_Number time) const noexcept;
+        size_t UpperBound(lua_Number time) const noexcept;
+
+        void SetAt(size_t idx, lua_Number at) noexcept;
+        void SetPos(size_t idx, lua_Integer pos) noexcept;
+        void SetSelected(size_t idx, bool selected) noexcept;
+
+        // Copies the actions if that didn't happen yet
+        LuaFunscriptArray& Mutable() noexcept;
+
+#ifdef OFS_LUAJIT
+        // Raw pointer for the FFI view, see actionView.
+        // Always points into the copy, the Funscript's own actions can change while a task is suspended.
+        std::tuple<sol::lightuserdata_value, lua_Integer> Buffer() noexcept;
+#endif
+
+        // Lua interface, indices are 1 based
+        sol::object Index(sol::stack_object key, sol::this_state L) noexcept;
+        void NewIndex(lua_Integer idx, const LuaFunscriptAction& action, sol::this_state L) noexcept;
+        std::tuple<sol::object, sol::object> Next(sol::object key, sol::this_state L) noexcept;
+        void Add(const LuaFunscriptAction& action) noexcept;
+        void Insert(lua_Integer idx, const LuaFunscriptAction& action, sol::this_state L) noexcept;
+        void Erase(lua_Integer idx, sol::this_state L) noexcept;
+        void Clear() noexcept;
+        inline bool Empty() const noexcept { return Size() == 0; }
+};
+
+// What indexing LuaFunscriptActions returns.
+// Refers to the action by index so writes can copy the actions first.
+class LuaFunscriptActionRef
+{
+    private:
+        std::shared_ptr<LuaFunscriptActions> actions;
+        size_t idx;
+
+    public:
+        LuaFunscriptActionRef(std::shared_ptr<LuaFunscriptActions> actions, size_t idx) noexcept
+            : actions(std::move(actions)), idx(idx) {}
+
+        inline LuaFunscriptAction Value() const noexcept { return actions->GetWithSelection(idx); }
+
+        inline lua_Number at() const noexcept { return actions->Get(idx).atS; }
+        inline lua_Integer pos() const noexcept { return actions->Get(idx).pos; }
+        inline bool selected() const noexcept { return actions->IsSelected(idx); }
+
+        inline void set_at(lua_Number at) noexcept { actions->SetAt(idx, at); }
+        inline void set_pos(lua_Integer pos) noexcept { actions->SetPos(idx, pos); }
+        inline void set_selected(bool selected) noexcept { actions->SetSelected(idx, selected); }
+};
+
 class LuaFunscript
 {
     private:
         int32_t scriptIdx = -1;
         std::weak_ptr<Funscript> script;
-        LuaFunscriptArray actions;
+        std::shared_ptr<LuaFunscriptActions> actions;
         std::set<uint32_t> markedIndices;
     public:
         LuaFunscript(int32_t scriptIdx, std::weak_ptr<Funscript> script) noexcept;
         LuaFunscript(const FunscriptArray& actions) noexcept;
 
-        inline void TakeSnapshot() noexcept
+        inline LuaFunscriptActions& Actions() noexcept 
         {
-            OFS_PROFILE(__FUNCTION__);
-            auto ref = script.lock();
-            if(ref) {
-                auto size = ref->Actions().size();
-                actions.reserve(size);
-                for(auto action : ref->Actions()) {
-                    actions.emplace_back(action, ref->IsSelected(action));
-                }
-            }
-        }
-
-        inline LuaFunscriptArray& Actions() noexcept 
-        {
-            return actions;
+            return *actions;
         }
 
         inline void Sort() noexcept
         {
-            std::stable_sort(actions.begin(), actions.end(),
+            // Actions taken from a Funscript are sorted until they get copied
+            if(!actions->IsCopied()) return;
+            auto& copy = actions->Mutable();
+            std::stable_sort(copy.begin(), copy.end(),
                 [](auto a1, auto a2) {
                     return a1.o.atS < a2.o.atS;
                 });
+            actions->MarkSorted();
         }
 
         void Commit(sol::this_state L) noexcept;
@@ -98,6 +181,11 @@ class LuaFunscript
         sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>> ClosestActionAfter(lua_Number time) noexcept;
         sol::optional<std::tuple<LuaFunscriptAction, lua_Integer>> ClosestActionBefore(lua_Number time) noexcept;
 
+        // Iterator functions for generic for loops
+        sol::object ActionsInRange(lua_Number fromTime, lua_Number toTime, sol::this_state L) noexcept;
+        sol::object SelectedInRange(lua_Number fromTime, lua_Number toTime, sol::this_state L) noexcept;
+        sol::object Strokes(sol::this_state L) noexcept;
+
         void MarkForRemoval(lua_Integer actionIdx, sol::this_state L) noexcept;
         lua_Integer RemoveMarked() noexcept;
 };
@@ -42,6 +42,7 @@ struct OpenFunscripterState
     bool showETCode = false;
     bool showWsApi = false;
     bool showChapterManager = false;
+    bool showJobs = false;
 
     inline static OpenFunscripterState& State(uint32_t stateHandle) noexcept
     {
@@ -71,4 +72,5 @@ REFL_TYPE(OpenFunscripterState)
     REFL_FIELD(showETCode)
     REFL_FIELD(showWsApi)
     REFL_FIELD(showChapterManager)
+    REFL_FIELD(showJobs)
 REFL_END
@@ -23,6 +23,7 @@ struct PreferenceState
 	int32_t	vsync = 0;
 	int32_t framerateLimit = 150;
 
+	bool redrawOnDemand = false;
 	bool forceHwDecoding = false;
 	bool showMetaOnNew = true;
 
@@ -39,6 +40,7 @@ REFL_TYPE(PreferenceState)
 	REFL_FIELD(fastStepAmount)
 	REFL_FIELD(vsync)
 	REFL_FIELD(framerateLimit)
+	REFL_FIELD(redrawOnDemand)
 	REFL_FIELD(forceHwDecoding)
 	REFL_FIELD(showMetaOnNew)
 REFL_END
\ No newline at end of file
@@ -7,6 +7,8 @@ enum class SpecialFunctionType : int32_t
 {
 	RangeExtender,
 	RamerDouglasPeucker, 
+	VisvalingamWhyatt,
+	SimplifyToCount,
     /* TODO: Remap */
 	TotalFunctionCount
 };
@@ -0,0 +1,296 @@
+#include "Funscript.h"
+#include "FunscriptUndoSystem.h"
+#include "OFS_UndoSystem.h"
+#include "OFS_SpecialFunctions.h"
+#include "OFS_WebsocketApiEvents.h"
+#include "OFS_ETCode/output_thread.hpp"
+#include "OFS_Util.h"
+
+#include "SDL_main.h"
+#include "SDL_timer.h"
+
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <random>
+
+// Checks for the parts which don't need a window, run by ctest.
+// Every failed check is printed, the exit code is the number of failures.
+
+static int failures = 0;
+
+#define CHECK(expr) \
+    do { \
+        if (!(expr)) { \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            failures += 1; \
+        } \
+    } while (0)
+
+static FunscriptArray makeActions(std::initializer_list<std::pair<float, int32_t>> actions) noexcept
+{
+    FunscriptArray result;
+    for (auto [atS, pos] : actions) {
+        result.emplace_back_unsorted(FunscriptAction(atS, pos));
+    }
+    return result;
+}
+
+static bool sameActions(const FunscriptArray& a, const FunscriptArray& b) noexcept
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i += 1) {
+        if (a[i].atS != b[i].atS || a[i].pos != b[i].pos) return false;
+    }
+    return true;
+}
+
+static void testSetDataInInterval() noexcept
+{
+    Funscript script;
+    script.SetActions(makeActions({ { 0.f, 0 }, { 1.f, 10 }, { 2.f, 20 }, { 3.f, 30 }, { 4.f, 40 }, { 5.f, 50 } }));
+    script.SetSelected(FunscriptAction(2.f, 20), true);
+    script.SetSelected(FunscriptAction(5.f, 50), true);
+
+    // both ends of the interval are part of it
+    Funscript::FunscriptData interval;
+    interval.Actions = makeActions({ { 1.5f, 99 }, { 3.f, 33 } });
+    interval.Selection = makeActions({ { 1.5f, 99 } });
+    uint32_t version = script.EditVersion();
+    script.SetDataInInterval(1.f, 4.f, interval);
+
+    CHECK(sameActions(script.Actions(), makeActions({ { 0.f, 0 }, { 1.5f, 99 }, { 3.f, 33 }, { 5.f, 50 } })));
+    CHECK(sameActions(script.Selection(), makeActions({ { 1.5f, 99 }, { 5.f, 50 } })));
+    CHECK(script.EditVersion() != version);
+    CHECK(script.HasUnsavedEdits());
+
+    auto data = script.DataInInterval(1.f, 4.f);
+    CHECK(sameActions(data.Actions, interval.Actions));
+    CHECK(sameActions(data.Selection, interval.Selection));
+
+    // an empty interval only removes
+    script.SetDataInInterval(0.f, 2.f, Funscript::FunscriptData());
+    CHECK(sameActions(script.Actions(), makeActions({ { 3.f, 33 }, { 5.f, 50 } })));
+    CHECK(sameActions(script.Selection(), makeActions({ { 5.f, 50 } })));
+}
+
+static void testIntervalUndo() noexcept
+{
+    auto script = std::make_shared<Funscript>();
+    script->SetActions(makeActions({ { 0.f, 0 }, { 1.f, 100 }, { 2.f, 0 }, { 3.f, 100 }, { 4.f, 0 } }));
+    script->SetSelected(FunscriptAction(1.f, 100), true);
+    script->SetSelected(FunscriptAction(3.f, 100), true);
+    auto original = script->Data();
+
+    UndoSystem undo;
+    undo.SnapshotInterval(StateType::SIMPLIFY, script, 1.f, 3.f);
+    Funscript::FunscriptData edit;
+    edit.Actions = makeActions({ { 2.f, 50 } });
+    script->SetDataInInterval(1.f, 3.f, edit);
+    auto edited = script->Data();
+
+    // the redo snapshot only covers the interval as well
+    CHECK(undo.Undo());
+    CHECK(sameActions(script->Actions(), original.Actions));
+    CHECK(sameActions(script->Selection(), original.Selection));
+    CHECK(undo.UndoEmpty());
+
+    CHECK(undo.Redo());
+    CHECK(sameActions(script->Actions(), edited.Actions));
+    CHECK(sameActions(script->Selection(), edited.Selection));
+
+    // edits outside of the interval survive undoing it
+    script->AddAction(FunscriptAction(10.f, 42));
+    CHECK(undo.Undo());
+    CHECK(sameActions(script->Actions(), makeActions({ { 0.f, 0 }, { 1.f, 100 }, { 2.f, 0 }, { 3.f, 100 }, { 4.f, 0 }, { 10.f, 42 } })));
+    CHECK(undo.Redo());
+    CHECK(sameActions(script->Actions(), makeActions({ { 0.f, 0 }, { 2.f, 50 }, { 4.f, 0 }, { 10.f, 42 } })));
+
+    // whole script snapshots keep working next to interval ones
+    undo.Snapshot(StateType::REMOVE_ACTIONS, script);
+    auto beforeClear = script->Data();
+    script->SetActions(FunscriptArray());
+    CHECK(undo.Undo());
+    CHECK(sameActions(script->Actions(), beforeClear.Actions));
+}
+
+static void testRamerDouglasPeucker() noexcept
+{
+    FunscriptArray result;
+
+    // points on a line collapse to the end points
+    FunscriptArray line;
+    for (int i = 0; i < 10; i += 1) {
+        line.emplace_back_unsorted(FunscriptAction(i * 1.f, i * 10));
+    }
+    RamerDouglasPeuckerSimplify(line, 0.1f, 1, result);
+    CHECK(sameActions(result, makeActions({ { 0.f, 0 }, { 9.f, 90 } })));
+
+    // only the bump of 1 is closer to its line than epsilon
+    auto spike = makeActions({ { 0.f, 0 }, { 10.f, 0 }, { 20.f, 100 }, { 30.f, 0 }, { 40.f, 1 }, { 50.f, 0 } });
+    RamerDouglasPeuckerSimplify(spike, 2.f, 1, result);
+    CHECK(sameActions(result, makeActions({ { 0.f, 0 }, { 10.f, 0 }, { 20.f, 100 }, { 30.f, 0 }, { 50.f, 0 } })));
+
+    auto twoPoints = makeActions({ { 0.f, 0 }, { 1.f, 100 } });
+    RamerDouglasPeuckerSimplify(twoPoints, 100.f, 1, result);
+    CHECK(sameActions(result, twoPoints));
+
+    // large enough to be split into parts, the result has to match the single part
+    std::mt19937 random(1337);
+    FunscriptArray points;
+    for (int i = 0; i < 20000; i += 1) {
+        points.emplace_back_unsorted(FunscriptAction(i * 0.05f, (int32_t)(random() % 101)));
+    }
+    FunscriptArray single;
+    RamerDouglasPeuckerSimplify(points, 5.f, 1, single);
+    RamerDouglasPeuckerSimplify(points, 5.f, 8, result);
+    CHECK(single.size() > 2 && single.size() < points.size());
+    CHECK(sameActions(result, single));
+}
+
+static void testVisvalingamWhyatt() noexcept
+{
+    // areas are 100, 51 and 2, removing the last one raises the middle one to 100
+    auto points = makeActions({ { 0.f, 0 }, { 1.f, 100 }, { 2.f, 0 }, { 3.f, 2 }, { 4.f, 0 } });
+    FunscriptArray result;
+    VisvalingamWhyattSimplify(points, 10.f, 0, result);
+    CHECK(sameActions(result, makeActions({ { 0.f, 0 }, { 1.f, 100 }, { 2.f, 0 }, { 4.f, 0 } })));
+    VisvalingamWhyattSimplify(points, 1000.f, 0, result);
+    CHECK(sameActions(result, makeActions({ { 0.f, 0 }, { 4.f, 0 } })));
+    VisvalingamWhyattSimplify(points, std::numeric_limits<float>::infinity(), 4, result);
+    CHECK(sameActions(result, makeActions({ { 0.f, 0 }, { 1.f, 100 }, { 2.f, 0 }, { 4.f, 0 } })));
+    VisvalingamWhyattSimplify(points, std::numeric_limits<float>::infinity(), 1, result);
+    CHECK(result.size() == 2);
+    VisvalingamWhyattSimplify(points, 0.f, 0, result);
+    CHECK(sameActions(result, points));
+}
+
+static bool roundTripCbor(const nlohmann::json& packed, FunscriptArray& actions) noexcept
+{
+    auto cbor = Util::SerializeCBOR(packed);
+    auto json = nlohmann::json::from_cbor(cbor.begin(), cbor.end(), true, false, nlohmann::json::cbor_tag_handler_t::store);
+    return !json.is_discarded() && WsUnpackActions(json, actions);
+}
+
+static void testCborTypedArrays() noexcept
+{
+    // duplicate timestamps after rounding to milliseconds and positions out of range get normalized
+    auto source = makeActions({ { 0.f, 0 }, { 0.0001f, 7 }, { 1.5f, 100 }, { 2.f, 150 }, { 3000.f, 42 } });
+    auto normalized = WsNormalizeActions(source);
+    CHECK(normalized.size() == 4);
+    CHECK(normalized.back() == (WsAction{ 3000000, 42 }));
+    CHECK(normalized[2] == (WsAction{ 2000, 100 }));
+
+    FunscriptArray actions;
+    CHECK(roundTripCbor(WsPackActions(normalized), actions));
+    CHECK(sameActions(actions, makeActions({ { 0.f, 0 }, { 1.5f, 100 }, { 2.f, 100 }, { 3000.f, 42 } })));
+
+    // the tags have to match the element type
+    auto swapped = WsPackActions(normalized);
+    swapped["at"].get_binary().set_subtype((uint8_t)WsTypedArrayTag::Uint8);
+    CHECK(!roundTripCbor(swapped, actions));
+    auto untagged = WsPackActions(normalized);
+    untagged["pos"].get_binary().clear_subtype();
+    CHECK(!roundTripCbor(untagged, actions));
+
+    // plain arrays only take integers which fit into 32 bits
+    CHECK(WsUnpackActions(nlohmann::json{ { "at", { 2000, 1000 } }, { "pos", { 20, 10 } } }, actions));
+    CHECK(sameActions(actions, makeActions({ { 1.f, 10 }, { 2.f, 20 } })));
+    CHECK(!WsUnpackActions(nlohmann::json{ { "at", { 1.5 } }, { "pos", { 10 } } }, actions));
+    CHECK(!WsUnpackActions(nlohmann::json{ { "at", { 4294967296ll } }, { "pos", { 10 } } }, actions));
+    CHECK(!WsUnpackActions(nlohmann::json{ { "at", { 1000, 2000 } }, { "pos", { 10 } } }, actions));
+    CHECK(!WsUnpackActions(nlohmann::json::array({ { { "at", 1000 }, { "pos", "10" } } }), actions));
+}
+
+static void testPlaybackClock() noexcept
+{
+    auto frequency = SDL_GetPerformanceFrequency();
+    sevfate::PlaybackClock clock;
+    clock.anchor.time = 10.0;
+    clock.anchor.counter = 1000 * frequency;
+    clock.anchor.speed = 2.f;
+    clock.anchor.paused = false;
+
+    // one second later at double speed
+    auto next = clock.anchor;
+    next.counter += frequency;
+    next.time = 12.0;
+    CHECK(clock.time_at(next.counter) == 12.0);
+    CHECK(clock.continues_with(next));
+
+    // drift within the tolerance is absorbed, beyond it it's a jump
+    next.time = 12.0 + sevfate::PlaybackClock::DRIFT_TOLERANCE_S * 0.5;
+    CHECK(clock.continues_with(next));
+    next.time = 12.0 + sevfate::PlaybackClock::DRIFT_TOLERANCE_S * 2.0;
+    CHECK(!clock.continues_with(next));
+
+    // a seek, pause or speed change never continues, even at the extrapolated time
+    next.time = 12.0;
+    auto seeked = next;
+    seeked.seeks += 1;
+    CHECK(!clock.continues_with(seeked));
+    auto paused = next;
+    paused.paused = true;
+    CHECK(!clock.continues_with(paused));
+    auto faster = next;
+    faster.speed = 3.f;
+    CHECK(!clock.continues_with(faster));
+
+    // paused clocks stand still
+    clock.anchor.paused = true;
+    CHECK(clock.time_at(clock.anchor.counter + 10 * frequency) == 10.0);
+    auto stillPaused = clock.anchor;
+    stillPaused.counter += 10 * frequency;
+    CHECK(clock.continues_with(stillPaused));
+}
+
+static void testSnapshotBuffer() noexcept
+{
+    sevfate::SnapshotBuffer<int> buffer;
+    CHECK(!buffer.update());
+
+    buffer.back() = 1;
+    buffer.publish();
+    CHECK(buffer.update());
+    CHECK(buffer.front() == 1);
+    // nothing new
+    CHECK(!buffer.update());
+    CHECK(buffer.front() == 1);
+
+    // the reader skips values it was too slow for
+    for (int value = 2; value <= 5; value += 1) {
+        buffer.back() = value;
+        buffer.publish();
+    }
+    CHECK(buffer.update());
+    CHECK(buffer.front() == 5);
+    CHECK(!buffer.update());
+
+    // the writer never gets the slot the reader holds
+    buffer.back() = 6;
+    CHECK(buffer.front() == 5);
+    buffer.publish();
+    buffer.back() = 7;
+    CHECK(buffer.front() == 5);
+    CHECK(buffer.update());
+    CHECK(buffer.front() == 6);
+}
+
+int main(int argc, char* argv[])
+{
+    testSetDataInInterval();
+    testIntervalUndo();
+    testRamerDouglasPeucker();
+    testVisvalingamWhyatt();
+    testCborTypedArrays();
+    testPlaybackClock();
+    testSnapshotBuffer();
+
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+    }
+    else {
+        std::printf("All checks passed\n");
+    }
+    return failures;
+}